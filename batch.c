@@ -0,0 +1,463 @@
+#include "batch.h"
+#include "life_kernel.h"
+#include "pattern.h"
+#include "checkpoint.h"
+#include "random_generator.h"
+#include "metrics.h"
+#include "cycle_detector.h"
+#include "page_arena.h"
+#include "domains.h"
+#include "recorder.h"
+
+#define DEFAULT_BATCH_ROWS 1024
+#define DEFAULT_BATCH_COLUMNS 1024
+#define DEFAULT_BATCH_DENSITY 0.3
+#define DEFAULT_BATCH_GENERATIONS 1000
+// The metrics are written to their file after this many generations, well before their ring buffer is full
+#define METRICS_FLUSH_GENERATIONS 1024
+
+/* What a run does once the board has settled into a cycle */
+typedef enum
+{
+    // Don't look for cycles, so the board isn't hashed and the throughput stays comparable
+    ON_CYCLE_IGNORE,
+    // Keep computing every generation, only report the cycle
+    ON_CYCLE_REPORT,
+    // End the run at the generation the cycle was detected in
+    ON_CYCLE_STOP,
+    // Jump to the last requested generation without computing the generations in between
+    ON_CYCLE_SKIP
+} cycle_action;
+
+typedef struct
+{
+    int rows;
+    int columns;
+    Uint64 seed;
+    double density;
+    int generations;
+    int threads;
+    // An RLE or plaintext pattern that replaces the random population, NULL if there is none
+    const char *pattern_path;
+    // The run resumes from this checkpoint if it exists and saves its progress to it, NULL if there is none
+    const char *checkpoint_path;
+    // Every generation's metrics are written to this CSV ( or .json ) file, NULL if there is none
+    const char *metrics_path;
+    // Replaces the boundary of the checkpoint if has_boundary is set
+    boundary_mode boundary;
+    bool has_boundary;
+    // Replaces the rule of the pattern or checkpoint, NULL if there is none
+    const char *rule;
+    cycle_action on_cycle;
+    huge_page_mode huge_pages;
+    // The board is split into domain_columns x domain_rows subdomains that are updated by worker processes, 0 if it isn't split
+    int domain_columns;
+    int domain_rows;
+    // The generations are recorded into a GIF, PNGs or a raw video if the recording has a path
+    recording_settings recording;
+} batch_options;
+
+void print_batch_usage( void )
+{
+    fprintf( stderr,
+        "usage: --batch [option value]...\n"
+        "    --rows n          Rows of the board (default %d)\n"
+        "    --columns n       Columns of the board (default %d)\n"
+        "    --seed n          Seed of the random population (default %llu)\n"
+        "    --density f       Fraction of living cells in the random population (default %.2f)\n"
+        "    --generations n   Generations to simulate (default %d)\n"
+        "    --threads n       Threads that update the board (default: the number of CPUs)\n"
+        "    --pattern file    Start with the centered .rle or .cells pattern instead of a random population,\n"
+        "                      the board grows if the pattern doesn't fit\n"
+        "    --checkpoint file Resume from the checkpoint if it exists, save to it every %d seconds and at the end\n"
+        "    --metrics file    Write every generation's step time, population, births, deaths and active tiles\n"
+        "                      to the file as CSV, or as JSON lines if it ends with .json\n"
+        "    --boundary mode   What the edge cells see beyond the edges: dead, torus or klein (default: the boundary\n"
+        "                      of the checkpoint, or dead)\n"
+        "    --rule rulestring The Life-like rule in B/S notation, e.g. B36/S23 (default: the rule of the pattern\n"
+        "                      or checkpoint, or B3/S23)\n"
+        "    --on-cycle action What to do when the board has become a still life or oscillator: report keeps computing,\n"
+        "                      stop ends the run, skip jumps to the last generation (default: don't look for cycles)\n"
+        "    --huge-pages mode Back big boards with huge pages: off, transparent or explicit (default transparent)\n"
+        "    --domains CxR     Split the board into C x R subdomains, each updated by its own worker process\n"
+        "    --record file     Record the generations into a .gif, a .png per generation or a .raw 8 bit gray video\n"
+        "    --record-every n  Only record every nth generation (default 1)\n"
+        "    --record-scale n  Pixels per cell of the recording (default 1)\n"
+        "    --record-policy p What happens when the encoder falls behind: wait for it or drop the frame (default wait)\n",
+        DEFAULT_BATCH_ROWS, DEFAULT_BATCH_COLUMNS, ( unsigned long long ) DEFAULT_RANDOM_SEED, DEFAULT_BATCH_DENSITY, DEFAULT_BATCH_GENERATIONS,
+        CHECKPOINT_INTERVAL_MS / 1000 );
+}
+
+/* Fills options from the command line, returns FALSE if an option is unknown or has an invalid value */
+bool parse_batch_options( int argc, char** argv, batch_options *options )
+{
+    options->rows = DEFAULT_BATCH_ROWS;
+    options->columns = DEFAULT_BATCH_COLUMNS;
+    options->seed = DEFAULT_RANDOM_SEED;
+    options->density = DEFAULT_BATCH_DENSITY;
+    options->generations = DEFAULT_BATCH_GENERATIONS;
+    options->threads = SDL_GetCPUCount( );
+    options->pattern_path = NULL;
+    options->checkpoint_path = NULL;
+    options->metrics_path = NULL;
+    options->boundary = BOUNDARY_DEAD;
+    options->has_boundary = FALSE;
+    options->rule = NULL;
+    options->on_cycle = ON_CYCLE_IGNORE;
+    options->huge_pages = HUGE_PAGES_TRANSPARENT;
+    options->domain_columns = 0;
+    options->domain_rows = 0;
+    options->recording = default_recording_settings( NULL );
+
+    // Every option takes a value
+    if ( argc % 2 )
+    {
+        fprintf( stderr, "missing value for %s\n", argv[ argc - 1 ] );
+        return FALSE;
+    }
+    for ( int i = 0; i < argc; i += 2 )
+    {
+        const char *name = argv[ i ];
+        const char *value = argv[ i + 1 ];
+        if ( strcmp( name, "--rows" ) == 0 )
+        {
+            options->rows = atoi( value );
+        }
+        else if ( strcmp( name, "--columns" ) == 0 )
+        {
+            options->columns = atoi( value );
+        }
+        else if ( strcmp( name, "--seed" ) == 0 )
+        {
+            options->seed = strtoull( value, NULL, 10 );
+        }
+        else if ( strcmp( name, "--density" ) == 0 )
+        {
+            options->density = atof( value );
+        }
+        else if ( strcmp( name, "--generations" ) == 0 )
+        {
+            options->generations = atoi( value );
+        }
+        else if ( strcmp( name, "--threads" ) == 0 )
+        {
+            options->threads = atoi( value );
+        }
+        else if ( strcmp( name, "--pattern" ) == 0 )
+        {
+            options->pattern_path = value;
+        }
+        else if ( strcmp( name, "--checkpoint" ) == 0 )
+        {
+            options->checkpoint_path = value;
+        }
+        else if ( strcmp( name, "--metrics" ) == 0 )
+        {
+            options->metrics_path = value;
+        }
+        else if ( strcmp( name, "--rule" ) == 0 )
+        {
+            options->rule = value;
+        }
+        else if ( strcmp( name, "--on-cycle" ) == 0 )
+        {
+            const char *actions[ ] = { "report", "stop", "skip" };
+            int action = 0;
+            while ( action < 3 && strcmp( value, actions[ action ] ) )
+            {
+                action++;
+            }
+            if ( action == 3 )
+            {
+                fprintf( stderr, "unknown cycle action: %s\n", value );
+                return FALSE;
+            }
+            options->on_cycle = ( cycle_action ) ( ON_CYCLE_REPORT + action );
+        }
+        else if ( strcmp( name, "--huge-pages" ) == 0 )
+        {
+            if ( !huge_page_mode_from_name( value, &options->huge_pages ) )
+            {
+                fprintf( stderr, "unknown huge page mode: %s\n", value );
+                return FALSE;
+            }
+        }
+        else if ( strcmp( name, "--domains" ) == 0 )
+        {
+            if ( sscanf( value, "%dx%d", &options->domain_columns, &options->domain_rows ) != 2 ||
+                 options->domain_columns <= 0 || options->domain_rows <= 0 )
+            {
+                fprintf( stderr, "invalid subdomains: %s\n", value );
+                return FALSE;
+            }
+        }
+        else if ( strcmp( name, "--record" ) == 0 )
+        {
+            recording_format format;
+            if ( !recording_format_from_path( value, &format ) )
+            {
+                fprintf( stderr, "unknown recording format, the file has to end with .gif, .png or .raw: %s\n", value );
+                return FALSE;
+            }
+            options->recording.path = value;
+        }
+        else if ( strcmp( name, "--record-every" ) == 0 )
+        {
+            options->recording.every = atoi( value );
+        }
+        else if ( strcmp( name, "--record-scale" ) == 0 )
+        {
+            options->recording.scale = atoi( value );
+        }
+        else if ( strcmp( name, "--record-policy" ) == 0 )
+        {
+            if ( !recording_policy_from_name( value, &options->recording.policy ) )
+            {
+                fprintf( stderr, "unknown recording policy: %s\n", value );
+                return FALSE;
+            }
+        }
+        else if ( strcmp( name, "--boundary" ) == 0 )
+        {
+            if ( !boundary_mode_from_name( value, &options->boundary ) )
+            {
+                fprintf( stderr, "unknown boundary mode: %s\n", value );
+                return FALSE;
+            }
+            options->has_boundary = TRUE;
+        }
+        else
+        {
+            fprintf( stderr, "unknown option: %s\n", name );
+            return FALSE;
+        }
+    }
+
+    if ( options->rows <= 0 || options->columns <= 0 || options->threads <= 0 || options->generations < 0 )
+    {
+        fprintf( stderr, "rows, columns and threads must be positive and generations can't be negative\n" );
+        return FALSE;
+    }
+    if ( options->density < 0 || options->density > 1 )
+    {
+        fprintf( stderr, "density must be between 0 and 1\n" );
+        return FALSE;
+    }
+    if ( options->domain_columns && options->on_cycle != ON_CYCLE_IGNORE )
+    {
+        fprintf( stderr, "--on-cycle can't be combined with --domains, the worker processes don't hash their subdomains\n" );
+        return FALSE;
+    }
+    if ( options->domain_columns && options->recording.path )
+    {
+        fprintf( stderr, "--record can't be combined with --domains, the cells are only gathered from the workers at the end\n" );
+        return FALSE;
+    }
+    life_rule rule;
+    if ( options->rule && !parse_life_rule( options->rule, &rule ) )
+    {
+        fprintf( stderr, "invalid or unsupported ( B0 ) rule: %s\n", options->rule );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int run_batch( int argc, char** argv )
+{
+    batch_options options;
+    if ( !parse_batch_options( argc, argv, &options ) )
+    {
+        print_batch_usage( );
+        return EXIT_FAILURE;
+    }
+
+    set_huge_page_mode( options.huge_pages );
+    board *b;
+    bool random_population = FALSE;
+    if ( options.checkpoint_path && checkpoint_exists( options.checkpoint_path ) )
+    {
+        b = load_checkpoint( options.checkpoint_path );
+        if ( !b )
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    else if ( options.pattern_path )
+    {
+        b = load_pattern_board( options.pattern_path, options.rows, options.columns );
+        if ( !b )
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        b = create_board( options.rows, options.columns );
+        if ( !b )
+        {
+            return EXIT_FAILURE;
+        }
+        random_population = TRUE;
+    }
+    int threads = set_board_thread_count( b, options.threads );
+    if ( options.has_boundary )
+    {
+        set_board_boundary( b, options.boundary );
+    }
+    if ( options.rule )
+    {
+        life_rule rule;
+        parse_life_rule( options.rule, &rule );
+        set_board_rule( b, rule );
+    }
+    if ( random_population )
+    {
+        // The board's threads fill it, the cells are the same for every thread count
+        seed_random( options.seed );
+        fill_board_random( b, options.density );
+    }
+    metrics *run_metrics = create_metrics( options.metrics_path );
+    if ( !run_metrics )
+    {
+        free_board( b );
+        return EXIT_FAILURE;
+    }
+    domain_run *domains = NULL;
+    if ( options.domain_columns )
+    {
+        domains = create_domain_run( b, options.domain_columns, options.domain_rows );
+        if ( !domains )
+        {
+            destroy_metrics( run_metrics );
+            free_board( b );
+            return EXIT_FAILURE;
+        }
+    }
+    recorder *board_recorder = NULL;
+    if ( options.recording.path )
+    {
+        board_recorder = create_recorder( &options.recording, b );
+        if ( !board_recorder )
+        {
+            destroy_metrics( run_metrics );
+            free_board( b );
+            return EXIT_FAILURE;
+        }
+        record_board( board_recorder, b );
+    }
+    checkpointer *saver = options.checkpoint_path ? create_checkpointer( options.checkpoint_path, CHECKPOINT_INTERVAL_MS ) : NULL;
+    cycle_detector *detector = options.on_cycle != ON_CYCLE_IGNORE ? create_cycle_detector( ) : NULL;
+    double frequency = ( double ) SDL_GetPerformanceFrequency( );
+
+    Uint64 last_generation = b->generation + options.generations;
+    // The generations that were actually computed, fewer than requested if the run stopped or skipped at a cycle
+    int simulated = 0;
+    // The history starts with the initial board, so a cycle it is already part of starts at its generation
+    if ( detector )
+    {
+        observe_generation( detector, b );
+    }
+    Uint64 start = SDL_GetPerformanceCounter( );
+    for ( ; simulated < options.generations; simulated++ )
+    {
+        Uint64 step_start = SDL_GetPerformanceCounter( );
+        if ( domains )
+        {
+            step_domains( domains, b, 1 );
+        }
+        else
+        {
+            update_board( b );
+        }
+        generation_metrics sample = board_metrics( b, ( SDL_GetPerformanceCounter( ) - step_start ) * 1000 / frequency );
+        record_generation( run_metrics, &sample );
+        if ( board_recorder )
+        {
+            record_board( board_recorder, b );
+        }
+        if ( detector && observe_generation( detector, b ) && options.on_cycle != ON_CYCLE_REPORT )
+        {
+            if ( options.on_cycle == ON_CYCLE_SKIP )
+            {
+                fast_forward_board( detector, b, last_generation );
+                if ( board_recorder )
+                {
+                    record_board( board_recorder, b );
+                }
+            }
+            simulated++;
+            break;
+        }
+        // The board's cells are only gathered from the workers at the end
+        if ( saver && !domains )
+        {
+            checkpoint_board( saver, b );
+        }
+        if ( simulated % METRICS_FLUSH_GENERATIONS == METRICS_FLUSH_GENERATIONS - 1 )
+        {
+            flush_metrics( run_metrics );
+        }
+    }
+    double seconds = ( double ) ( SDL_GetPerformanceCounter( ) - start ) / SDL_GetPerformanceFrequency( );
+
+    if ( domains )
+    {
+        gather_domains( domains, b );
+        destroy_domain_run( domains );
+    }
+
+    bool saved = TRUE;
+    if ( saver )
+    {
+        destroy_checkpointer( saver );
+        saved = save_checkpoint( options.checkpoint_path, b );
+    }
+
+    // Avoid dividing by zero for runs too short to measure
+    double generations_per_second = seconds > 0 ? simulated / seconds : 0;
+    printf( "board:              %d x %d cells%s\n", b->rows, b->columns, arena_has_huge_pages( b->arena ) ? " ( explicit huge pages )" : "" );
+    if ( random_population )
+    {
+        printf( "seed:               %llu\n", ( unsigned long long ) options.seed );
+    }
+    char rule[ LIFE_RULE_STRING_SIZE ];
+    format_life_rule( &b->rule, rule );
+    const char *rule_name = specialized_rule_name( &b->rule );
+    printf( "rule:               %s ( %s )\n", rule, rule_name ? rule_name : "generic kernel" );
+    printf( "boundary:           %s\n", boundary_mode_name( b->boundary ) );
+    printf( "kernel:             %s\n", b->kernel->name );
+    printf( "threads:            %d\n", threads );
+    if ( options.domain_columns )
+    {
+        printf( "domains:            %d x %d worker processes\n", options.domain_columns, options.domain_rows );
+    }
+    printf( "generations:        %d ( the board is at generation %llu )\n", simulated, ( unsigned long long ) b->generation );
+    if ( detector && cycle_period( detector ) )
+    {
+        printf( "stabilized:         at generation %llu, period %llu\n", ( unsigned long long ) cycle_start( detector ),
+                ( unsigned long long ) cycle_period( detector ) );
+    }
+    else if ( detector )
+    {
+        printf( "stabilized:         no\n" );
+    }
+    printf( "seconds:            %.3f\n", seconds );
+    printf( "generations/sec:    %.1f\n", generations_per_second );
+    printf( "cells/sec:          %.4g\n", generations_per_second * b->rows * b->columns );
+    printf( "final population:   %lld\n", ( long long ) count_living_cells( b ) );
+    if ( board_recorder )
+    {
+        // Waits for the queued generations
+        destroy_recorder( board_recorder );
+    }
+    flush_metrics( run_metrics );
+    print_metrics_summary( run_metrics, stdout );
+
+    destroy_metrics( run_metrics );
+    if ( detector )
+    {
+        destroy_cycle_detector( detector );
+    }
+    free_board( b );
+    return saved ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,18 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "board.h"
+
+/*
+ * The headless mode: runs the simulation without a window as fast as it can and
+ * reports the throughput, so the engine can be measured on machines without a display.
+ */
+
+
+/**
+* Run the options that follow --batch on the command line ( argc and argv don't include the program name and --batch ).
+* Prints the usage and fails on unknown options. Returns the program's exit code.
+*/
+int run_batch( int argc, char** argv );
+
+#endif
@@ -0,0 +1,228 @@
+/**
+* Benchmarks of the board's hot paths.
+*
+* Every benchmark runs on square boards from 256^2 to 16384^2 cells and several densities with fixed seeds.
+* After warmup runs the samples are timed one by one and summarized as median, p99 and min.
+* The results are printed to stdout as JSON, the progress to stderr.
+*
+* Options:
+*   --max-size n   Skip boards with more than n rows (default 16384)
+*   --threads n    Threads that update the board (default: the number of CPUs)
+*/
+#include "../board.h"
+#include "../life_kernel.h"
+#include "../cell_renderer.h"
+
+#define BENCHMARK_SEED 20240101
+#define WARMUP_RUNS 3
+// Creating and filling a board has little to warm up and allocates the most memory
+#define INIT_WARMUP_RUNS 1
+// Every benchmark takes at least MIN_SAMPLES and at most MAX_SAMPLES samples, less on bigger boards
+#define MIN_SAMPLES 5
+#define MAX_SAMPLES 200
+#define TOGGLES_PER_SAMPLE 4096
+// The offscreen target of draw_board
+#define DRAW_WIDTH 1920
+#define DRAW_HEIGHT 1080
+#define DRAW_CELL_SIZE 4
+
+const int BOARD_SIZES[] = { 256, 1024, 4096, 16384 };
+const double DENSITIES[] = { 0.05, 0.25, 0.5 };
+
+/* The benchmarks of a case share one board, so the ones that change the board the most run last */
+typedef enum
+{
+    BENCHMARK_DRAW_BOARD,
+    BENCHMARK_TOGGLE_CELL_STATE,
+    BENCHMARK_UPDATE_BOARD,
+    BENCHMARK_INIT_BOARD,
+    BENCHMARK_KILL_ALL_CELLS,
+    BENCHMARK_COUNT
+} benchmark_id;
+
+const char *BENCHMARK_NAMES[ BENCHMARK_COUNT ] =
+{
+    "draw_board", "toggle_cell_state", "update_board", "fill_board_random", "kill_all_cells"
+};
+
+typedef struct
+{
+    int size;
+    double density;
+    int threads;
+    cell_renderer *renderer;
+    view draw_view;
+    // The cells toggle_cell_state flips
+    int *toggle_x;
+    int *toggle_y;
+} benchmark_case;
+
+double now_in_ns( void )
+{
+    return ( double ) SDL_GetPerformanceCounter( ) * 1e9 / SDL_GetPerformanceFrequency( );
+}
+
+int compare_doubles( const void *a, const void *b )
+{
+    double x = *( const double* ) a, y = *( const double* ) b;
+    return ( x > y ) - ( x < y );
+}
+
+/* Scales the number of samples down with the board's area so the big boards don't run for minutes */
+int sample_count( int size )
+{
+    int samples = ( int ) ( MAX_SAMPLES * ( 1024.0 * 1024.0 ) / ( ( double ) size * size ) );
+    return samples < MIN_SAMPLES ? MIN_SAMPLES : samples > MAX_SAMPLES ? MAX_SAMPLES : samples;
+}
+
+board* init_benchmark_board( benchmark_case *c )
+{
+    board *b = create_board( c->size, c->size );
+    set_board_thread_count( b, c->threads );
+    seed_random( BENCHMARK_SEED );
+    fill_board_random( b, c->density );
+    return b;
+}
+
+/* Runs the benchmark once and returns the time of the measured part in nanoseconds */
+double run_benchmark( benchmark_id id, benchmark_case *c, board **b )
+{
+    double start = now_in_ns( );
+    switch ( id )
+    {
+    case BENCHMARK_UPDATE_BOARD:
+        update_board( *b );
+        break;
+    case BENCHMARK_INIT_BOARD:
+        free_board( *b );
+        start = now_in_ns( );
+        *b = init_benchmark_board( c );
+        break;
+    case BENCHMARK_DRAW_BOARD:
+        // Move the camera by a cell so every sample redraws the whole view instead of only changed rows
+        c->draw_view.camera_y ^= 1;
+        start = now_in_ns( );
+        draw_board( *b, &c->draw_view, c->renderer );
+        break;
+    case BENCHMARK_KILL_ALL_CELLS:
+        kill_all_cells( *b );
+        break;
+    case BENCHMARK_TOGGLE_CELL_STATE:
+        for ( int i = 0; i < TOGGLES_PER_SAMPLE; i++ )
+        {
+            toggle_cell_state( c->toggle_x[ i ], c->toggle_y[ i ], *b );
+        }
+        break;
+    default:
+        break;
+    }
+    return now_in_ns( ) - start;
+}
+
+void print_result( benchmark_id id, benchmark_case *c, double *samples, int count, bool first )
+{
+    qsort( samples, count, sizeof( double ), compare_doubles );
+    double median = samples[ count / 2 ];
+    int p99_index = ( int ) ceil( 0.99 * count ) - 1;
+    double p99 = samples[ p99_index < 0 ? 0 : p99_index ];
+    // toggle_cell_state is reported per call
+    double per = id == BENCHMARK_TOGGLE_CELL_STATE ? TOGGLES_PER_SAMPLE : 1;
+
+    printf( "%s    {\"benchmark\": \"%s\", \"rows\": %d, \"columns\": %d, \"density\": %.2f, \"seed\": %d, "
+            "\"samples\": %d, \"unit\": \"ns\", \"median\": %.1f, \"p99\": %.1f, \"min\": %.1f}",
+            first ? "" : ",\n", BENCHMARK_NAMES[ id ], c->size, c->size, c->density, BENCHMARK_SEED,
+            count, median / per, p99 / per, samples[ 0 ] / per );
+    fflush( stdout );
+}
+
+int main( int argc, char** argv )
+{
+    int max_size = BOARD_SIZES[ SDL_arraysize( BOARD_SIZES ) - 1 ];
+    int threads = SDL_GetCPUCount( );
+    for ( int i = 1; i + 1 < argc; i += 2 )
+    {
+        if ( strcmp( argv[ i ], "--max-size" ) == 0 )
+        {
+            max_size = atoi( argv[ i + 1 ] );
+        }
+        else if ( strcmp( argv[ i ], "--threads" ) == 0 )
+        {
+            threads = atoi( argv[ i + 1 ] );
+        }
+        else
+        {
+            fprintf( stderr, "unknown option: %s\n", argv[ i ] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    // draw_board renders into a surface so no window is needed
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat( 0, DRAW_WIDTH, DRAW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888 );
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer( surface ) : NULL;
+    if ( !renderer )
+    {
+        fprintf( stderr, "error creating the offscreen renderer: %s\n", SDL_GetError( ) );
+        return EXIT_FAILURE;
+    }
+    cell_renderer *cells_renderer = create_cell_renderer( renderer );
+
+    printf( "{\n  \"kernel\": \"%s\",\n  \"threads\": %d,\n  \"warmup_runs\": %d,\n  \"results\": [\n",
+            best_life_kernel( )->name, threads, WARMUP_RUNS );
+    bool first = TRUE;
+    double *samples = malloc( MAX_SAMPLES * sizeof( double ) );
+    int *toggle_x = malloc( TOGGLES_PER_SAMPLE * sizeof( int ) );
+    int *toggle_y = malloc( TOGGLES_PER_SAMPLE * sizeof( int ) );
+
+    for ( int s = 0; s < SDL_arraysize( BOARD_SIZES ) && BOARD_SIZES[ s ] <= max_size; s++ )
+    {
+        for ( int d = 0; d < SDL_arraysize( DENSITIES ); d++ )
+        {
+            benchmark_case c = { BOARD_SIZES[ s ], DENSITIES[ d ], threads, cells_renderer };
+            c.draw_view.cell_size = DRAW_CELL_SIZE;
+            c.draw_view.cell_shift = 0;
+            c.draw_view.width_in_cells = DRAW_WIDTH / DRAW_CELL_SIZE;
+            c.draw_view.height_in_cells = DRAW_HEIGHT / DRAW_CELL_SIZE;
+            // Look at the board's center, or its top left corner if it is smaller than the view
+            c.draw_view.camera_x = SDL_max( 0, ( c.size - c.draw_view.width_in_cells ) / 2 );
+            c.draw_view.camera_y = SDL_max( 0, ( c.size - c.draw_view.height_in_cells ) / 2 );
+            c.draw_view.width_in_cells = SDL_min( c.draw_view.width_in_cells, c.size );
+            c.draw_view.height_in_cells = SDL_min( c.draw_view.height_in_cells, c.size );
+            c.toggle_x = toggle_x;
+            c.toggle_y = toggle_y;
+
+            board *b = init_benchmark_board( &c );
+            for ( int i = 0; i < TOGGLES_PER_SAMPLE; i++ )
+            {
+                toggle_x[ i ] = rand( ) % c.size;
+                toggle_y[ i ] = rand( ) % c.size;
+            }
+            for ( int id = 0; id < BENCHMARK_COUNT; id++ )
+            {
+                fprintf( stderr, "%s %dx%d density %.2f\n", BENCHMARK_NAMES[ id ], c.size, c.size, c.density );
+                // Creating a board is by far the slowest, it gets the minimum number of samples
+                int count = id == BENCHMARK_INIT_BOARD ? MIN_SAMPLES : sample_count( c.size );
+                int warmup_runs = id == BENCHMARK_INIT_BOARD ? INIT_WARMUP_RUNS : WARMUP_RUNS;
+                for ( int i = 0; i < warmup_runs; i++ )
+                {
+                    run_benchmark( id, &c, &b );
+                }
+                for ( int i = 0; i < count; i++ )
+                {
+                    samples[ i ] = run_benchmark( id, &c, &b );
+                }
+                print_result( id, &c, samples, count, first );
+                first = FALSE;
+            }
+            free_board( b );
+        }
+    }
+    printf( "\n  ]\n}\n" );
+
+    free( toggle_y );
+    free( toggle_x );
+    free( samples );
+    destroy_cell_renderer( cells_renderer );
+    SDL_DestroyRenderer( renderer );
+    SDL_FreeSurface( surface );
+    return EXIT_SUCCESS;
+}
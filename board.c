@@ -1,11 +1,32 @@
 #include "board.h"
+#include "life_kernel.h"
+#include "mapped_file.h"
+#include "cell_renderer.h"
+#include "random_generator.h"
+#include "page_arena.h"
+#include "density_pyramid.h"
 
 #define MIN_CELL_SIZE 2 
 #define MAX_CELL_SIZE 30
 #define ZOOM_OUT(n) (n < 0)
 #define ZOOM_IN(n) (n > 0)
 
-inline bool change_cell_state( int x, int y, bool state, board *b );
+
+static inline bool change_cell_state( int x, int y, bool state, board *b );
+Sint64 count_cells( const cell_word *words, Sint64 word_count );
+inline cell_word last_word_mask( int columns );
+
+/* Every tile is updated in the next generation. cells_changed is FALSE if only the rule or the boundary changed. */
+void mark_all_tiles_changed( board* b, bool cells_changed )
+{
+    memset( b->changed_tiles, TRUE, ( size_t ) b->tile_rows * b->tile_columns );
+    b->hash_valid &= !cells_changed;
+    b->edit_count++;
+    if ( cells_changed )
+    {
+        b->all_tiles_stamp = ++b->change_stamp;
+    }
+}
 
 /* Returns min or max if num is less then or greater than either of them. */
 int clamp( int min, int max, int num)
@@ -15,115 +36,835 @@ int clamp( int min, int max, int num)
     return num;
 }
 
-/* Restricts the x and y position of the camera or player view to fit into the board */
+/* Restricts the x and y position of the camera or player view to fit into the board, without a board the view is unrestricted */
 void clamp_view_pos( view *v, board *b )
 {
+    if ( !b )
+    {
+        return;
+    }
     int max_camera_x = b->columns - v->width_in_cells;
-    v->camera_x = clamp( 0, max_camera_x, v->camera_x );
+    v->camera_x = clamp( 0, max_camera_x, ( int ) v->camera_x );
 
     int max_camera_y = b->rows - v->height_in_cells;
-    v->camera_y = clamp( 0, max_camera_y, v->camera_y );
+    v->camera_y = clamp( 0, max_camera_y, ( int ) v->camera_y );
+}
+
+// The generator of populate_board and fill_board_random
+random_generator board_random;
+bool random_seeded;
+
+void seed_random( Uint64 seed )
+{
+    seed_generator( &board_random, seed, 0 );
+    random_seeded = TRUE;
+}
+
+random_generator* board_generator( void )
+{
+    if ( !random_seeded )
+    {
+        seed_random( DEFAULT_RANDOM_SEED );
+    }
+    return &board_random;
+}
+
+
+static inline int words_per_row( int columns )
+{
+    return ( columns + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+}
+
+/* 64 bit, a grid of 100k x 100k cells takes more than 2^31 bytes */
+static inline Uint64 grid_byte_size( int rows, int columns )
+{
+    return ( Uint64 ) rows * words_per_row( columns ) * sizeof( cell_word );
+}
+
+/* The arena holds both grids, the three tile flag arrays, the tile stamps and the halo rows */
+Uint64 board_arena_size( int rows, int columns )
+{
+    Uint64 tiles = ( Uint64 ) ( ( rows + TILE_ROWS - 1 ) / TILE_ROWS ) * words_per_row( columns );
+    Uint64 halo_rows = 2 * ( Uint64 ) words_per_row( columns ) * sizeof( cell_word );
+    // Every allocation may be padded to the arena's alignment
+    return 2 * grid_byte_size( rows, columns ) + 3 * tiles + tiles * sizeof( Uint64 ) + halo_rows + 7 * 64;
+}
+
+board* create_board( int rows, int columns )
+{
+    Uint64 size = board_arena_size( rows, columns );
+    if ( rows <= 0 || columns <= 0 || size > ( size_t ) -1 )
+    {
+        fprintf( stderr, "error creating a board of %d x %d cells: invalid size\n", rows, columns );
+        return NULL;
+    }
+    page_arena *arena = create_page_arena( ( size_t ) size );
+    if ( !arena )
+    {
+        fprintf( stderr, "error creating a board of %d x %d cells: it needs %.1f GiB\n", rows, columns, size / ( 1024.0 * 1024 * 1024 ) );
+        return NULL;
+    }
+    board* b = place_board( arena, rows, columns );
+    if ( !b )
+    {
+        destroy_page_arena( arena );
+        return NULL;
+    }
+    b->owns_arena = TRUE;
+    return b;
+}
+
+board* place_board( page_arena* arena, int rows, int columns )
+{
+    board* b = calloc( 1, sizeof( board ) );
+    if ( !b )
+    {
+        fprintf( stderr, "error creating a board of %d x %d cells\n", rows, columns );
+        return NULL;
+    }
+    b->arena = arena;
+    b->rows = rows;
+    b->columns = columns;
+    b->words_per_row = words_per_row( columns );
+    b->grid = arena_alloc( arena, ( size_t ) grid_byte_size( rows, columns ) );
+    b->next_grid = arena_alloc( arena, ( size_t ) grid_byte_size( rows, columns ) );
+    b->kernel = best_life_kernel( );
+    b->rule = conway_rule( );
+    b->tile_rows = ( rows + TILE_ROWS - 1 ) / TILE_ROWS;
+    b->tile_columns = b->words_per_row;
+    size_t tiles = ( size_t ) b->tile_rows * b->tile_columns;
+    b->changed_tiles = arena_alloc( arena, tiles );
+    b->next_changed_tiles = arena_alloc( arena, tiles );
+    b->active_tiles = arena_alloc( arena, tiles );
+    b->tile_stamps = arena_alloc( arena, tiles * sizeof( Uint64 ) );
+    b->halo_rows = arena_alloc( arena, 2 * ( size_t ) b->words_per_row * sizeof( cell_word ) );
+    // An arena with less than board_arena_size bytes left runs out somewhere on the way
+    if ( !b->grid || !b->next_grid || !b->changed_tiles || !b->next_changed_tiles || !b->active_tiles || !b->tile_stamps ||
+         !b->halo_rows )
+    {
+        fprintf( stderr, "error creating a board of %d x %d cells: its arena is full\n", rows, columns );
+        free( b );
+        return NULL;
+    }
+    return b;
+}
+
+board* init_board( int rows, int columns, Sint64 living_cell_count )
+{
+    board* b = create_board( rows, columns );
+    if ( b )
+    {
+        populate_board( b, living_cell_count );
+    }
+    return b;
+}
+
+void populate_board( board* b, Sint64 living_cell_count )
+{
+    random_generator *g = board_generator( );
+    Sint64 cell_count = ( Sint64 ) b->rows * b->columns;
+    living_cell_count = living_cell_count < 0 ? 0 : living_cell_count > cell_count ? cell_count : living_cell_count;
+    // Picking random cells is retried when the cell already has the wanted state. To keep that
+    // below half of the picks a board that should be mostly alive starts full and random cells are killed.
+    bool kill = living_cell_count > cell_count / 2;
+    if ( kill )
+    {
+        fill_board_random( b, 1 );
+    }
+    else
+    {
+        kill_all_cells( b );
+    }
+    b->generation = 0;
+    Sint64 changes = kill ? cell_count - living_cell_count : living_cell_count;
+    for ( Sint64 i = 0; i < changes; i++ )
+    {
+        Uint64 cell = random_below( g, ( Uint64 ) cell_count );
+        int x = ( int ) ( cell % b->columns );
+        int y = ( int ) ( cell / b->columns );
+        // Skip cells that already have the state
+        if ( cell_state( x, y, b ) != kill )
+        {
+            i--;
+            continue;
+        }
+        change_cell_state( x, y, !kill, b );
+    }
+}
+
+typedef struct
+{
+    board *b;
+    Uint32 density;
+    Uint64 seed;
+    int band_count;
+    Sint64 *band_living_cells;
+} random_fill;
+
+void fill_random_band( void* data, int band )
+{
+    random_fill *fill = data;
+    board *b = fill->b;
+    int first_row = ( int ) ( ( Sint64 ) b->rows * band / fill->band_count );
+    int last_row = ( int ) ( ( Sint64 ) b->rows * ( band + 1 ) / fill->band_count );
+    cell_word last_mask = last_word_mask( b->columns );
+    Sint64 living_cells = 0;
+    for ( int y = first_row; y < last_row; y++ )
+    {
+        // Every row has its own stream, so the cells don't depend on the number of bands
+        random_generator g;
+        seed_generator( &g, fill->seed, ( Uint64 ) y );
+        cell_word *row = b->grid + ( Sint64 ) y * b->words_per_row;
+        for ( int word = 0; word < b->words_per_row; word++ )
+        {
+            row[ word ] = random_cell_word( &g, fill->density );
+        }
+        row[ b->words_per_row - 1 ] &= last_mask;
+        living_cells += count_cells( row, b->words_per_row );
+    }
+    fill->band_living_cells[ band ] = living_cells;
+}
+
+void fill_board_random( board* b, double density )
+{
+    random_fill fill = { b, density_to_fixed( density ), next_random( board_generator( ) ), b->pool ? b->band_count : 1, NULL };
+    fill.band_living_cells = calloc( fill.band_count, sizeof( Sint64 ) );
+    if ( b->pool )
+    {
+        run_tasks( b->pool, fill_random_band, &fill, fill.band_count );
+    }
+    else
+    {
+        fill_random_band( &fill, 0 );
+    }
+    b->living_cells = 0;
+    for ( int band = 0; band < fill.band_count; band++ )
+    {
+        b->living_cells += fill.band_living_cells[ band ];
+    }
+    free( fill.band_living_cells );
+    mark_all_tiles_changed( b, TRUE );
+    b->generation = 0;
 }
 
-int random( )
+void free_board( board* b )
 {
-    static bool initialized;
-    if ( !initialized )
+    set_board_thread_count( b, 1 );
+    if ( b->owns_arena )
+    {
+        destroy_page_arena( b->arena );
+    }
+    if ( b->pyramid )
     {
-        srand( time( NULL ) );
-        initialized = TRUE;
+        destroy_density_pyramid( b->pyramid );
     }
-    int rand_val = rand( );
-    // This is not constant! RAND_MAX may vary on different systems!
-    if ( RAND_MAX < INT_MAX )
+    if ( b->mapping )
     {
-        rand_val |= rand( ) << 16;
+        unmap_file( b->mapping );
+        free( b->mapping );
     }
-    return rand_val;
+    free( b );
+}
+
+/* The number of bands per thread. More bands than threads balance out bands with different amounts of work. */
+#define BANDS_PER_THREAD 4
+
+int set_board_thread_count( board* b, int thread_count )
+{
+    destroy_thread_pool( b->pool );
+    free( b->band_living_cells );
+    free( b->band_active_tiles );
+    free( b->band_births );
+    free( b->band_hashes );
+    b->pool = NULL;
+    b->band_living_cells = NULL;
+    b->band_active_tiles = NULL;
+    b->band_births = NULL;
+    b->band_hashes = NULL;
+    b->band_count = 1;
+
+    // There is no point in having bands with less than one row of tiles
+    thread_count = clamp( 1, b->tile_rows, thread_count );
+    if ( thread_count > 1 )
+    {
+        b->pool = create_thread_pool( thread_count );
+    }
+    if ( b->pool )
+    {
+        b->band_count = clamp( 1, b->tile_rows, thread_count * BANDS_PER_THREAD );
+        b->band_living_cells = calloc( b->band_count, sizeof( Sint64 ) );
+        b->band_active_tiles = calloc( b->band_count, sizeof( int ) );
+        b->band_births = calloc( b->band_count, sizeof( Sint64 ) );
+        b->band_hashes = calloc( b->band_count, sizeof( Uint64 ) );
+    }
+    return pool_thread_count( b->pool );
+}
+
+
+/*
+ * Returns the next state of the 64 cells in the word c.
+ * The arguments are the words surrounding c: n(orth), s(outh), w(est) and e(ast).
+ * All eight neighbor counts are computed at once with bitwise adders, one bit lane per cell.
+ */
+inline cell_word next_cell_word( cell_word nw, cell_word n, cell_word ne,
+                                 cell_word w,  cell_word c, cell_word e,
+                                 cell_word sw, cell_word s, cell_word se )
+{
+    // Line the left and right neighbors of every cell up with the cell itself
+    cell_word n_left  = ( n << 1 ) | ( nw >> ( CELLS_PER_WORD - 1 ) );
+    cell_word n_right = ( n >> 1 ) | ( ne << ( CELLS_PER_WORD - 1 ) );
+    cell_word c_left  = ( c << 1 ) | ( w >> ( CELLS_PER_WORD - 1 ) );
+    cell_word c_right = ( c >> 1 ) | ( e << ( CELLS_PER_WORD - 1 ) );
+    cell_word s_left  = ( s << 1 ) | ( sw >> ( CELLS_PER_WORD - 1 ) );
+    cell_word s_right = ( s >> 1 ) | ( se << ( CELLS_PER_WORD - 1 ) );
+
+    // Sum every row of neighbors into a two bit number (full adder for the rows above and below)
+    cell_word n_ones = n_left ^ n ^ n_right;
+    cell_word n_twos = ( n_left & n ) | ( n_right & ( n_left ^ n ) );
+    cell_word c_ones = c_left ^ c_right;
+    cell_word c_twos = c_left & c_right;
+    cell_word s_ones = s_left ^ s ^ s_right;
+    cell_word s_twos = ( s_left & s ) | ( s_right & ( s_left ^ s ) );
+
+    // Add the ones, the carry goes into the twos
+    cell_word ones = n_ones ^ c_ones ^ s_ones;
+    cell_word ones_carry = ( n_ones & c_ones ) | ( s_ones & ( n_ones ^ c_ones ) );
+
+    // A cell has two or three living neighbors if exactly one of the four twos is set
+    cell_word twos_a = n_twos ^ c_twos;
+    cell_word twos_b = s_twos ^ ones_carry;
+    cell_word exactly_one_two = ( twos_a ^ twos_b ) & ~( ( n_twos & c_twos ) | ( s_twos & ones_carry ) );
+
+    // Three neighbors give birth, two neighbors keep a living cell alive
+    return exactly_one_two & ( ones | c );
 }
 
 /*
- * Returns a uniformly distributed value in the range 0 to n-1.
- * Thanks @fbartho for pointing me to uniformly distributed values.
+ * Returns the next state of the cells c given the bit planes of their neighbor counts, a cell's count is
+ * ones + 2 twos + 4 fours + 8 eights. With constant birth and survival bits only the counts of the rule are tested.
  */
-int random_uniform( int n )
+ALWAYS_INLINE cell_word select_rule_cells( cell_word ones, cell_word twos, cell_word fours, cell_word eights, cell_word c,
+                                           Uint16 birth, Uint16 survival )
+{
+    // The cells whose count is 0, 1, 2 or 3 modulo 4
+    cell_word low_0 = ~( ones | twos );
+    cell_word low_1 = ones & ~twos;
+    cell_word low_2 = twos & ~ones;
+    cell_word low_3 = ones & twos;
+    // Counts from 0 to 3 and from 4 to 7, 8 is the only count with eights set
+    cell_word below_four = ~( fours | eights );
+
+    cell_word born = ( below_four & ( ( low_0 & RULE_COUNT_MASK( birth, 0 ) ) | ( low_1 & RULE_COUNT_MASK( birth, 1 ) ) |
+                                      ( low_2 & RULE_COUNT_MASK( birth, 2 ) ) | ( low_3 & RULE_COUNT_MASK( birth, 3 ) ) ) ) |
+                     ( fours & ( ( low_0 & RULE_COUNT_MASK( birth, 4 ) ) | ( low_1 & RULE_COUNT_MASK( birth, 5 ) ) |
+                                 ( low_2 & RULE_COUNT_MASK( birth, 6 ) ) | ( low_3 & RULE_COUNT_MASK( birth, 7 ) ) ) ) |
+                     ( eights & RULE_COUNT_MASK( birth, 8 ) );
+    cell_word survived = ( below_four & ( ( low_0 & RULE_COUNT_MASK( survival, 0 ) ) | ( low_1 & RULE_COUNT_MASK( survival, 1 ) ) |
+                                          ( low_2 & RULE_COUNT_MASK( survival, 2 ) ) | ( low_3 & RULE_COUNT_MASK( survival, 3 ) ) ) ) |
+                         ( fours & ( ( low_0 & RULE_COUNT_MASK( survival, 4 ) ) | ( low_1 & RULE_COUNT_MASK( survival, 5 ) ) |
+                                     ( low_2 & RULE_COUNT_MASK( survival, 6 ) ) | ( low_3 & RULE_COUNT_MASK( survival, 7 ) ) ) ) |
+                         ( eights & RULE_COUNT_MASK( survival, 8 ) );
+    return ( born & ~c ) | ( survived & c );
+}
+
+ALWAYS_INLINE cell_word next_rule_word( cell_word nw, cell_word n, cell_word ne,
+                                        cell_word w,  cell_word c, cell_word e,
+                                        cell_word sw, cell_word s, cell_word se,
+                                        Uint16 birth, Uint16 survival )
 {
-    int rand_val;
-    do
+    // Conway's rule only needs to know whether a count is 2 or 3
+    if ( birth == CONWAY_BIRTH && survival == CONWAY_SURVIVAL )
     {
-        rand_val = random( );
+        return next_cell_word( nw, n, ne, w, c, e, sw, s, se );
     }
-    while ( rand_val >= INT_MAX - ( INT_MAX % n ) );
-    return rand_val % n ;
+    cell_word n_left  = ( n << 1 ) | ( nw >> ( CELLS_PER_WORD - 1 ) );
+    cell_word n_right = ( n >> 1 ) | ( ne << ( CELLS_PER_WORD - 1 ) );
+    cell_word c_left  = ( c << 1 ) | ( w >> ( CELLS_PER_WORD - 1 ) );
+    cell_word c_right = ( c >> 1 ) | ( e << ( CELLS_PER_WORD - 1 ) );
+    cell_word s_left  = ( s << 1 ) | ( sw >> ( CELLS_PER_WORD - 1 ) );
+    cell_word s_right = ( s >> 1 ) | ( se << ( CELLS_PER_WORD - 1 ) );
+
+    cell_word n_ones = n_left ^ n ^ n_right;
+    cell_word n_twos = ( n_left & n ) | ( n_right & ( n_left ^ n ) );
+    cell_word c_ones = c_left ^ c_right;
+    cell_word c_twos = c_left & c_right;
+    cell_word s_ones = s_left ^ s ^ s_right;
+    cell_word s_twos = ( s_left & s ) | ( s_right & ( s_left ^ s ) );
+
+    cell_word ones = n_ones ^ c_ones ^ s_ones;
+    cell_word ones_carry = ( n_ones & c_ones ) | ( s_ones & ( n_ones ^ c_ones ) );
+
+    // Add the four twos into the full count
+    cell_word twos_sum = n_twos ^ c_twos ^ s_twos;
+    cell_word twos_carry = ( n_twos & c_twos ) | ( s_twos & ( n_twos ^ c_twos ) );
+    cell_word twos = twos_sum ^ ones_carry;
+    cell_word fours_carry = twos_sum & ones_carry;
+    cell_word fours = twos_carry ^ fours_carry;
+    cell_word eights = twos_carry & fours_carry;
+    return select_rule_cells( ones, twos, fours, eights, c, birth, survival );
 }
 
+/* The loop of update_words for the rule with the given bits, see DISPATCH_LIFE_RULE */
+ALWAYS_INLINE int update_rule_words( const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                     int first_word, int last_word, int words, cell_word last_word_mask, int *births,
+                                     Uint16 birth, Uint16 survival )
+{
+    int born = 0;
+    int died = 0;
+    bool has_previous = first_word > 0;
+    cell_word nw = above && has_previous ? above[ first_word - 1 ] : 0;
+    cell_word w  = has_previous ? row[ first_word - 1 ] : 0;
+    cell_word sw = below && has_previous ? below[ first_word - 1 ] : 0;
+    cell_word n = above ? above[ first_word ] : 0;
+    cell_word c = row[ first_word ];
+    cell_word s = below ? below[ first_word ] : 0;
+    for ( int i = first_word; i < last_word; i++ )
+    {
+        bool has_next = i + 1 < words;
+        cell_word ne = above && has_next ? above[ i + 1 ] : 0;
+        cell_word e  = has_next ? row[ i + 1 ] : 0;
+        cell_word se = below && has_next ? below[ i + 1 ] : 0;
+
+        cell_word next = next_rule_word( nw, n, ne, w, c, e, sw, s, se, birth, survival );
+        // Cells past the end of the row must stay dead
+        out[ i ] = has_next ? next : next & last_word_mask;
+        born += popcount64( out[ i ] & ~c );
+        died += popcount64( c & ~out[ i ] );
 
-inline int board_byte_size( int rows, int columns )
+        nw = n; n = ne;
+        w = c;  c = e;
+        sw = s; s = se;
+    }
+    *births += born;
+    return born - died;
+}
+
+int update_words( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                  int first_word, int last_word, int words, cell_word last_word_mask, int *births )
 {
-    int size = sizeof( board ) + ( rows * columns ) / 8;
-    // Add 1 if the number of cells is not divisible by 8 (8 bits = 1 bytes)
-    size += ( rows * columns % 8 ) ? 1 : 0;
-    return size;
+#define UPDATE_RULE_WORDS( birth, survival ) \
+    return update_rule_words( above, row, below, out, first_word, last_word, words, last_word_mask, births, birth, survival )
+    DISPATCH_LIFE_RULE( rule, UPDATE_RULE_WORDS );
+#undef UPDATE_RULE_WORDS
 }
 
-board* init_board( int rows, int columns, int living_cell_count )
+Sint64 count_cells( const cell_word *words, Sint64 word_count )
 {
-    board* b = calloc( 1, board_byte_size( rows, columns ) );
-    b->rows = rows;
-    b->columns = columns;
-    // Populate the board
-    Uint32 rand_x, rand_y;
-    int bitmask;
-    for ( int i = 0; i < living_cell_count; i++ )
-    {
-        rand_x = random_uniform( columns );
-        rand_y = random_uniform( rows );
-        // Skip cells that are already alive
-        if ( cell_state( rand_x, rand_y, b ) )
+    Sint64 living_cells_count = 0;
+    for ( Sint64 i = 0; i < word_count; i++ )
+    {
+        living_cells_count += popcount64( words[ i ] );
+    }
+    return living_cells_count;
+}
+
+inline cell_word last_word_mask( int columns )
+{
+    int used_bits = columns % CELLS_PER_WORD;
+    return used_bits ? ( ( cell_word ) 1 << used_bits ) - 1 : ~( cell_word ) 0;
+}
+
+const char *boundary_names[ ] = { "dead", "torus", "klein" };
+
+bool boundary_mode_from_name( const char *name, boundary_mode *boundary )
+{
+    for ( int i = 0; i < ( int ) ( sizeof( boundary_names ) / sizeof( boundary_names[ 0 ] ) ); i++ )
+    {
+        if ( strcmp( name, boundary_names[ i ] ) == 0 )
         {
-            i--;
+            *boundary = ( boundary_mode ) i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+const char* boundary_mode_name( boundary_mode boundary )
+{
+    return boundary_names[ boundary ];
+}
+
+void set_board_rule( board* b, life_rule rule )
+{
+    b->rule = rule;
+    mark_all_tiles_changed( b, FALSE );
+}
+
+void set_board_boundary( board* b, boundary_mode boundary )
+{
+    b->boundary = boundary;
+    memset( b->halo_rows, 0, 2 * ( size_t ) b->words_per_row * sizeof( cell_word ) );
+    // The edge tiles see different neighbors now
+    mark_all_tiles_changed( b, FALSE );
+}
+
+/* Returns the word with its bits in reverse order */
+static inline cell_word reverse_bits( cell_word w )
+{
+    w = ( ( w >> 1 ) & 0x5555555555555555ULL ) | ( ( w & 0x5555555555555555ULL ) << 1 );
+    w = ( ( w >> 2 ) & 0x3333333333333333ULL ) | ( ( w & 0x3333333333333333ULL ) << 2 );
+    w = ( ( w >> 4 ) & 0x0F0F0F0F0F0F0F0FULL ) | ( ( w & 0x0F0F0F0F0F0F0F0FULL ) << 4 );
+    w = ( ( w >> 8 ) & 0x00FF00FF00FF00FFULL ) | ( ( w & 0x00FF00FF00FF00FFULL ) << 8 );
+    w = ( ( w >> 16 ) & 0x0000FFFF0000FFFFULL ) | ( ( w & 0x0000FFFF0000FFFFULL ) << 16 );
+    return ( w >> 32 ) | ( w << 32 );
+}
+
+/* Writes the row mirrored left to right into out, cell x of out is cell columns - 1 - x of the row */
+void mirror_row( const cell_word *row, cell_word *out, int columns )
+{
+    int words = words_per_row( columns );
+    // Reversing the words and their bits mirrors the padded row, the padding bits end up in front of the cells
+    for ( int i = 0; i < words; i++ )
+    {
+        out[ i ] = reverse_bits( row[ words - 1 - i ] );
+    }
+    int padding = words * CELLS_PER_WORD - columns;
+    if ( padding )
+    {
+        for ( int i = 0; i < words; i++ )
+        {
+            cell_word next = i + 1 < words ? out[ i + 1 ] : 0;
+            out[ i ] = ( out[ i ] >> padding ) | ( next << ( CELLS_PER_WORD - padding ) );
+        }
+    }
+}
+
+/* Copies the edge rows into the halo rows the way the boundary mode glues the edges together */
+void refresh_halo_rows( board* b )
+{
+    int words = b->words_per_row;
+    const cell_word *first_row = b->grid;
+    const cell_word *last_row = &b->grid[ ( Sint64 ) ( b->rows - 1 ) * words ];
+    cell_word *top = b->halo_rows;
+    cell_word *bottom = b->halo_rows + words;
+    if ( b->boundary == BOUNDARY_TORUS )
+    {
+        memcpy( top, last_row, words * sizeof( cell_word ) );
+        memcpy( bottom, first_row, words * sizeof( cell_word ) );
+    }
+    else if ( b->boundary == BOUNDARY_KLEIN_BOTTLE )
+    {
+        mirror_row( last_row, top, b->columns );
+        mirror_row( first_row, bottom, b->columns );
+    }
+}
+
+/* Whether the tile changed in the last generation, tiles beyond the edges are looked up through the boundary mode */
+static inline bool tile_changed( board* b, int tile_x, int tile_y )
+{
+    if ( b->boundary == BOUNDARY_DEAD )
+    {
+        return tile_x >= 0 && tile_y >= 0 && tile_x < b->tile_columns && tile_y < b->tile_rows &&
+               b->changed_tiles[ ( Sint64 ) tile_y*b->tile_columns + tile_x ];
+    }
+    tile_x = ( tile_x + b->tile_columns ) % b->tile_columns;
+    tile_y = ( tile_y + b->tile_rows ) % b->tile_rows;
+    return b->changed_tiles[ ( Sint64 ) tile_y*b->tile_columns + tile_x ];
+}
+
+/* The tile of the cell seen at column x of a row beyond the top or bottom edge of a Klein bottle */
+static inline int mirrored_tile( board* b, Sint64 x )
+{
+    Sint64 column = b->columns - 1 - x;
+    column = ( column % b->columns + b->columns ) % b->columns;
+    return ( int ) ( column / CELLS_PER_WORD );
+}
+
+/* Whether the tile or one of its neighbors changed in the last generation */
+bool tile_is_active( board* b, int tile_x, int tile_y )
+{
+    for ( int y = tile_y - 1; y <= tile_y + 1; y++ )
+    {
+        if ( b->boundary == BOUNDARY_KLEIN_BOTTLE && ( y < 0 || y >= b->tile_rows ) )
+        {
+            // The row of tiles beyond the edge is mirrored, look up the tiles under every neighbor column.
+            // This only happens for the first and last row of tiles.
+            int wrapped_y = ( y + b->tile_rows ) % b->tile_rows;
+            Sint64 last_column = SDL_min( ( Sint64 ) tile_x * CELLS_PER_WORD + CELLS_PER_WORD, b->columns );
+            for ( Sint64 x = ( Sint64 ) tile_x * CELLS_PER_WORD - 1; x <= last_column; x++ )
+            {
+                if ( tile_changed( b, mirrored_tile( b, x ), wrapped_y ) )
+                {
+                    return TRUE;
+                }
+            }
             continue;
         }
-        change_cell_state( rand_x, rand_y, TRUE, b );
+        for ( int x = tile_x - 1; x <= tile_x + 1; x++ )
+        {
+            if ( tile_changed( b, x, y ) )
+            {
+                return TRUE;
+            }
+        }
     }
-    return b;
+    return FALSE;
+}
+
+/* Returns the cell at column x of the row as bit 0 */
+static inline cell_word cell_bit( const cell_word *row, int x )
+{
+    return ( row[ x / CELLS_PER_WORD ] >> ( x % CELLS_PER_WORD ) ) & 1;
+}
+
+/*
+ * Rewrites out[ word ], the first or last word of a row, with the left and right edges of the rows glued together.
+ * The kernels see dead cells beyond the edges, the first cell of the row is put in front of the first word
+ * and the last cell behind the last word. Returns the change in the number of living cells and adds the change in births.
+ */
+int update_wrapped_word( board* b, const cell_word *above, const cell_word *row, const cell_word *below,
+                         cell_word *out, int word, int *births )
+{
+    int words = b->words_per_row;
+    int columns = b->columns;
+    int used_bits = columns % CELLS_PER_WORD;
+    const cell_word *rows[ 3 ] = { above, row, below };
+    cell_word west[ 3 ], center[ 3 ], east[ 3 ];
+    for ( int i = 0; i < 3; i++ )
+    {
+        const cell_word *r = rows[ i ];
+        cell_word first_cell = cell_bit( r, 0 );
+        center[ i ] = r[ word ];
+        west[ i ] = word > 0 ? r[ word - 1 ] : cell_bit( r, columns - 1 ) << ( CELLS_PER_WORD - 1 );
+        east[ i ] = word + 1 < words ? r[ word + 1 ] : used_bits ? 0 : first_cell;
+        if ( word == words - 1 && used_bits )
+        {
+            // The first cell takes the place of the padding bit right after the last cell
+            center[ i ] |= first_cell << used_bits;
+        }
+    }
+    cell_word next = next_rule_word( west[ 0 ], center[ 0 ], east[ 0 ],
+                                     west[ 1 ], center[ 1 ], east[ 1 ],
+                                     west[ 2 ], center[ 2 ], east[ 2 ], b->rule.birth, b->rule.survival );
+    if ( word == words - 1 )
+    {
+        next &= last_word_mask( columns );
+    }
+    cell_word old = out[ word ];
+    out[ word ] = next;
+    *births += popcount64( next & ~row[ word ] ) - popcount64( old & ~row[ word ] );
+    return popcount64( next ) - popcount64( old );
+}
+
+/* The hash of the word at index in the grid, the board's hash is the XOR of the hashes of all of its words */
+static inline Uint64 word_hash( cell_word word, Sint64 index )
+{
+    Uint64 h = ( word ^ ( ( Uint64 ) index * 0x9e3779b97f4a7c15ULL ) ) * 0xbf58476d1ce4e5b9ULL;
+    return h ^ ( h >> 31 );
 }
 
+/* Replaces the word at index in the board's hash */
+static inline void rehash_word( board* b, Sint64 index, cell_word old_word, cell_word new_word )
+{
+    if ( b->hash_valid )
+    {
+        b->hash ^= word_hash( old_word, index ) ^ word_hash( new_word, index );
+    }
+}
+
+Uint64 board_hash( board* b )
+{
+    if ( !b->hash_valid )
+    {
+        Sint64 words = ( Sint64 ) b->rows * b->words_per_row;
+        b->hash = 0;
+        for ( Sint64 i = 0; i < words; i++ )
+        {
+            b->hash ^= word_hash( b->grid[ i ], i );
+        }
+        b->hash_valid = TRUE;
+    }
+    return b->hash;
+}
 
-int update_board( board* b )
+/*
+ * Writes the next state of the active tiles of a row of tiles into the next grid.
+ * Adds the change in the number of living cells to living_cells_change, the born cells to births,
+ * XORs the change of the board's hash into hash ( NULL if the hash isn't kept ) and returns the number of active tiles.
+ * Only reads the current grid, so rows of tiles can be updated concurrently.
+ */
+int update_tile_row( board* b, int tile_y, Sint64 *living_cells_change, Sint64 *births, Uint64 *hash )
 {
-    // Allocate a temporary board
-    board* temp_board = malloc( board_byte_size( b->rows, b->columns ) );
-    temp_board->rows = b->rows;
-    temp_board->columns = b->columns;
+    Uint8 *active = &b->active_tiles[ ( Sint64 ) tile_y*b->tile_columns ];
+    Uint8 *next_changed = &b->next_changed_tiles[ ( Sint64 ) tile_y*b->tile_columns ];
+    Uint64 *stamps = &b->tile_stamps[ ( Sint64 ) tile_y*b->tile_columns ];
+    int active_tiles = 0;
+    for ( int tile_x = 0; tile_x < b->tile_columns; tile_x++ )
+    {
+        active[ tile_x ] = tile_is_active( b, tile_x, tile_y );
+        active_tiles += active[ tile_x ];
+        next_changed[ tile_x ] = FALSE;
+    }
+    if ( !active_tiles )
+    {
+        return 0;
+    }
 
-    int living_cells_count = 0;
-    for ( int y = 0; y < b->rows; y++ )
+    int words = b->words_per_row;
+    cell_word mask = last_word_mask( b->columns );
+    int first_row = tile_y * TILE_ROWS;
+    int last_row = clamp( 0, b->rows, first_row + TILE_ROWS );
+    for ( int y = first_row; y < last_row; y++ )
     {
-        for ( int x = 0; x < b->columns; x++ )
+        // The edge rows see the halo rows, so the kernels update them at full speed as well
+        const cell_word *row = &b->grid[ ( Sint64 ) y * words ];
+        const cell_word *above = y > 0 ? row - words : b->halo_rows;
+        const cell_word *below = y + 1 < b->rows ? row + words : b->halo_rows + words;
+        cell_word *out = &b->next_grid[ ( Sint64 ) y * words ];
+        // The kernels count in ints, a row has fewer than 2^31 cells
+        int row_change = 0;
+        int row_births = 0;
+
+        // Update runs of neighboring active tiles at once so the vector kernels get long rows
+        int tile_x = 0;
+        while ( tile_x < b->tile_columns )
         {
-            if ( change_cell_state( x, y, updated_cell_state( x, y, b ), temp_board ) )
+            if ( !active[ tile_x ] )
             {
-                living_cells_count++;
+                tile_x++;
+                continue;
             }
+            int run_end = tile_x;
+            while ( run_end < b->tile_columns && active[ run_end ] )
+            {
+                run_end++;
+            }
+            row_change += b->kernel->update_words( &b->rule, above, row, below, out, tile_x, run_end, words, mask, &row_births );
+            if ( b->boundary != BOUNDARY_DEAD )
+            {
+                // Only the first and last word of a row see cells across the left and right edges
+                if ( tile_x == 0 )
+                {
+                    row_change += update_wrapped_word( b, above, row, below, out, 0, &row_births );
+                }
+                if ( run_end == words && words > 1 )
+                {
+                    row_change += update_wrapped_word( b, above, row, below, out, words - 1, &row_births );
+                }
+            }
+            if ( !hash )
+            {
+                for ( ; tile_x < run_end; tile_x++ )
+                {
+                    next_changed[ tile_x ] |= out[ tile_x ] != row[ tile_x ];
+                }
+                continue;
+            }
+            // Kept in a local, the stores into next_changed could change *hash as far as the compiler knows
+            Uint64 run_hash = 0;
+            for ( ; tile_x < run_end; tile_x++ )
+            {
+                cell_word old_word = row[ tile_x ];
+                cell_word new_word = out[ tile_x ];
+                next_changed[ tile_x ] |= new_word != old_word;
+                if ( new_word != old_word )
+                {
+                    run_hash ^= word_hash( old_word, ( Sint64 ) y * words + tile_x ) ^ word_hash( new_word, ( Sint64 ) y * words + tile_x );
+                }
+            }
+            *hash ^= run_hash;
         }
+        *living_cells_change += row_change;
+        *births += row_births;
+    }
+    // update_board moves change_stamp on once all rows are done
+    for ( int tile_x = 0; tile_x < b->tile_columns; tile_x++ )
+    {
+        if ( next_changed[ tile_x ] )
+        {
+            stamps[ tile_x ] = b->change_stamp + 1;
+        }
+    }
+    return active_tiles;
+}
+
+void update_band( void* data, int band )
+{
+    board* b = data;
+    int first_tile_row = ( int ) ( ( Sint64 ) b->tile_rows * band / b->band_count );
+    int last_tile_row = ( int ) ( ( Sint64 ) b->tile_rows * ( band + 1 ) / b->band_count );
+    b->band_living_cells[ band ] = 0;
+    b->band_active_tiles[ band ] = 0;
+    b->band_births[ band ] = 0;
+    b->band_hashes[ band ] = 0;
+    for ( int tile_y = first_tile_row; tile_y < last_tile_row; tile_y++ )
+    {
+        b->band_active_tiles[ band ] += update_tile_row( b, tile_y, &b->band_living_cells[ band ], &b->band_births[ band ],
+                                                       b->hash_valid ? &b->band_hashes[ band ] : NULL );
     }
+}
 
-    // Copy the temporary board into the given board
-    memcpy( b, temp_board, board_byte_size( b->rows, b->columns) );
-    free( temp_board );
-    return living_cells_count;
+Sint64 count_living_cells( board* b )
+{
+    return b->kernel->count_cells( b->grid, ( Sint64 ) b->rows * b->words_per_row );
 }
 
-inline bool pos_in_board( int x, int y, board *b )
+int active_tile_count( board* b )
+{
+    return b->active_tile_count;
+}
+
+Sint64 update_board( board* b )
+{
+    b->active_tile_count = 0;
+    b->births = 0;
+    Sint64 living_cells = b->living_cells;
+    refresh_halo_rows( b );
+    if ( b->pool )
+    {
+        run_tasks( b->pool, update_band, b, b->band_count );
+        for ( int band = 0; band < b->band_count; band++ )
+        {
+            b->living_cells += b->band_living_cells[ band ];
+            b->active_tile_count += b->band_active_tiles[ band ];
+            b->births += b->band_births[ band ];
+            b->hash ^= b->band_hashes[ band ];
+        }
+    }
+    else
+    {
+        for ( int tile_y = 0; tile_y < b->tile_rows; tile_y++ )
+        {
+            b->active_tile_count += update_tile_row( b, tile_y, &b->living_cells, &b->births, b->hash_valid ? &b->hash : NULL );
+        }
+    }
+    b->deaths = b->births - ( b->living_cells - living_cells );
+
+    // The next generation becomes the current one, the old one is overwritten by the next update
+    cell_word *old_grid = b->grid;
+    b->grid = b->next_grid;
+    b->next_grid = old_grid;
+    Uint8 *old_changed_tiles = b->changed_tiles;
+    b->changed_tiles = b->next_changed_tiles;
+    b->next_changed_tiles = old_changed_tiles;
+    b->change_stamp++;
+    b->generation++;
+    return b->living_cells;
+}
+
+static inline bool pos_in_board( int x, int y, board *b )
 {
     return x >= 0 && y >= 0 && x < b->columns && y < b->rows;
 }
 
-/* Return the bitmask for the cell at location (x, y). */
-inline int cell_bitmask( int x, int y, board *b )
+/* Return the bitmask for the cell at location (x, y) within its word. */
+static inline cell_word cell_bitmask( int x )
+{
+    return ( cell_word ) 1 << ( x % CELLS_PER_WORD );
+}
+
+static inline void mark_tile_changed( int x, int y, board *b )
 {
-    return ( int ) powf( 2, ( y*b->columns + x ) % 8 );
+    Sint64 tile = ( Sint64 ) ( y / TILE_ROWS )*b->tile_columns + x / CELLS_PER_WORD;
+    b->changed_tiles[ tile ] = TRUE;
+    b->tile_stamps[ tile ] = ++b->change_stamp;
+    b->edit_count++;
+}
+
+/* Return the word that holds the cell at location (x, y). */
+static inline cell_word *cell_word_at( int x, int y, board *b )
+{
+    return &b->grid[ ( Sint64 ) y*b->words_per_row + x / CELLS_PER_WORD ];
 }
 
 inline bool cell_state( int x, int y, board* b )
@@ -132,21 +873,38 @@ inline bool cell_state( int x, int y, board* b )
     {
         return FALSE;
     }
-    int bitmask = cell_bitmask( x, y, b);
-    int cell_states = b->grid[ ( ( y*b->columns + x ) / 8 ) ];
-    return ( cell_states & bitmask ) != 0;
+    return ( *cell_word_at( x, y, b ) & cell_bitmask( x ) ) != 0;
 }
 
-inline int living_neighbors( int x, int y, board *b )
+/* The state of the cell at x, y where cells beyond the edges are looked up through the board's boundary mode */
+static inline bool neighbor_state( int x, int y, board* b )
 {
-    return cell_state( x - 1, y - 1, b ) +
-           cell_state( x    , y - 1, b ) +
-           cell_state( x + 1, y - 1, b ) +
-           cell_state( x - 1, y    , b ) +
-           cell_state( x + 1, y    , b ) +
-           cell_state( x - 1, y + 1, b ) +
-           cell_state( x    , y + 1, b ) +
-           cell_state( x + 1, y + 1, b );
+    if ( b->boundary == BOUNDARY_DEAD )
+    {
+        return cell_state( x, y, b );
+    }
+    if ( y < 0 || y >= b->rows )
+    {
+        y = ( y + b->rows ) % b->rows;
+        if ( b->boundary == BOUNDARY_KLEIN_BOTTLE )
+        {
+            x = b->columns - 1 - x;
+        }
+    }
+    x = ( x % b->columns + b->columns ) % b->columns;
+    return cell_state( x, y, b );
+}
+
+static inline int living_neighbors( int x, int y, board *b )
+{
+    return neighbor_state( x - 1, y - 1, b ) +
+           neighbor_state( x    , y - 1, b ) +
+           neighbor_state( x + 1, y - 1, b ) +
+           neighbor_state( x - 1, y    , b ) +
+           neighbor_state( x + 1, y    , b ) +
+           neighbor_state( x - 1, y + 1, b ) +
+           neighbor_state( x    , y + 1, b ) +
+           neighbor_state( x + 1, y + 1, b );
 }
 
 void toggle_cell_state( int x, int y, board *b )
@@ -154,81 +912,222 @@ void toggle_cell_state( int x, int y, board *b )
     change_cell_state( x, y, !cell_state( x, y, b ), b );
 }
 
+void set_cells_alive( int x, int y, int count, board *b )
+{
+    // Clip the run to the board
+    if ( y < 0 || y >= b->rows )
+    {
+        return;
+    }
+    if ( x < 0 )
+    {
+        count += x;
+        x = 0;
+    }
+    count = count < b->columns - x ? count : b->columns - x;
+
+    // Set the run's bits one word at a time
+    while ( count > 0 )
+    {
+        int bit = x % CELLS_PER_WORD;
+        int bits = count < CELLS_PER_WORD - bit ? count : CELLS_PER_WORD - bit;
+        cell_word run = bits == CELLS_PER_WORD ? ~( cell_word ) 0 : ( ( cell_word ) 1 << bits ) - 1;
+        cell_word *word = cell_word_at( x, y, b );
+        cell_word born = ( run << bit ) & ~*word;
+        if ( born )
+        {
+            rehash_word( b, cell_word_at( x, y, b ) - b->grid, *word, *word | born );
+            *word |= born;
+            b->living_cells += popcount64( born );
+            mark_tile_changed( x, y, b );
+        }
+        x += bits;
+        count -= bits;
+    }
+}
+
 inline bool updated_cell_state( int x, int y, board* b )
 {
     // Count the living neighbors
     int living_neighbor_cells =  living_neighbors( x, y, b );
 
     // Return the new state of the cell at position board[x][y]
-    return ( living_neighbor_cells == 3 || ( cell_state( x, y, b ) && ( living_neighbor_cells == 2 ) ) );
+    return next_cell_state( &b->rule, cell_state( x, y, b ), living_neighbor_cells );
 }
 
 
-inline bool change_cell_state( int x, int y, bool state, board *b )
+static inline bool change_cell_state( int x, int y, bool state, board *b )
 {
     if ( !pos_in_board( x, y, b ) )
     {
         return FALSE;
     }
-    int bitmask = cell_bitmask( x, y, b );
-    if ( state )
+    if ( cell_state( x, y, b ) != state )
     {
-        return b->grid[ ( y*b->columns + x ) / 8 ] |= bitmask;
+        cell_word *word = cell_word_at( x, y, b );
+        rehash_word( b, word - b->grid, *word, *word ^ cell_bitmask( x ) );
+        *word ^= cell_bitmask( x );
+        b->living_cells += state ? 1 : -1;
+        // The tile differs from the other buffer now, so it and its neighbors have to be updated
+        mark_tile_changed( x, y, b );
     }
-    return b->grid[ ( y*b->columns + x ) / 8 ] &= ~bitmask;
+    return state;
 }
 
 
-void draw_board( board* b, view *player_view, SDL_Renderer* renderer )
+/* Returns the 64 cells of the row that start at x, cells outside of the row are dead */
+static inline cell_word cells_at( const cell_word *row, int word_count, Sint64 x )
 {
-    Uint8 red_channel, green_channel, blue_channel;
-    bool current_cell_alive;
-    SDL_Rect rectangle;
-    rectangle.w = rectangle.h = player_view->cell_size;
+    Sint64 word = x >= 0 ? x / CELLS_PER_WORD : -( ( CELLS_PER_WORD - 1 - x ) / CELLS_PER_WORD );
+    int shift = ( int ) ( x - word * CELLS_PER_WORD );
+    cell_word low = word >= 0 && word < word_count ? row[ word ] : 0;
+    if ( !shift )
+    {
+        return low;
+    }
+    cell_word high = word + 1 >= 0 && word + 1 < word_count ? row[ word + 1 ] : 0;
+    return ( low >> shift ) | ( high << ( CELLS_PER_WORD - shift ) );
+}
 
-    // Iterate over all cells in the view and draw them to the renderer
-    int screenHeight, screenWidth;
-    SDL_GetRendererOutputSize( renderer, &screenWidth, &screenHeight );
-    for ( int row = 0; row < player_view->height_in_cells; row++ )
+void read_board_row( void* source, Sint64 x, Sint64 y, int width, cell_word* out )
+{
+    board *b = source;
+    int words = ( width + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    if ( y < 0 || y >= b->rows )
+    {
+        memset( out, 0, words * sizeof( cell_word ) );
+        return;
+    }
+    const cell_word *row = b->grid + y*b->words_per_row;
+    for ( int i = 0; i < words; i++ )
+    {
+        out[ i ] = cells_at( row, b->words_per_row, x + i*CELLS_PER_WORD );
+    }
+}
+
+void read_board_density_row( void* source, int level, Sint64 x, Sint64 y, int width, Uint8* out )
+{
+    board *b = source;
+    if ( b->pyramid && level >= PYRAMID_FIRST_LEVEL )
     {
-        for ( int column = 0; column < player_view->width_in_cells; column++ )
+        read_pyramid_row( b->pyramid, level, x, y, width, out );
+        return;
+    }
+    // Count every cell of the blocks, fine for the small blocks of the levels the pyramid doesn't store.
+    // A block is counted row by row before the next one, so its count needs no buffer. Its few rows stay in the cache.
+    Sint64 block_size = ( Sint64 ) 1 << level;
+    Sint64 first_row = y * block_size > 0 ? y * block_size : 0;
+    Sint64 end_row = ( y + 1 ) * block_size < b->rows ? ( y + 1 ) * block_size : b->rows;
+    for ( int i = 0; i < width; i++ )
+    {
+        Uint64 count = 0;
+        Sint64 first = ( x + i ) * block_size;
+        if ( first >= b->columns || first + block_size <= 0 )
+        {
+            out[ i ] = block_density( 0, level );
+            continue;
+        }
+        for ( Sint64 row_y = first_row; row_y < end_row; row_y++ )
         {
-            current_cell_alive = cell_state( column + player_view->camera_x, row + player_view->camera_y, b );
+            const cell_word *row = b->grid + row_y * b->words_per_row;
+            for ( Sint64 cell = first; cell < first + block_size; cell += CELLS_PER_WORD )
+            {
+                cell_word word = cells_at( row, b->words_per_row, cell );
+                count += popcount64( block_size < CELLS_PER_WORD ? word & ( ( ( cell_word ) 1 << block_size ) - 1 ) : word );
+            }
+        }
+        out[ i ] = block_density( count, level );
+    }
+}
 
-            red_channel   = current_cell_alive ? LIVING_CELL_R : DEAD_CELL_R;
-            green_channel = current_cell_alive ? LIVING_CELL_G : DEAD_CELL_G;
-            blue_channel  = current_cell_alive ? LIVING_CELL_B : DEAD_CELL_B;
+void write_board_row( board* b, int x, int y, int width, const cell_word* cells )
+{
+    paste_board_row( b, x, y, width, cells, PASTE_REPLACE );
+}
 
-            SDL_SetRenderDrawColor( renderer, red_channel, green_channel, blue_channel, 255 );
-            rectangle.x = column*player_view->cell_size;
-            rectangle.y = row*player_view->cell_size;
-            SDL_RenderDrawRect( renderer, &rectangle );
+void paste_board_row( board* b, int x, int y, int width, const cell_word* cells, paste_mode mode )
+{
+    int first = x > 0 ? x : 0;
+    int end = x + width < b->columns ? x + width : b->columns;
+    if ( y < 0 || y >= b->rows || first >= end )
+    {
+        return;
+    }
+    int cell_words = ( width + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    cell_word *row = b->grid + ( Sint64 ) y*b->words_per_row;
+    for ( int word = first / CELLS_PER_WORD; word <= ( end - 1 ) / CELLS_PER_WORD; word++ )
+    {
+        int word_start = word * CELLS_PER_WORD;
+        // The bits of the word that are written
+        int low = first > word_start ? first - word_start : 0;
+        int high = end < word_start + CELLS_PER_WORD ? end - word_start : CELLS_PER_WORD;
+        cell_word mask = ( high == CELLS_PER_WORD ? ~( cell_word ) 0 : ( ( cell_word ) 1 << high ) - 1 ) & ~( ( ( cell_word ) 1 << low ) - 1 );
+        cell_word pasted = cells ? cells_at( cells, cell_words, ( Sint64 ) word_start - x ) & mask : 0;
+        cell_word next = mode == PASTE_REPLACE ? ( row[ word ] & ~mask ) | pasted
+                       : mode == PASTE_OR      ? row[ word ] | pasted
+                                               : row[ word ] ^ pasted;
+        if ( next != row[ word ] )
+        {
+            rehash_word( b, row + word - b->grid, row[ word ], next );
+            b->living_cells += popcount64( next ) - popcount64( row[ word ] );
+            row[ word ] = next;
+            mark_tile_changed( word_start, y, b );
         }
     }
-    // Draw the renderer to the screen
-    SDL_RenderPresent( renderer );
+}
+
+void draw_board( board* b, view *player_view, cell_renderer* renderer )
+{
+    if ( player_view->cell_shift )
+    {
+        render_density( renderer, player_view, read_board_density_row, b );
+    }
+    else
+    {
+        render_cells( renderer, player_view, read_board_row, b );
+    }
 }
 
 void kill_all_cells( board * b )
 {
-    memset( ( char* ) b + sizeof( board ), 0, board_byte_size( b->rows, b->columns ) - sizeof( board ) );
+    memset( b->grid, 0, ( size_t ) grid_byte_size( b->rows, b->columns ) );
+    mark_all_tiles_changed( b, TRUE );
+    b->living_cells = 0;
+}
+
+void load_board_grid( board* b, const cell_word* grid )
+{
+    memcpy( b->grid, grid, ( size_t ) grid_byte_size( b->rows, b->columns ) );
+    mark_all_tiles_changed( b, TRUE );
+    b->living_cells = count_living_cells( b );
+}
+
+void use_board_grid( board* b, cell_word* grid )
+{
+    b->grid = grid;
+    mark_all_tiles_changed( b, TRUE );
+    b->living_cells = count_living_cells( b );
 }
 
-inline bool camera_in_bounds( view *v, board* b )
+static inline bool camera_in_bounds( view *v, board* b )
 {
+    if ( !b )
+    {
+        return TRUE;
+    }
     bool x_in_boundaries = v->camera_x >= 0 && ( v->camera_x <= b->columns - v->width_in_cells );
     bool y_in_boundaries = v->camera_y >= 0 && ( v->camera_y <= b->rows - v->height_in_cells );
     return x_in_boundaries && y_in_boundaries;
 }
 
-inline void get_view_center( view *v, int *x, int *y )
+static inline void get_view_center( view *v, Sint64 *x, Sint64 *y )
 {
     *x = v->camera_x + v->width_in_cells / 2;
     *y = v->camera_y + v->height_in_cells / 2;
 }
 
 /* Sets the pos of the view so that the view's center is at the given position */
-inline void set_view_pos_to_center( int x, int y, view *v )
+static inline void set_view_pos_to_center( Sint64 x, Sint64 y, view *v )
 {
     v->camera_x = x - ( v->width_in_cells / 2 );
     v->camera_y = y - ( v->height_in_cells / 2 );
@@ -240,32 +1139,51 @@ inline void set_view_pos_to_center( int x, int y, view *v )
 */
 void resize_board_view( int zoom, view* player_view, board* world )
 {
-    if ( !( player_view->cell_size > MIN_CELL_SIZE && ZOOM_OUT( zoom ) ||
+    // Below MIN_CELL_SIZE there are boards only, zooming out stops once the whole board is visible
+    bool whole_board_visible = world && player_view->width_in_cells >= world->columns && player_view->height_in_cells >= world->rows;
+    bool shift_in = ZOOM_IN( zoom ) && player_view->cell_shift > 0;
+    bool shift_out = ZOOM_OUT( zoom ) && player_view->cell_size <= MIN_CELL_SIZE && world && !whole_board_visible;
+    if ( !( shift_in || shift_out || player_view->cell_size > MIN_CELL_SIZE && ZOOM_OUT( zoom ) ||
           ( player_view->cell_size < MAX_CELL_SIZE && ZOOM_IN( zoom ) ) ) )
     {
         return;
     }
 
     // Update the view
-    int old_center_x, old_center_y;
+    Sint64 old_center_x, old_center_y;
     get_view_center( player_view, &old_center_x, &old_center_y );
 
-    player_view->cell_size += zoom;
-    player_view->height_in_cells = player_view->window_height / player_view->cell_size;
-    player_view->width_in_cells = player_view->window_width / player_view->cell_size;
+    if ( shift_in )
+    {
+        player_view->cell_shift--;
+    }
+    else if ( shift_out && player_view->cell_size > 1 )
+    {
+        player_view->cell_size = 1;
+    }
+    else if ( shift_out )
+    {
+        player_view->cell_shift++;
+    }
+    else
+    {
+        player_view->cell_size += zoom;
+    }
+    player_view->height_in_cells = ( player_view->window_height / player_view->cell_size ) << player_view->cell_shift;
+    player_view->width_in_cells = ( player_view->window_width / player_view->cell_size ) << player_view->cell_shift;
     // Center the camera if the view is bigger then the board
-    int new_center_y = player_view->height_in_cells > world->rows ? world->rows / 2 : old_center_y;
-    int new_center_x = player_view->width_in_cells > world->columns ? world->columns / 2 : old_center_x;
+    Sint64 new_center_y = world && player_view->height_in_cells > world->rows ? world->rows / 2 : old_center_y;
+    Sint64 new_center_x = world && player_view->width_in_cells > world->columns ? world->columns / 2 : old_center_x;
 
     set_view_pos_to_center( new_center_x, new_center_y, player_view );
 
     // Change the movement speed in cells (Don't allow it to be zero)
-    player_view->movement_speed_in_cells = player_view->min_movement_speed_in_pixels / player_view->cell_size;
+    player_view->movement_speed_in_cells = ( player_view->min_movement_speed_in_pixels / player_view->cell_size ) << player_view->cell_shift;
     player_view->movement_speed_in_cells = player_view->movement_speed_in_cells ? player_view->movement_speed_in_cells : 1;
 
     // Change the camera position to fit into the board
     // clamp_view_pos( player_view, world );
-    if ( !( player_view->height_in_cells > world->rows || player_view->width_in_cells > world->columns ) )
+    if ( world && !( player_view->height_in_cells > world->rows || player_view->width_in_cells > world->columns ) )
     {
         clamp_view_pos( player_view, world );
     }
@@ -11,6 +11,8 @@
 #include <stdlib.h>
 
 #include "SDL.h"
+#include "thread_pool.h"
+#include "life_rule.h"
 
 #define FALSE 0
 #define TRUE 1
@@ -24,18 +26,117 @@
 
 typedef Uint8 bool;
 
+/* The cells of a board are packed into 64 bit words, one bit per cell. */
+typedef Uint64 cell_word;
+#define CELLS_PER_WORD 64
+// The board is split into tiles that are one word wide and TILE_ROWS rows high
+#define TILE_ROWS 64
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define popcount64( w ) ( ( int ) __popcnt64( w ) )
+#else
+#define popcount64( w ) __builtin_popcountll( w )
+#endif
+
+struct life_kernel;
+struct mapped_file;
+struct cell_renderer;
+struct page_arena;
+struct density_pyramid;
+
+/* What the cells at the edges of a board see beyond the edge. */
+typedef enum
+{
+    // The cells beyond the edges are dead
+    BOUNDARY_DEAD,
+    // The left edge is glued to the right edge and the top edge to the bottom edge
+    BOUNDARY_TORUS,
+    // Like the torus, but the top and bottom edges are glued together mirrored left to right
+    BOUNDARY_KLEIN_BOTTLE
+} boundary_mode;
+
+/* How cells that are pasted into a board are combined with the board's cells. */
+typedef enum
+{
+    // The pasted cells replace the board's cells, dead ones included
+    PASTE_REPLACE,
+    // Living pasted cells bring the board's cells to life, the other cells stay as they are
+    PASTE_OR,
+    // Living pasted cells invert the board's cells
+    PASTE_XOR
+} paste_mode;
+
 typedef struct
 {
     int rows;
     int columns;
-    bool grid[ 0 ];
+    // Every row starts at a word boundary. The unused bits of a row's last word are always zero.
+    int words_per_row;
+    // The current generation and the buffer the next generation is written into.
+    // Both point into arena ( or one into mapping ) and are swapped after every update.
+    cell_word *grid;
+    cell_word *next_grid;
+    // Only tiles that changed in the last generation ( or were edited ) and their neighbors are updated.
+    // The other tiles are the same in both buffers.
+    int tile_rows;
+    int tile_columns;
+    Uint8 *changed_tiles;
+    Uint8 *next_changed_tiles;
+    Uint8 *active_tiles;
+    int active_tile_count;
+    boundary_mode boundary;
+    life_rule rule;
+    // The rows above the first and below the last row, the board's edge rows as the boundary mode sees them.
+    // Refreshed before every update, always zero for BOUNDARY_DEAD.
+    cell_word *halo_rows;
+    // 64 bit, big boards have more than 2^31 cells
+    Sint64 living_cells;
+    // The cells that were born and died in the last update
+    Sint64 births;
+    Sint64 deaths;
+    // The number of updates since the board was populated
+    Uint64 generation;
+    // The XOR of the hashes of every word of the grid, see board_hash. Once it is valid update_board and the cell edits
+    // update it with the words they change, bulk changes clear hash_valid and the next board_hash recomputes it.
+    Uint64 hash;
+    bool hash_valid;
+    // Counts the changes that weren't made by update_board, so a history of generations can tell it no longer holds
+    Uint64 edit_count;
+    // Every update and edit that changes a tile's cells sets its stamp to the next change_stamp, bulk changes set
+    // all_tiles_stamp instead. Whatever is kept up to date with the cells ( the density pyramid, the history ) remembers
+    // change_stamp and later only looks at the tiles whose stamps are newer.
+    Uint64 *tile_stamps;
+    Uint64 change_stamp;
+    Uint64 all_tiles_stamp;
+    // The rows of tiles are split into bands that are updated in parallel if there is a pool.
+    thread_pool *pool;
+    int band_count;
+    Sint64 *band_living_cells;
+    int *band_active_tiles;
+    Sint64 *band_births;
+    Uint64 *band_hashes;
+    // The (possibly vectorized) code the rows are updated with
+    const struct life_kernel *kernel;
+    // The checkpoint file the board was restored from, its copy on write mapping is used as one of the grids. NULL if there is none.
+    struct mapped_file *mapping;
+    // Holds the grids, the tile flags and the halo rows
+    struct page_arena *arena;
+    // Whether free_board unmaps the arena, FALSE for boards placed into an arena that holds several boards
+    bool owns_arena;
+    // The living cells in blocks of the board for zoomed out views, NULL if they aren't counted.
+    // Whoever updates the board keeps it up to date, free_board frees it.
+    struct density_pyramid *pyramid;
 } board;
 
 typedef struct
 {
-    int camera_x;
-    int camera_y;
+    // 64 bit so the view can move around an unbounded universe
+    Sint64 camera_x;
+    Sint64 camera_y;
     int cell_size;
+    // Zoomed out below one pixel per cell every pixel shows the density of 2^cell_shift x 2^cell_shift cells, cell_size is 1 then
+    int cell_shift;
     int height_in_cells;
     int width_in_cells;
     int window_height;
@@ -50,12 +151,136 @@ typedef struct
 * Initialize a board with a given size and a given number of
 * living cells.
 */
-board* init_board( int rows, int columns, int living_cell_count );
+board* init_board( int rows, int columns, Sint64 living_cell_count );
+
+/**
+* Allocate a board with the given size in which all cells are dead.
+* Prints an error and returns NULL if the board doesn't fit into memory.
+*/
+board* create_board( int rows, int columns );
+
+/**
+* Allocate a board in which all cells are dead from an arena that holds several boards, the arena needs
+* board_arena_size( rows, columns ) bytes for it. free_board leaves the arena alone.
+* Prints an error and returns NULL if the board doesn't fit into what is left of the arena.
+*/
+board* place_board( struct page_arena* arena, int rows, int columns );
+
+/**
+* Return the number of bytes of an arena a board of the given size needs.
+*/
+Uint64 board_arena_size( int rows, int columns );
+
+/**
+* Kill all cells in the given board and bring the given number of random cells to life.
+* The board's buffers are reused.
+*/
+void populate_board( board* b, Sint64 living_cell_count );
+
+/**
+* Kill all cells in the given board and bring every cell to life with the given probability.
+* Unlike populate_board the number of living cells isn't exact, but whole words are generated at once
+* and the rows are split between the board's threads. The cells only depend on the seed, not on the threads.
+*/
+void fill_board_random( board* b, double density );
+
+/**
+* Seed the random numbers populate_board and fill_board_random use. Without a call they are seeded with DEFAULT_RANDOM_SEED.
+*/
+void seed_random( Uint64 seed );
+
+/**
+* Free a board returned by init_board.
+*/
+void free_board( board* b );
 
 /**
 * Update the board's state and return the number of living cells.
 */
-int update_board( board* b );
+Sint64 update_board( board* b );
+
+/**
+* Set the number of threads update_board uses. 1 updates the board on the calling thread.
+* Returns the number of threads that are actually used.
+*/
+int set_board_thread_count( board* b, int thread_count );
+
+/**
+* Set what the cells at the edges of the board see beyond the edge. All tiles are updated in the next generation.
+*/
+void set_board_boundary( board* b, boundary_mode boundary );
+
+/**
+* Set the rule the board is updated with. All tiles are updated in the next generation.
+*/
+void set_board_rule( board* b, life_rule rule );
+
+/**
+* Parse "dead", "torus" or "klein" into boundary, returns FALSE if the name is none of them.
+*/
+bool boundary_mode_from_name( const char *name, boundary_mode *boundary );
+
+/**
+* Return the name boundary_mode_from_name accepts for the boundary mode.
+*/
+const char* boundary_mode_name( boundary_mode boundary );
+
+/**
+* Return the number of living cells in the board.
+*/
+Sint64 count_living_cells( board* b );
+
+/**
+* Return the number of tiles that were updated by the last call to update_board.
+*/
+int active_tile_count( board* b );
+
+/**
+* Return a 64 bit hash of the board's cells. Boards with the same size and cells have the same hash.
+* The first call and the first call after a bulk change ( e.g. kill_all_cells ) hash the whole grid, in between
+* the hash is kept up to date with the words that change. Boards that are never hashed don't pay for it.
+*/
+Uint64 board_hash( board* b );
+
+/**
+* Write the next state under the rule of the words first_word to last_word - 1 of a row into out, add the number of
+* cells that were born in them to births and return the change in the number of living cells.
+* above and below are the neighboring rows and may be NULL at the edges of the board. words is the length
+* of the rows and last_word_mask has the bits of the row's last word set that belong to cells.
+*/
+int update_words( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                  int first_word, int last_word, int words, cell_word last_word_mask, int *births );
+
+/**
+* Return the next state of the 64 cells in the word c given the words around it,
+* n(orth), s(outh), w(est) and e(ast). Bit k of a word is the cell k columns right of the word's first cell.
+*/
+cell_word next_cell_word( cell_word nw, cell_word n, cell_word ne,
+                          cell_word w,  cell_word c, cell_word e,
+                          cell_word sw, cell_word s, cell_word se );
+
+/**
+* Like next_cell_word, but for the rule with the given birth and survival bits ( see life_rule ).
+*/
+cell_word next_rule_word( cell_word nw, cell_word n, cell_word ne,
+                          cell_word w,  cell_word c, cell_word e,
+                          cell_word sw, cell_word s, cell_word se,
+                          Uint16 birth, Uint16 survival );
+
+/**
+* Return the number of set bits in the given words.
+*/
+Sint64 count_cells( const cell_word *words, Sint64 word_count );
+
+/**
+* Return a mask of the bits in a row's last word that belong to cells.
+*/
+cell_word last_word_mask( int columns );
+
+/**
+* Write the row of columns cells mirrored left to right into out, cell x of out is cell columns - 1 - x of the row.
+*/
+void mirror_row( const cell_word* row, cell_word* out, int columns );
 
 /**
 * Return the state of the cell at location x, y in the given board
@@ -63,7 +288,8 @@ int update_board( board* b );
 bool cell_state( int x, int y, board* b );
 
 /**
-* Return the updated state of the cell at location x, y in the given board
+* Return the updated state of the cell at location x, y in the given board. The neighbors
+* beyond the edges are taken from the board's boundary mode.
 */
 bool updated_cell_state( int x, int y, board* b );
 
@@ -72,19 +298,63 @@ bool updated_cell_state( int x, int y, board* b );
 */
 void toggle_cell_state( int x, int y, board *b );
 
+/**
+* Bring the count cells from x, y to the right to life. Cells outside of the board are ignored.
+*/
+void set_cells_alive( int x, int y, int count, board *b );
+
 /** 
 * Draw the given board to the window.
 */
-void draw_board( board* b, view *player_view, SDL_Renderer* renderer );
+void draw_board( board* b, view *player_view, struct cell_renderer* renderer );
+
+/**
+* Write the cells x to x + width - 1 of row y into out, one bit per cell. Cells outside of the board are dead.
+* source is the board, this is the board's cell_row_reader for render_cells.
+*/
+void read_board_row( void* source, Sint64 x, Sint64 y, int width, cell_word* out );
+
+/**
+* Write the share of living cells of the blocks of 2^level x 2^level cells x to x + width - 1 of block row y
+* into out, see read_pyramid_row. Uses the board's pyramid if it has one and the level is stored in it,
+* otherwise counts the cells. This is the board's density_row_reader for render_density.
+*/
+void read_board_density_row( void* source, int level, Sint64 x, Sint64 y, int width, Uint8* out );
+
+/**
+* Set the cells x to x + width - 1 of row y to the bits of cells, the counterpart of read_board_row.
+* Cells outside of the board are ignored.
+*/
+void write_board_row( board* b, int x, int y, int width, const cell_word* cells );
+
+/**
+* Combine the cells x to x + width - 1 of row y with the bits of cells as mode says, a word at a time.
+* cells may be NULL for dead cells. Cells outside of the board are ignored.
+*/
+void paste_board_row( board* b, int x, int y, int width, const cell_word* cells, paste_mode mode );
 
 /**
 * Kill all cells in the given board.
 */
 void kill_all_cells( board* b );
 
+/**
+* Replace all cells of the board with grid, which has the board's layout ( rows of words_per_row words
+* whose unused bits are zero ).
+*/
+void load_board_grid( board* b, const cell_word* grid );
+
+/**
+* Use grid, which has the board's layout, as the board's current generation instead of copying it like load_board_grid.
+* It becomes one of the board's two grids and has to stay valid until the board is freed.
+*/
+void use_board_grid( board* b, cell_word* grid );
+
 /**
 * Resizes the view. Adds the zoom factor the cell_size. 
 * ( i.e a negative zoom factor zooms out and a positive zoom factor zooms in)
+* Zooming out of MIN_CELL_SIZE goes to one pixel per cell and then doubles the cells per pixel ( cell_shift ) until
+* the whole board is visible. If world is NULL the view isn't restricted to a board and stops at MIN_CELL_SIZE.
 */
 void resize_board_view( int zoom, view* player_view, board* world );
 
@@ -93,6 +363,7 @@ void resize_board_view( int zoom, view* player_view, board* world );
 * Moves the camera in the given direction by a given amount.
 * If it's not possbile to move by x and y it moves as far in the direction as possible.
 * And if the camera position is out of bounds it doesn't move the camera at all.
+* If game_board is NULL the camera can move anywhere.
 */
 void move_camera_by( int x, int y, view* player_view, board* game_board, SDL_Window* window );
 
@@ -0,0 +1,230 @@
+#include "cell_renderer.h"
+
+#define LIVING_CELL_PIXEL ( 0xff000000 | LIVING_CELL_R << 16 | LIVING_CELL_G << 8 | LIVING_CELL_B )
+#define DEAD_CELL_PIXEL   ( 0xff000000 | DEAD_CELL_R << 16 | DEAD_CELL_G << 8 | DEAD_CELL_B )
+
+struct cell_renderer
+{
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;
+    // The size of the texture in cells
+    int width;
+    int height;
+    int words_per_row;
+    // The cells and pixels of the last frame, rows that didn't change aren't uploaded again
+    cell_word *rows;
+    Uint32 *pixels;
+    cell_word *read_buffer;
+    // FALSE until the texture has been filled the first time. After that a row is uploaded
+    // if its cells differ from the last frame, no matter whether the cells, the camera or the source changed.
+    bool valid;
+    // The cell_shift of the last frame, 0 if it showed cells
+    int shift;
+    // The densities of the last frame that showed densities
+    Uint8 *densities;
+    Uint8 *density_buffer;
+    // The pixels of the 8 cells in every possible byte
+    Uint32 byte_pixels[ 256 ][ 8 ];
+    // The pixel of every density
+    Uint32 density_pixels[ 256 ];
+};
+
+cell_renderer* create_cell_renderer( SDL_Renderer* renderer )
+{
+    cell_renderer *r = calloc( 1, sizeof( cell_renderer ) );
+    r->renderer = renderer;
+    for ( int byte = 0; byte < 256; byte++ )
+    {
+        for ( int bit = 0; bit < 8; bit++ )
+        {
+            r->byte_pixels[ byte ][ bit ] = ( byte >> bit ) & 1 ? LIVING_CELL_PIXEL : DEAD_CELL_PIXEL;
+        }
+    }
+    for ( int density = 0; density < 256; density++ )
+    {
+        // The square root brightens sparse blocks, a glider in a big block would be invisible otherwise
+        double share = sqrt( density / 255.0 );
+        Uint32 red = ( Uint32 ) ( DEAD_CELL_R + ( LIVING_CELL_R - DEAD_CELL_R ) * share + 0.5 );
+        Uint32 green = ( Uint32 ) ( DEAD_CELL_G + ( LIVING_CELL_G - DEAD_CELL_G ) * share + 0.5 );
+        Uint32 blue = ( Uint32 ) ( DEAD_CELL_B + ( LIVING_CELL_B - DEAD_CELL_B ) * share + 0.5 );
+        r->density_pixels[ density ] = 0xff000000 | red << 16 | green << 8 | blue;
+    }
+    return r;
+}
+
+void destroy_cell_renderer( cell_renderer* r )
+{
+    if ( r->texture )
+    {
+        SDL_DestroyTexture( r->texture );
+    }
+    free( r->rows );
+    free( r->pixels );
+    free( r->read_buffer );
+    free( r->densities );
+    free( r->density_buffer );
+    free( r );
+}
+
+/* Recreates the texture and the buffers for a view of the given size, returns FALSE if the texture can't be created */
+bool resize_cell_renderer( cell_renderer *r, int width, int height )
+{
+    if ( r->texture )
+    {
+        SDL_DestroyTexture( r->texture );
+    }
+    // Scale the cells up to squares instead of blurring them
+    SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "nearest" );
+    r->texture = SDL_CreateTexture( r->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height );
+    if ( !r->texture )
+    {
+        fprintf( stderr, "error creating the cell texture: %s\n", SDL_GetError( ) );
+        r->width = r->height = 0;
+        return FALSE;
+    }
+    r->width = width;
+    r->height = height;
+    r->words_per_row = ( width + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    free( r->rows );
+    free( r->pixels );
+    free( r->read_buffer );
+    free( r->densities );
+    free( r->density_buffer );
+    r->rows = malloc( ( size_t ) height * r->words_per_row * sizeof( cell_word ) );
+    r->pixels = malloc( ( size_t ) height * width * sizeof( Uint32 ) );
+    r->read_buffer = malloc( r->words_per_row * sizeof( cell_word ) );
+    r->densities = malloc( ( size_t ) height * width );
+    r->density_buffer = malloc( width );
+    r->valid = FALSE;
+    return TRUE;
+}
+
+/* Writes the pixels of width cells, eight at a time */
+void expand_cells( cell_renderer *r, const cell_word *cells, int width, Uint32 *pixels )
+{
+    for ( int x = 0; x < width; x += 8 )
+    {
+        int byte = ( cells[ x / CELLS_PER_WORD ] >> ( x % CELLS_PER_WORD ) ) & 0xff;
+        int count = width - x < 8 ? width - x : 8;
+        memcpy( pixels + x, r->byte_pixels[ byte ], count * sizeof( Uint32 ) );
+    }
+}
+
+void upload_rows( cell_renderer *r, int first_row, int row_count )
+{
+    SDL_Rect rows = { 0, first_row, r->width, row_count };
+    SDL_UpdateTexture( r->texture, &rows, r->pixels + ( size_t ) first_row * r->width, r->width * sizeof( Uint32 ) );
+}
+
+void render_cells( cell_renderer* r, view* player_view, cell_row_reader read_row, void* source )
+{
+    int width = player_view->width_in_cells;
+    int height = player_view->height_in_cells;
+    if ( width <= 0 || height <= 0 )
+    {
+        return;
+    }
+    if ( ( width != r->width || height != r->height ) && !resize_cell_renderer( r, width, height ) )
+    {
+        return;
+    }
+    // The cached rows are densities
+    r->valid = r->valid && !r->shift;
+    r->shift = 0;
+
+    // Cells right of the view in the row's last word are ignored
+    cell_word last_word_mask = width % CELLS_PER_WORD ? ( ( cell_word ) 1 << ( width % CELLS_PER_WORD ) ) - 1 : ~( cell_word ) 0;
+    size_t row_size = r->words_per_row * sizeof( cell_word );
+    // Consecutive changed rows are uploaded together
+    int first_changed_row = -1;
+    for ( int row = 0; row < height; row++ )
+    {
+        cell_word *cached = r->rows + ( size_t ) row * r->words_per_row;
+        read_row( source, player_view->camera_x, player_view->camera_y + row, width, r->read_buffer );
+        r->read_buffer[ r->words_per_row - 1 ] &= last_word_mask;
+        bool changed = !r->valid || memcmp( cached, r->read_buffer, row_size );
+        if ( changed )
+        {
+            memcpy( cached, r->read_buffer, row_size );
+            expand_cells( r, cached, width, r->pixels + ( size_t ) row * width );
+            if ( first_changed_row < 0 )
+            {
+                first_changed_row = row;
+            }
+        }
+        else if ( first_changed_row >= 0 )
+        {
+            upload_rows( r, first_changed_row, row - first_changed_row );
+            first_changed_row = -1;
+        }
+    }
+    if ( first_changed_row >= 0 )
+    {
+        upload_rows( r, first_changed_row, height - first_changed_row );
+    }
+    r->valid = TRUE;
+
+    SDL_Rect target = { 0, 0, width * player_view->cell_size, height * player_view->cell_size };
+    SDL_RenderCopy( r->renderer, r->texture, NULL, &target );
+}
+
+/* Returns value / 2^shift rounded down, also for negative values */
+static inline Sint64 floor_shift( Sint64 value, int shift )
+{
+    return value >= 0 ? value >> shift : -( ( -value + ( ( Sint64 ) 1 << shift ) - 1 ) >> shift );
+}
+
+void render_density( cell_renderer* r, view* player_view, density_row_reader read_row, void* source )
+{
+    int shift = player_view->cell_shift;
+    int width = player_view->width_in_cells >> shift;
+    int height = player_view->height_in_cells >> shift;
+    if ( width <= 0 || height <= 0 )
+    {
+        return;
+    }
+    if ( ( width != r->width || height != r->height ) && !resize_cell_renderer( r, width, height ) )
+    {
+        return;
+    }
+    // The cached rows are cells or densities of other blocks
+    r->valid = r->valid && r->shift == shift;
+    r->shift = shift;
+
+    // The pixels show whole blocks, the camera is rounded down to the block it is in
+    Sint64 x = floor_shift( player_view->camera_x, shift );
+    Sint64 y = floor_shift( player_view->camera_y, shift );
+    int first_changed_row = -1;
+    for ( int row = 0; row < height; row++ )
+    {
+        Uint8 *cached = r->densities + ( size_t ) row * width;
+        read_row( source, shift, x, y + row, width, r->density_buffer );
+        bool changed = !r->valid || memcmp( cached, r->density_buffer, width );
+        if ( changed )
+        {
+            memcpy( cached, r->density_buffer, width );
+            Uint32 *pixels = r->pixels + ( size_t ) row * width;
+            for ( int i = 0; i < width; i++ )
+            {
+                pixels[ i ] = r->density_pixels[ cached[ i ] ];
+            }
+            if ( first_changed_row < 0 )
+            {
+                first_changed_row = row;
+            }
+        }
+        else if ( first_changed_row >= 0 )
+        {
+            upload_rows( r, first_changed_row, row - first_changed_row );
+            first_changed_row = -1;
+        }
+    }
+    if ( first_changed_row >= 0 )
+    {
+        upload_rows( r, first_changed_row, height - first_changed_row );
+    }
+    r->valid = TRUE;
+
+    SDL_Rect target = { 0, 0, width * player_view->cell_size, height * player_view->cell_size };
+    SDL_RenderCopy( r->renderer, r->texture, NULL, &target );
+}
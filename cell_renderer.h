@@ -0,0 +1,47 @@
+#ifndef CELL_RENDERER_H
+#define CELL_RENDERER_H
+
+#include "board.h"
+
+/*
+ * Draws cells through a streaming texture with one pixel per cell that the GPU scales up to the view's cell_size.
+ * The renderer keeps a copy of the visible cells and only expands and uploads the rows that changed since
+ * the last frame, so a frame costs a few texture uploads instead of one draw call per cell.
+ * Zoomed out below one pixel per cell every pixel is shaded by the share of living cells in its block of cells.
+ */
+typedef struct cell_renderer cell_renderer;
+
+/*
+ * Writes the cells x to x + width - 1 of row y into out as packed words: bit k of word i is the cell x + i*CELLS_PER_WORD + k.
+ * Cells outside of the source are dead.
+ */
+typedef void ( *cell_row_reader )( void* source, Sint64 x, Sint64 y, int width, cell_word* out );
+
+/*
+ * Writes the share of living cells of the blocks of 2^level x 2^level cells x to x + width - 1 of block row y into out,
+ * 0 if none of the cells lives and 255 if all of them do. Blocks outside of the source are 0.
+ */
+typedef void ( *density_row_reader )( void* source, int level, Sint64 x, Sint64 y, int width, Uint8* out );
+
+
+/**
+* Create a cell renderer that draws with the given SDL renderer.
+*/
+cell_renderer* create_cell_renderer( SDL_Renderer* renderer );
+
+/**
+* Free the renderer's texture and buffers. The SDL renderer is left alone.
+*/
+void destroy_cell_renderer( cell_renderer* r );
+
+/**
+* Draw the cells the view looks at, reading the rows with read_row from source. The caller presents the frame.
+*/
+void render_cells( cell_renderer* r, view* player_view, cell_row_reader read_row, void* source );
+
+/**
+* Draw the view of a player_view with a cell_shift above 0, one pixel per block of cells read with read_row from source.
+*/
+void render_density( cell_renderer* r, view* player_view, density_row_reader read_row, void* source );
+
+#endif
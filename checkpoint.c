@@ -0,0 +1,324 @@
+#include "checkpoint.h"
+#include "mapped_file.h"
+
+#define CHECKPOINT_MAGIC "LIFECKPT"
+#define CHECKPOINT_VERSION 2
+// Version 1 headers end after the rule, their boards have a dead boundary
+#define CHECKPOINT_VERSION_1_SIZE 64
+
+/* 128 bytes, so the grid that follows it is aligned for the vector kernels when the file is mapped */
+typedef struct
+{
+    char magic[ 8 ];
+    Uint32 version;
+    // The offset of the grid in the file
+    Uint32 header_size;
+    Sint32 rows;
+    Sint32 columns;
+    Uint64 generation;
+    // Only informative, the cells are counted when the checkpoint is restored
+    Uint64 living_cells;
+    char rule[ LIFE_RULE_STRING_SIZE ];
+    // Since version 2
+    Uint32 boundary;
+    char reserved[ 60 ];
+} checkpoint_header;
+
+struct checkpointer
+{
+    char *path;
+    Uint32 interval;
+    Uint32 last_checkpoint;
+    SDL_Thread *thread;
+
+    // Everything below the lock is guarded by it
+    SDL_mutex *lock;
+    SDL_cond *snapshot_ready;
+    // Whether the writer thread owns the snapshot
+    bool writing;
+    bool quit;
+    // The copy of the board that is written, so the board can keep changing
+    checkpoint_header header;
+    cell_word *snapshot;
+    size_t snapshot_words;
+};
+
+static inline size_t grid_words( board* b )
+{
+    return ( size_t ) b->rows * b->words_per_row;
+}
+
+void fill_checkpoint_header( checkpoint_header *header, board *b )
+{
+    memset( header, 0, sizeof( checkpoint_header ) );
+    memcpy( header->magic, CHECKPOINT_MAGIC, sizeof( header->magic ) );
+    header->version = CHECKPOINT_VERSION;
+    header->header_size = sizeof( checkpoint_header );
+    header->rows = b->rows;
+    header->columns = b->columns;
+    header->generation = b->generation;
+    header->living_cells = b->living_cells;
+    format_life_rule( &b->rule, header->rule );
+    header->boundary = b->boundary;
+}
+
+/* Parses the header's rule, which isn't terminated if it fills the whole field */
+bool read_checkpoint_rule( const checkpoint_header *header, life_rule *rule )
+{
+    char text[ sizeof( header->rule ) + 1 ];
+    memcpy( text, header->rule, sizeof( header->rule ) );
+    text[ sizeof( header->rule ) ] = '\0';
+    return parse_life_rule( text, rule );
+}
+
+bool write_checkpoint_file( const char *path, const checkpoint_header *header, const cell_word *grid, size_t words )
+{
+    // Write next to the checkpoint and replace it when everything is written
+    char *temporary_path = malloc( strlen( path ) + sizeof( ".tmp" ) );
+    sprintf( temporary_path, "%s.tmp", path );
+    FILE *file = fopen( temporary_path, "wb" );
+    if ( !file )
+    {
+        fprintf( stderr, "error creating %s\n", temporary_path );
+        free( temporary_path );
+        return FALSE;
+    }
+    bool written = fwrite( header, sizeof( checkpoint_header ), 1, file ) == 1 &&
+                   fwrite( grid, sizeof( cell_word ), words, file ) == words;
+    written = !fclose( file ) && written;
+#ifdef _WIN32
+    // rename doesn't replace files on Windows. The restored board doesn't keep the checkpoint mapped there, so it can be removed.
+    remove( path );
+#endif
+    written = written && !rename( temporary_path, path );
+    if ( !written )
+    {
+        fprintf( stderr, "error writing checkpoint %s\n", path );
+        remove( temporary_path );
+    }
+    free( temporary_path );
+    return written;
+}
+
+bool save_checkpoint( const char* path, board* b )
+{
+    checkpoint_header header;
+    fill_checkpoint_header( &header, b );
+    return write_checkpoint_file( path, &header, b->grid, grid_words( b ) );
+}
+
+/* Returns an error message if the mapped file isn't a checkpoint this program can restore, NULL if it is */
+const char* checkpoint_error( const mapped_file *file )
+{
+    if ( file->size < CHECKPOINT_VERSION_1_SIZE )
+    {
+        return "file too small";
+    }
+    const checkpoint_header *header = ( const checkpoint_header* ) file->data;
+    if ( memcmp( header->magic, CHECKPOINT_MAGIC, sizeof( header->magic ) ) )
+    {
+        return "not a checkpoint";
+    }
+    if ( !( header->version == 1 && header->header_size == CHECKPOINT_VERSION_1_SIZE ) &&
+         !( header->version == CHECKPOINT_VERSION && header->header_size == sizeof( checkpoint_header ) ) )
+    {
+        return "unsupported version";
+    }
+    if ( file->size < header->header_size )
+    {
+        return "file too small";
+    }
+    if ( header->version >= 2 && header->boundary > BOUNDARY_KLEIN_BOTTLE )
+    {
+        return "unsupported boundary";
+    }
+    if ( header->rows <= 0 || header->columns <= 0 )
+    {
+        return "invalid board size";
+    }
+    size_t words = ( size_t ) header->rows * ( ( header->columns + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD );
+    if ( file->size < header->header_size + words * sizeof( cell_word ) )
+    {
+        return "file truncated";
+    }
+    life_rule rule;
+    if ( !read_checkpoint_rule( header, &rule ) )
+    {
+        return "unsupported rule";
+    }
+    return NULL;
+}
+
+board* load_checkpoint( const char* path )
+{
+    mapped_file file;
+    if ( !map_file_private( path, &file ) )
+    {
+        return NULL;
+    }
+    const char *error = checkpoint_error( &file );
+    if ( error )
+    {
+        fprintf( stderr, "error restoring checkpoint %s: %s\n", path, error );
+        unmap_file( &file );
+        return NULL;
+    }
+
+    const checkpoint_header *header = ( const checkpoint_header* ) file.data;
+    board *b = create_board( header->rows, header->columns );
+    if ( !b )
+    {
+        unmap_file( &file );
+        return NULL;
+    }
+    b->generation = header->generation;
+    life_rule rule;
+    read_checkpoint_rule( header, &rule );
+    set_board_rule( b, rule );
+    set_board_boundary( b, header->version >= 2 ? ( boundary_mode ) header->boundary : BOUNDARY_DEAD );
+    cell_word *grid = ( cell_word* ) ( file.data + header->header_size );
+#ifndef _WIN32
+    // The mapped grid becomes one of the board's grids without a copy and the board's own buffer stays untouched. The file can still be replaced by the next checkpoint, the mapping keeps the old one.
+    b->mapping = malloc( sizeof( mapped_file ) );
+    if ( b->mapping )
+    {
+        *b->mapping = file;
+        use_board_grid( b, grid );
+        return b;
+    }
+#endif
+    // A mapped file can't be replaced on Windows, so the grid is copied out and the file unmapped
+    load_board_grid( b, grid );
+    unmap_file( &file );
+    return b;
+}
+
+bool checkpoint_exists( const char* path )
+{
+    FILE *file = fopen( path, "rb" );
+    if ( file )
+    {
+        fclose( file );
+    }
+    return file != NULL;
+}
+
+/* The grid is copied into the snapshot in bands, one task per band */
+typedef struct
+{
+    const cell_word *grid;
+    cell_word *snapshot;
+    size_t words;
+    int band_count;
+} snapshot_copy;
+
+void copy_snapshot_band( void* data, int band )
+{
+    snapshot_copy *copy = data;
+    size_t first_word = copy->words * band / copy->band_count;
+    size_t last_word = copy->words * ( band + 1 ) / copy->band_count;
+    memcpy( copy->snapshot + first_word, copy->grid + first_word, ( last_word - first_word ) * sizeof( cell_word ) );
+}
+
+int checkpoint_writer_main( void *data )
+{
+    checkpointer *c = data;
+    SDL_LockMutex( c->lock );
+    for ( ;; )
+    {
+        while ( !c->writing && !c->quit )
+        {
+            SDL_CondWait( c->snapshot_ready, c->lock );
+        }
+        // A pending snapshot is written before quitting
+        if ( !c->writing )
+        {
+            break;
+        }
+        SDL_UnlockMutex( c->lock );
+        write_checkpoint_file( c->path, &c->header, c->snapshot, c->snapshot_words );
+        SDL_LockMutex( c->lock );
+        c->writing = FALSE;
+    }
+    SDL_UnlockMutex( c->lock );
+    return 0;
+}
+
+checkpointer* create_checkpointer( const char* path, Uint32 interval_ms )
+{
+    checkpointer *c = calloc( 1, sizeof( checkpointer ) );
+    c->path = malloc( strlen( path ) + 1 );
+    strcpy( c->path, path );
+    c->interval = interval_ms;
+    c->last_checkpoint = SDL_GetTicks( );
+    c->lock = SDL_CreateMutex( );
+    c->snapshot_ready = SDL_CreateCond( );
+    c->thread = SDL_CreateThread( checkpoint_writer_main, "checkpoint writer", c );
+    if ( !c->thread )
+    {
+        fprintf( stderr, "error creating the checkpoint thread: %s\n", SDL_GetError( ) );
+    }
+    return c;
+}
+
+void checkpoint_board( checkpointer* c, board* b )
+{
+    Uint32 now = SDL_GetTicks( );
+    if ( !c->thread || now - c->last_checkpoint < c->interval )
+    {
+        return;
+    }
+    SDL_LockMutex( c->lock );
+    // Don't wait for a slow disk, try again after the next update
+    if ( !c->writing )
+    {
+        // The snapshot is reused by every checkpoint of the same board
+        size_t words = grid_words( b );
+        if ( words != c->snapshot_words )
+        {
+            free( c->snapshot );
+            c->snapshot = malloc( words * sizeof( cell_word ) );
+            c->snapshot_words = c->snapshot ? words : 0;
+        }
+        if ( !c->snapshot )
+        {
+            fprintf( stderr, "error saving checkpoint %s: no memory for a copy of the board\n", c->path );
+            // Skip this checkpoint, the next one tries again after the interval
+            c->last_checkpoint = now;
+            SDL_UnlockMutex( c->lock );
+            return;
+        }
+        // The board's threads copy a band each, so the update waits for the copy as short as possible
+        snapshot_copy copy = { b->grid, c->snapshot, words, b->pool ? b->band_count : 1 };
+        if ( b->pool )
+        {
+            run_tasks( b->pool, copy_snapshot_band, &copy, copy.band_count );
+        }
+        else
+        {
+            copy_snapshot_band( &copy, 0 );
+        }
+        fill_checkpoint_header( &c->header, b );
+        c->writing = TRUE;
+        c->last_checkpoint = now;
+        SDL_CondSignal( c->snapshot_ready );
+    }
+    SDL_UnlockMutex( c->lock );
+}
+
+void destroy_checkpointer( checkpointer* c )
+{
+    if ( c->thread )
+    {
+        SDL_LockMutex( c->lock );
+        c->quit = TRUE;
+        SDL_CondSignal( c->snapshot_ready );
+        SDL_UnlockMutex( c->lock );
+        SDL_WaitThread( c->thread, NULL );
+    }
+    SDL_DestroyCond( c->snapshot_ready );
+    SDL_DestroyMutex( c->lock );
+    free( c->snapshot );
+    free( c->path );
+    free( c );
+}
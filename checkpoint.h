@@ -0,0 +1,53 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "board.h"
+
+/*
+ * Checkpoints save a board to a file and restore it without a parse step.
+ * A checkpoint is a 128 byte header ( magic, version, rows, columns, generation, living cells, rule and boundary )
+ * followed by the board's grid exactly as it is laid out in memory, in the byte order of the machine
+ * that wrote it. Restoring maps the file copy on write and uses the mapped grid as the board's grid, so the grid
+ * isn't copied, its pages are read straight from the file once the cells are counted. On Windows, where a mapped file
+ * can't be replaced by the next checkpoint, the grid is copied out and the file unmapped instead.
+ */
+#define CHECKPOINT_INTERVAL_MS 60000
+
+typedef struct checkpointer checkpointer;
+
+
+/**
+* Write the board to path. The checkpoint is written to a temporary file first and then renamed,
+* so a crash never leaves a half written checkpoint behind. Prints an error and returns FALSE on failure.
+*/
+bool save_checkpoint( const char* path, board* b );
+
+/**
+* Return a board restored from the checkpoint at path, it has to be freed with free_board.
+* Prints an error and returns NULL if the file can't be mapped or isn't a valid checkpoint.
+*/
+board* load_checkpoint( const char* path );
+
+/**
+* Return whether there is a file at path that could be restored.
+*/
+bool checkpoint_exists( const char* path );
+
+/**
+* Create a checkpointer that saves boards to path in the background, at most every interval_ms milliseconds.
+*/
+checkpointer* create_checkpointer( const char* path, Uint32 interval_ms );
+
+/**
+* Call this after every update. If the interval has passed and the last checkpoint is written, the board's grid is copied
+* by the board's threads and a background thread writes it to the checkpointer's file. Otherwise it returns immediately.
+* Prints an error and skips the checkpoint if there is no memory for the copy.
+*/
+void checkpoint_board( checkpointer* c, board* b );
+
+/**
+* Wait until the checkpoint that is being written is done and free the checkpointer.
+*/
+void destroy_checkpointer( checkpointer* c );
+
+#endif
@@ -6,28 +6,56 @@
 *   Q            - Quit
 *   K            - Kill all cells
 *   R            - Repopulate the board
+*   J            - Jump 1024 generations ahead, with HashLife in the largest steps of 64 or more generations that
+*                  keep every living cell that many cells from the edges ( not in the unbounded mode or with a torus
+*                  or Klein bottle boundary )
+*   E            - Export the board to board_<time>.rle ( not in the unbounded mode )
+*   H            - Show or hide the performance HUD
 *   W            - Up
 *   A            - Left 
 *   S            - Down
 *   D            - Right
+*   B            - Step back one generation, hold it to keep rewinding ( pauses the simulation )
 *   Space        - Pause
-*   Up-Arrow     - Speed the simulation up
+*   Up-Arrow     - Speed the simulation up ( generations per second, not bound to the frame rate )
 *   Down-Arrow   - Slow the simulation down
 *   Mouse button - Change the clicked cell's state
+*   Right mouse button - Drag to select a rectangle of cells ( not in the unbounded mode )
+*   C / X        - Copy / cut the selection
+*   Delete       - Clear the selection
+*   V / O / I    - Paste the copied cells at the cursor, replacing the cells / bringing cells to life / inverting cells
+*   F / U / T    - Flip the selection left to right / upside down, turn it clockwise
+*   Escape       - Drop the selection
 *   Scroll wheel - Zoom
 *
 * TODO:
-*     - Store the board as an array of 32 or 64 bit integers depending on the system's architecture
-*     - Measure and improve the performance (There probably is a way to optimize the update_board function)
-*     - Add support for the Run Length Encoded (RNE) file format
-*     - Add a Makefile
 *     - Test on linux
 *     - Extract complicated boolean conditions in board.c into functions
-*     - Remove everything regarding the RNE file format (YAGN - You ain't gonna need it)
 *     - Don't access the board manually in init_board
 */
 #include "board.h"
+#include "life_kernel.h"
+#include "hashlife.h"
+#include "universe.h"
+#include "batch.h"
+#include "soup_search.h"
+#include "pattern.h"
+#include "checkpoint.h"
+#include "cell_renderer.h"
+#include "simulation.h"
+#include "metrics.h"
+#include "hud.h"
+#include "density_pyramid.h"
+#include "recorder.h"
+#include "region.h"
+#include "domains.h"
 #define FILENAME_BUFFER_SIZE 256
+#define SELF_CHECK_BOARDS 200
+#define SELF_CHECK_DOMAIN_RUNS 20
+#define SELF_CHECK_HISTORIES 20
+#define SELF_CHECK_REGIONS 200
+#define SELF_CHECK_HASHLIFE_BOARDS 100
+#define SELF_CHECK_PATTERNS 60
 
 typedef struct {
     bool wButtonDown;
@@ -36,6 +64,18 @@ typedef struct {
     bool dButtonDown;
     bool kButtonDown;
     bool rButtonDown;
+    bool jButtonDown;
+    bool bButtonDown;
+    bool eButtonDown;
+    bool cButtonDown;
+    bool xButtonDown;
+    bool vButtonDown;
+    bool oButtonDown;
+    bool iButtonDown;
+    bool fButtonDown;
+    bool uButtonDown;
+    bool tButtonDown;
+    bool deleteButtonDown;
     bool upButtonDown;
     bool downButtonDown;
 } buttons;
@@ -47,12 +87,193 @@ typedef struct
     Uint32 last_cursor_y;
 } mouseState;
 
+/* A rectangle of the board's cells selected by dragging with the right mouse button */
+typedef struct
+{
+    bool active;
+    bool dragging;
+    // The cell the drag started at and the cell at the other corner
+    Sint64 anchor_x;
+    Sint64 anchor_y;
+    Sint64 corner_x;
+    Sint64 corner_y;
+} selection;
+
+/* What a region task works on, the task frees it */
+typedef struct
+{
+    int x;
+    int y;
+    int width;
+    int height;
+    paste_mode mode;
+    // The copied cells, only the simulation thread touches them
+    cell_region **clipboard;
+} region_edit;
+
 const Uint32 STARTING_POPULATION = 20000;
+const size_t HASHLIFE_MEMORY_LIMIT = 256 * 1024 * 1024;
+// The J key advances the board by 2^JUMP_LOG2_GENERATIONS generations
+const int JUMP_LOG2_GENERATIONS = 10;
+// in HashLife steps of 2^MIN_JUMP_LOG2_GENERATIONS generations or more, the rest is stepped one generation at a time
+const int MIN_JUMP_LOG2_GENERATIONS = 6;
+// The Up and Down keys change the speed by this factor every frame they are held
+const double SPEED_STEP = 1.1;
+const double MIN_GENERATIONS_PER_SECOND = 0.1;
+const double MAX_GENERATIONS_PER_SECOND = 1000000;
+// The memory the generations the B key rewinds to may take, in MiB
+const int DEFAULT_HISTORY_MIB = 256;
+// The color of the selection's outline
+const Uint8 SELECTION_R = 80;
+const Uint8 SELECTION_G = 160;
+const Uint8 SELECTION_B = 255;
 
 void update_button_states( buttons *bts, SDL_Event e, bool isKeydown );
+void kill_board_task( board* b, void* data );
+void populate_board_task( board* b, void* data );
+void jump_board_task( board* b, void* data );
+void export_board_task( board* b, void* data );
+void count_density_task( board* b, void* data );
+void cell_under_cursor( view* v, int cursor_x, int cursor_y, Sint64* column, Sint64* row );
+bool selected_cells( selection* s, board* b, int* x, int* y, int* width, int* height );
+void draw_selection( SDL_Renderer* renderer, view* v, selection* s, board* b );
+void queue_region_task( simulation* s, board_task task, int x, int y, int width, int height, paste_mode mode, cell_region** clipboard );
+void copy_to_clipboard( board* b, region_edit* edit );
+void copy_region_task( board* b, void* data );
+void cut_region_task( board* b, void* data );
+void clear_region_task( board* b, void* data );
+void paste_region_task( board* b, void* data );
+void flip_horizontally_task( board* b, void* data );
+void flip_vertically_task( board* b, void* data );
+void rotate_region_task( board* b, void* data );
 
 int main(int argc, char** argv)
 {
+    // Verify the vectorized kernels against the scalar rule, the subdomains against update_board, the history's rewinds
+    // and the region operations against cell by cell edits without opening a window
+    if ( argc > 1 && strcmp( argv[ 1 ], "--self-check" ) == 0 )
+    {
+        int failed_checks = check_life_kernels( SELF_CHECK_BOARDS );
+        failed_checks += check_domains( SELF_CHECK_DOMAIN_RUNS );
+        failed_checks += check_board_history( SELF_CHECK_HISTORIES );
+        failed_checks += check_regions( SELF_CHECK_REGIONS );
+        failed_checks += check_hashlife( SELF_CHECK_HASHLIFE_BOARDS );
+        failed_checks += check_patterns( SELF_CHECK_PATTERNS );
+        return failed_checks ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    // Simulate without a window and report the throughput
+    if ( argc > 1 && strcmp( argv[ 1 ], "--batch" ) == 0 )
+    {
+        return run_batch( argc - 2, argv + 2 );
+    }
+    // Run random soups without a window and record what they settle into
+    if ( argc > 1 && strcmp( argv[ 1 ], "--soups" ) == 0 )
+    {
+        return run_soup_search( argc - 2, argv + 2 );
+    }
+    // The options of the interactive mode
+    bool unbounded = FALSE;
+    const char *pattern_path = NULL;
+    const char *checkpoint_path = NULL;
+    const char *metrics_path = NULL;
+    int history_mib = DEFAULT_HISTORY_MIB;
+    // The generations are only recorded if there is a path
+    recording_settings recording = default_recording_settings( NULL );
+    // Without a boundary the board keeps the checkpoint's boundary, or a dead one
+    bool has_boundary = FALSE;
+    boundary_mode boundary = BOUNDARY_DEAD;
+    // Without a rule the board follows the pattern's or checkpoint's rule, or B3/S23
+    bool has_rule = FALSE;
+    life_rule rule;
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( strcmp( argv[ i ], "--unbounded" ) == 0 )
+        {
+            // Simulate an unbounded universe instead of the fixed size board
+            unbounded = TRUE;
+        }
+        else if ( strcmp( argv[ i ], "--pattern" ) == 0 && i + 1 < argc )
+        {
+            pattern_path = argv[ ++i ];
+        }
+        else if ( strcmp( argv[ i ], "--checkpoint" ) == 0 && i + 1 < argc )
+        {
+            checkpoint_path = argv[ ++i ];
+        }
+        else if ( strcmp( argv[ i ], "--metrics" ) == 0 && i + 1 < argc )
+        {
+            metrics_path = argv[ ++i ];
+        }
+        else if ( strcmp( argv[ i ], "--history" ) == 0 && i + 1 < argc )
+        {
+            history_mib = atoi( argv[ ++i ] );
+            if ( history_mib < 0 )
+            {
+                fprintf( stderr, "the history can't take less than 0 MiB\n" );
+                return EXIT_FAILURE;
+            }
+        }
+        else if ( strcmp( argv[ i ], "--record" ) == 0 && i + 1 < argc )
+        {
+            recording_format format;
+            recording.path = argv[ ++i ];
+            if ( !recording_format_from_path( recording.path, &format ) )
+            {
+                fprintf( stderr, "unknown recording format, the file has to end with .gif, .png or .raw: %s\n", recording.path );
+                return EXIT_FAILURE;
+            }
+        }
+        else if ( strcmp( argv[ i ], "--record-every" ) == 0 && i + 1 < argc )
+        {
+            recording.every = atoi( argv[ ++i ] );
+        }
+        else if ( strcmp( argv[ i ], "--record-scale" ) == 0 && i + 1 < argc )
+        {
+            recording.scale = atoi( argv[ ++i ] );
+        }
+        else if ( strcmp( argv[ i ], "--record-policy" ) == 0 && i + 1 < argc )
+        {
+            if ( !recording_policy_from_name( argv[ ++i ], &recording.policy ) )
+            {
+                fprintf( stderr, "unknown recording policy: %s\n", argv[ i ] );
+                return EXIT_FAILURE;
+            }
+        }
+        else if ( strcmp( argv[ i ], "--seed" ) == 0 && i + 1 < argc )
+        {
+            // Without a seed every run starts with the same population
+            seed_random( strtoull( argv[ ++i ], NULL, 10 ) );
+        }
+        else if ( strcmp( argv[ i ], "--boundary" ) == 0 && i + 1 < argc )
+        {
+            if ( !boundary_mode_from_name( argv[ ++i ], &boundary ) )
+            {
+                fprintf( stderr, "unknown boundary mode: %s\n", argv[ i ] );
+                return EXIT_FAILURE;
+            }
+            has_boundary = TRUE;
+        }
+        else if ( strcmp( argv[ i ], "--rule" ) == 0 && i + 1 < argc )
+        {
+            has_rule = TRUE;
+            if ( !parse_life_rule( argv[ ++i ], &rule ) )
+            {
+                fprintf( stderr, "invalid or unsupported ( B0 ) rule: %s\n", argv[ i ] );
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            fprintf( stderr, "unknown option: %s\n", argv[ i ] );
+            return EXIT_FAILURE;
+        }
+    }
+    if ( recording.path && unbounded )
+    {
+        fprintf( stderr, "the unbounded mode can't be recorded\n" );
+        return EXIT_FAILURE;
+    }
+
     // Setup SDL
     if ( SDL_Init( SDL_INIT_VIDEO ) )
     {
@@ -76,13 +297,13 @@ int main(int argc, char** argv)
         goto WindowCreationError;
     }
     // Create a renderer
-    // NOTE: Handle multiple generations per frame if SDL_RENDERER_PRESENTVSYNC is set
     SDL_Renderer* renderer = SDL_CreateRenderer( window, -1, SDL_RENDERER_ACCELERATED|SDL_RENDERER_PRESENTVSYNC );
     if ( !renderer )
     {
         fprintf( stderr, "error creating renderer: %s\n", SDL_GetError( ) );
         goto RendererCreationError;
     }
+    cell_renderer* cells_renderer = create_cell_renderer( renderer );
 
 
     // Initialize the board and the players view on it
@@ -90,6 +311,7 @@ int main(int argc, char** argv)
     int window_height, window_width;
     SDL_GL_GetDrawableSize( window, &window_width, &window_height );
     player_view.cell_size = 10;
+    player_view.cell_shift = 0;
     player_view.height_in_cells = window_height / player_view.cell_size;
     player_view.width_in_cells = window_width / player_view.cell_size;
     player_view.window_height = window_height;
@@ -98,21 +320,103 @@ int main(int argc, char** argv)
     player_view.min_movement_speed_in_pixels = player_view.movement_speed_in_cells * player_view.cell_size;
     const int BOARD_HEIGHT = player_view.window_height / 4;
     const int BOARD_WIDTH = player_view.window_width / 4;
-    board* cell_board = init_board( BOARD_HEIGHT, BOARD_WIDTH, STARTING_POPULATION );
+    // A checkpoint or pattern replaces the random population, the board grows if the pattern doesn't fit
+    board* cell_board;
+    if ( checkpoint_path && checkpoint_exists( checkpoint_path ) )
+    {
+        cell_board = load_checkpoint( checkpoint_path );
+    }
+    else
+    {
+        cell_board = pattern_path ? load_pattern_board( pattern_path, BOARD_HEIGHT, BOARD_WIDTH )
+                                  : init_board( BOARD_HEIGHT, BOARD_WIDTH, STARTING_POPULATION );
+    }
+    if ( !cell_board )
+    {
+        goto BoardCreationError;
+    }
+    set_board_thread_count( cell_board, SDL_GetCPUCount( ) );
+    if ( has_boundary )
+    {
+        set_board_boundary( cell_board, boundary );
+    }
+    if ( has_rule )
+    {
+        set_board_rule( cell_board, rule );
+    }
+    hashlife* jump_universe = create_hashlife( HASHLIFE_MEMORY_LIMIT );
+    // Save the board in the background so long runs survive the program
+    checkpointer* board_checkpointer = checkpoint_path ? create_checkpointer( checkpoint_path, CHECKPOINT_INTERVAL_MS ) : NULL;
+    // In unbounded mode the board only provides the starting population and the camera can move anywhere
+    universe* cell_universe = NULL;
+    board* camera_board = cell_board;
+    if ( unbounded )
+    {
+        cell_universe = create_universe( );
+        if ( cell_universe )
+        {
+            set_universe_rule( cell_universe, cell_board->rule );
+            universe_load_board( cell_universe, cell_board, 0, 0 );
+        }
+        camera_board = NULL;
+    }
     // The starting position of the camera
-    player_view.camera_x = ( BOARD_WIDTH - player_view.width_in_cells ) / 2;
-    player_view.camera_y = ( BOARD_HEIGHT - player_view.height_in_cells ) / 2;
+    player_view.camera_x = ( cell_board->columns - player_view.width_in_cells ) / 2;
+    player_view.camera_y = ( cell_board->rows - player_view.height_in_cells ) / 2;
 
-    int living_cells = 0;
     SDL_Event e;
     Uint32 last_update_time = 0;
-    Uint32 ticks_per_lifecycle = 1000;
+    // The board counts its generations, the universe's are counted here
+    Uint64 universe_generation = 1;
+    double generations_per_second = 1;
 
-    uint8_t quit = FALSE;
+    // Without its universe the unbounded mode has nothing to show, clean up and quit
+    uint8_t quit = unbounded && !cell_universe;
     uint8_t paused = FALSE;
+    uint8_t show_hud = FALSE;
+    bool density_counted = FALSE;
+    selection selected = { FALSE };
+    // The copied cells belong to the simulation thread, only their size is known here
+    cell_region* clipboard = NULL;
+    int clipboard_width = 0;
+    int clipboard_height = 0;
+    metrics* run_metrics = create_metrics( metrics_path );
+    if ( !run_metrics )
+    {
+        // Everything that is drawn or simulated records into the metrics, clean up and quit
+        quit = TRUE;
+    }
+    // The generations are encoded in the background, a recording that can't be started leaves the game without one
+    recorder* board_recorder = recording.path ? create_recorder( &recording, cell_board ) : NULL;
+
+    // The board is updated on its own thread, the unbounded universe is updated between the frames
+    simulation* board_simulation = NULL;
+    if ( !unbounded )
+    {
+        board_simulation = create_simulation( cell_board, board_checkpointer, run_metrics, ( size_t ) history_mib << 20,
+                                              board_recorder );
+        if ( board_simulation )
+        {
+            set_simulation_speed( board_simulation, generations_per_second );
+            set_simulation_paused( board_simulation, paused );
+        }
+        else
+        {
+            // Without a simulation there is nothing to show, clean up and quit
+            quit = TRUE;
+        }
+    }
 
     // Draw the first state of the board
-    draw_board( cell_board, &player_view, renderer );
+    if ( cell_universe )
+    {
+        draw_universe( cell_universe, &player_view, cells_renderer );
+    }
+    else if ( board_simulation )
+    {
+        draw_board( acquire_frame( board_simulation ), &player_view, cells_renderer );
+    }
+    SDL_RenderPresent( renderer );
 
     buttons keys = { FALSE };
     mouseState mouse = { FALSE, (Uint16)-1, (Uint16)-1 };
@@ -135,13 +439,39 @@ int main(int argc, char** argv)
                 {
                 case SDL_SCANCODE_SPACE:
                     paused = isKeydown ^ paused;
+                    if ( board_simulation )
+                    {
+                        set_simulation_paused( board_simulation, paused );
+                    }
+                    break;
+                case SDL_SCANCODE_H:
+                    show_hud = isKeydown ^ show_hud;
                     break;
                 case SDL_SCANCODE_Q:
                     quit = TRUE;
                     break;
+                case SDL_SCANCODE_ESCAPE:
+                    selected.active = FALSE;
+                    break;
                 }
 
             }
+            else if ( e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_RIGHT )
+            {
+                selected.dragging = FALSE;
+            }
+            else if ( e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_RIGHT )
+            {
+                // The region operations work on the board, not on the unbounded universe
+                if ( board_simulation )
+                {
+                    cell_under_cursor( &player_view, e.button.x, e.button.y, &selected.anchor_x, &selected.anchor_y );
+                    selected.corner_x = selected.anchor_x;
+                    selected.corner_y = selected.anchor_y;
+                    selected.active = TRUE;
+                    selected.dragging = TRUE;
+                }
+            }
             else if ( e.type == SDL_MOUSEBUTTONUP )
             {
                 mouse.leftButtonPressed = FALSE;
@@ -154,50 +484,143 @@ int main(int argc, char** argv)
             else if ( e.wheel.y == 1 || e.wheel.y == -1)
             {
                 // Zoom
-                resize_board_view( -e.wheel.y, &player_view, cell_board );
+                resize_board_view( -e.wheel.y, &player_view, camera_board );
+                // Far out the board's blocks are counted once and kept up to date instead of reading every cell of them
+                if ( board_simulation && !density_counted && player_view.cell_shift >= PYRAMID_FIRST_LEVEL )
+                {
+                    queue_board_task( board_simulation, count_density_task, NULL );
+                    density_counted = TRUE;
+                }
             }
         }
 
         // React to presses of supported keys
         if ( keys.aButtonDown )
         {
-            move_camera_by( -player_view.movement_speed_in_cells, 0, &player_view, cell_board, window );
+            move_camera_by( -player_view.movement_speed_in_cells, 0, &player_view, camera_board, window );
         }
         if ( keys.wButtonDown )
         {
-            move_camera_by( 0, -player_view.movement_speed_in_cells, &player_view, cell_board, window );
+            move_camera_by( 0, -player_view.movement_speed_in_cells, &player_view, camera_board, window );
         }
         if ( keys.sButtonDown )
         {
-            move_camera_by( 0, player_view.movement_speed_in_cells, &player_view, cell_board, window );
+            move_camera_by( 0, player_view.movement_speed_in_cells, &player_view, camera_board, window );
         }
         if ( keys.dButtonDown )
         {
-            move_camera_by( player_view.movement_speed_in_cells, 0, &player_view, cell_board, window );
+            move_camera_by( player_view.movement_speed_in_cells, 0, &player_view, camera_board, window );
         }
         if ( keys.kButtonDown )
         {
-            kill_all_cells( cell_board );
+            if ( cell_universe )
+            {
+                universe_kill_all_cells( cell_universe );
+            }
+            else
+            {
+                queue_board_task( board_simulation, kill_board_task, NULL );
+            }
             keys.kButtonDown = FALSE;
         }
         if ( keys.rButtonDown )
         {
-            free( cell_board );
-            cell_board = init_board( BOARD_HEIGHT, BOARD_WIDTH, STARTING_POPULATION );
+            if ( cell_universe )
+            {
+                // Place the new population around the camera
+                populate_board( cell_board, STARTING_POPULATION );
+                universe_kill_all_cells( cell_universe );
+                universe_load_board( cell_universe, cell_board,
+                                     player_view.camera_x + ( player_view.width_in_cells - cell_board->columns ) / 2,
+                                     player_view.camera_y + ( player_view.height_in_cells - cell_board->rows ) / 2 );
+            }
+            else
+            {
+                queue_board_task( board_simulation, populate_board_task, NULL );
+            }
             keys.rButtonDown = FALSE;
         }
-        if ( keys.upButtonDown )
+        // The jump works on the board, the unbounded universe doesn't support it and HashLife
+        // only knows the infinite plane, not a board whose edges are glued together
+        if ( keys.jButtonDown && jump_universe && !cell_universe && cell_board->boundary == BOUNDARY_DEAD )
         {
-            if ( ticks_per_lifecycle > 100 )
-            {
-                ticks_per_lifecycle -= 100;
-            }
+            queue_board_task( board_simulation, jump_board_task, jump_universe );
+            keys.jButtonDown = FALSE;
+        }
+        // The universe doesn't remember its generations
+        if ( keys.bButtonDown && !cell_universe )
+        {
+            paused = TRUE;
+            set_simulation_paused( board_simulation, paused );
+            queue_rewind( board_simulation, 1 );
+            keys.bButtonDown = FALSE;
+        }
+        if ( keys.eButtonDown && !cell_universe )
+        {
+            queue_board_task( board_simulation, export_board_task, NULL );
+            keys.eButtonDown = FALSE;
+        }
+        if ( selected.dragging )
+        {
+            int cursor_x, cursor_y;
+            SDL_GetGlobalMouseState( &cursor_x, &cursor_y );
+            cell_under_cursor( &player_view, cursor_x, cursor_y, &selected.corner_x, &selected.corner_y );
+        }
+        // The region keys work on the selection, the paste keys on the cell under the cursor
+        int region_x, region_y, region_width, region_height;
+        bool has_region = board_simulation && selected_cells( &selected, cell_board, &region_x, &region_y, &region_width, &region_height );
+        if ( has_region && ( keys.cButtonDown || keys.xButtonDown ) )
+        {
+            queue_region_task( board_simulation, keys.cButtonDown ? copy_region_task : cut_region_task,
+                               region_x, region_y, region_width, region_height, PASTE_REPLACE, &clipboard );
+            clipboard_width = region_width;
+            clipboard_height = region_height;
+        }
+        if ( has_region && keys.deleteButtonDown )
+        {
+            queue_region_task( board_simulation, clear_region_task, region_x, region_y, region_width, region_height, PASTE_REPLACE, NULL );
+        }
+        if ( has_region && ( keys.fButtonDown || keys.uButtonDown ) )
+        {
+            queue_region_task( board_simulation, keys.fButtonDown ? flip_horizontally_task : flip_vertically_task,
+                               region_x, region_y, region_width, region_height, PASTE_REPLACE, NULL );
         }
-        if ( keys.downButtonDown )
+        if ( has_region && keys.tButtonDown )
         {
-            if ( ticks_per_lifecycle < 10000 )
+            queue_region_task( board_simulation, rotate_region_task, region_x, region_y, region_width, region_height, PASTE_REPLACE, NULL );
+            // The selection turns with its cells around its top left corner
+            selected.anchor_x = region_x;
+            selected.anchor_y = region_y;
+            selected.corner_x = region_x + region_height - 1;
+            selected.corner_y = region_y + region_width - 1;
+        }
+        if ( board_simulation && clipboard_width && ( keys.vButtonDown || keys.oButtonDown || keys.iButtonDown ) )
+        {
+            int cursor_x, cursor_y;
+            Sint64 column, row;
+            SDL_GetGlobalMouseState( &cursor_x, &cursor_y );
+            cell_under_cursor( &player_view, cursor_x, cursor_y, &column, &row );
+            paste_mode mode = keys.vButtonDown ? PASTE_REPLACE : keys.oButtonDown ? PASTE_OR : PASTE_XOR;
+            queue_region_task( board_simulation, paste_region_task, ( int ) column, ( int ) row, clipboard_width, clipboard_height,
+                               mode, &clipboard );
+            // The pasted cells are selected, so they can be flipped or turned right away
+            selected.active = TRUE;
+            selected.dragging = FALSE;
+            selected.anchor_x = column;
+            selected.anchor_y = row;
+            selected.corner_x = column + clipboard_width - 1;
+            selected.corner_y = row + clipboard_height - 1;
+        }
+        keys.cButtonDown = keys.xButtonDown = keys.deleteButtonDown = FALSE;
+        keys.fButtonDown = keys.uButtonDown = keys.tButtonDown = FALSE;
+        keys.vButtonDown = keys.oButtonDown = keys.iButtonDown = FALSE;
+        if ( keys.upButtonDown || keys.downButtonDown )
+        {
+            generations_per_second *= keys.upButtonDown ? SPEED_STEP : 1 / SPEED_STEP;
+            generations_per_second = SDL_max( MIN_GENERATIONS_PER_SECOND, SDL_min( generations_per_second, MAX_GENERATIONS_PER_SECOND ) );
+            if ( board_simulation )
             {
-                ticks_per_lifecycle += 100;
+                set_simulation_speed( board_simulation, generations_per_second );
             }
         }
         if ( mouse.leftButtonPressed )
@@ -208,31 +631,105 @@ int main(int argc, char** argv)
             if ( !( cursor_x / player_view.cell_size == mouse.last_cursor_x / player_view.cell_size && 
                     cursor_y / player_view.cell_size == mouse.last_cursor_y / player_view.cell_size ) )
             {
-                Uint32 row = (Uint32) player_view.camera_y + cursor_y / player_view.cell_size;
-                Uint32 column = (Uint32) player_view.camera_x + cursor_x / player_view.cell_size;
-                toggle_cell_state( column, row, cell_board );
+                Sint64 row, column;
+                cell_under_cursor( &player_view, cursor_x, cursor_y, &column, &row );
+                if ( cell_universe )
+                {
+                    universe_toggle_cell_state( column, row, cell_universe );
+                }
+                else
+                {
+                    queue_cell_toggle( board_simulation, ( int ) column, ( int ) row );
+                }
                 mouse.last_cursor_x = cursor_x;
                 mouse.last_cursor_y = cursor_y;
             }
         }
-        // Only update the board at the interval stored in ticks_per_lifecycle
-        if ( !( ( SDL_GetTicks( ) - last_update_time ) < ticks_per_lifecycle ) && !paused )
+        // The universe is updated here at most once per frame, the board's simulation thread keeps its own pace
+        if ( cell_universe && !( ( SDL_GetTicks( ) - last_update_time ) < 1000 / generations_per_second ) && !paused )
         {
-            living_cells = update_board( cell_board );
-            last_update_time = SDL_GetTicks( );
+            Uint64 step_start = SDL_GetPerformanceCounter( );
+            if ( update_universe( cell_universe ) )
+            {
+                generation_metrics sample = { universe_generation++ };
+                sample.step_ms = ( double ) ( SDL_GetPerformanceCounter( ) - step_start ) * 1000 / SDL_GetPerformanceFrequency( );
+                sample.population = universe_population( cell_universe );
+                sample.births = universe_births( cell_universe );
+                sample.deaths = universe_deaths( cell_universe );
+                sample.active_regions = universe_chunk_count( cell_universe );
+                record_generation( run_metrics, &sample );
+                last_update_time = SDL_GetTicks( );
+            }
+            else
+            {
+                // Out of memory, the universe stays at its generation until it is unpaused again
+                paused = TRUE;
+            }
         }
+        flush_metrics( run_metrics );
 
         // Clear the entire screen and redraw it
+        Uint64 render_start = SDL_GetPerformanceCounter( );
         SDL_SetRenderDrawColor( renderer, 0, 0, 0, 255 );
         if ( SDL_RenderClear( renderer ) )
         {
             fprintf( stderr, "%s\n", SDL_GetError( ) );
         }
-        draw_board( cell_board, &player_view, renderer );
+        if ( cell_universe )
+        {
+            draw_universe( cell_universe, &player_view, cells_renderer );
+        }
+        else
+        {
+            draw_board( acquire_frame( board_simulation ), &player_view, cells_renderer );
+            draw_selection( renderer, &player_view, &selected, cell_board );
+        }
+        if ( show_hud )
+        {
+            draw_hud( renderer, run_metrics, player_view.window_height );
+        }
+        // Waiting for the vsync in SDL_RenderPresent isn't part of the render time
+        record_frame( run_metrics, ( double ) ( SDL_GetPerformanceCounter( ) - render_start ) * 1000 / SDL_GetPerformanceFrequency( ) );
+        SDL_RenderPresent( renderer );
     }
 
     // Clean up and exit
-    free( cell_board );
+    if ( board_simulation )
+    {
+        // Hands the board back with every queued edit applied
+        destroy_simulation( board_simulation );
+    }
+    if ( clipboard )
+    {
+        free_region( clipboard );
+    }
+    if ( board_recorder )
+    {
+        // Waits for the queued generations
+        destroy_recorder( board_recorder );
+    }
+    if ( run_metrics )
+    {
+        flush_metrics( run_metrics );
+        print_metrics_summary( run_metrics, stdout );
+        destroy_metrics( run_metrics );
+    }
+    if ( board_checkpointer )
+    {
+        destroy_checkpointer( board_checkpointer );
+        if ( !cell_universe )
+        {
+            save_checkpoint( checkpoint_path, cell_board );
+        }
+    }
+    if ( cell_universe )
+    {
+        destroy_universe( cell_universe );
+    }
+    destroy_hashlife( jump_universe );
+    free_board( cell_board );
+    BoardCreationError:
+    destroy_cell_renderer( cells_renderer );
     SDL_DestroyRenderer( renderer );
     RendererCreationError:
     SDL_DestroyWindow( window );
@@ -271,5 +768,252 @@ void update_button_states( buttons *bts, SDL_Event e, bool isKeydown )
     case SDL_SCANCODE_R:
       bts->rButtonDown = isKeydown;
       break;
+    case SDL_SCANCODE_J:
+      bts->jButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_E:
+      bts->eButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_B:
+      bts->bButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_C:
+      bts->cButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_X:
+      bts->xButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_V:
+      bts->vButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_O:
+      bts->oButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_I:
+      bts->iButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_F:
+      bts->fButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_U:
+      bts->uButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_T:
+      bts->tButtonDown = isKeydown;
+      break;
+    case SDL_SCANCODE_DELETE:
+      bts->deleteButtonDown = isKeydown;
+      break;
+    }
+}
+
+void kill_board_task( board* b, void* data )
+{
+    kill_all_cells( b );
+}
+
+void populate_board_task( board* b, void* data )
+{
+    populate_board( b, STARTING_POPULATION );
+}
+
+/* data is the hashlife that does the jump */
+void jump_board_task( board* b, void* data )
+{
+    // HashLife treats the board as part of an infinite plane, a jump of 2^k generations needs 2^k dead cells along
+    // the edges. The jump is split into the largest steps the board allows, down to 2^MIN_JUMP_LOG2_GENERATIONS,
+    // and whatever HashLife can't do ( e.g. cells at the edges or running out of memory ) is stepped one generation at a time.
+    hashlife* jump_universe = data;
+    Uint64 remaining = ( Uint64 ) 1 << JUMP_LOG2_GENERATIONS;
+    while ( remaining )
+    {
+        int log2_generations = JUMP_LOG2_GENERATIONS;
+        while ( log2_generations >= MIN_JUMP_LOG2_GENERATIONS &&
+                ( ( ( Uint64 ) 1 << log2_generations ) > remaining || !hashlife_can_advance_board( b, log2_generations ) ) )
+        {
+            log2_generations--;
+        }
+        if ( log2_generations >= MIN_JUMP_LOG2_GENERATIONS && hashlife_advance_board( jump_universe, b, log2_generations ) )
+        {
+            remaining -= ( Uint64 ) 1 << log2_generations;
+            continue;
+        }
+        for ( int generation = 0; generation < 1 << MIN_JUMP_LOG2_GENERATIONS && remaining; generation++, remaining-- )
+        {
+            update_board( b );
+        }
+    }
+}
+
+void export_board_task( board* b, void* data )
+{
+    char filename[ FILENAME_BUFFER_SIZE ];
+    snprintf( filename, FILENAME_BUFFER_SIZE, "board_%lu.rle", ( unsigned long ) time( NULL ) );
+    save_board_rle( filename, b );
+}
+
+void count_density_task( board* b, void* data )
+{
+    if ( !b->pyramid )
+    {
+        b->pyramid = create_density_pyramid( b );
+    }
+}
+
+/* Zoomed out the pixels show blocks that start at multiples of their size, the cell is the block's first cell */
+void cell_under_cursor( view* v, int cursor_x, int cursor_y, Sint64* column, Sint64* row )
+{
+    int shift = v->cell_shift;
+    *row = ( ( v->camera_y >> shift ) + cursor_y / v->cell_size ) << shift;
+    *column = ( ( v->camera_x >> shift ) + cursor_x / v->cell_size ) << shift;
+}
+
+/* The selected rectangle cut down to the board, returns FALSE if nothing of the board is selected */
+bool selected_cells( selection* s, board* b, int* x, int* y, int* width, int* height )
+{
+    if ( !s->active )
+    {
+        return FALSE;
+    }
+    Sint64 first_x = SDL_max( 0, SDL_min( s->anchor_x, s->corner_x ) );
+    Sint64 first_y = SDL_max( 0, SDL_min( s->anchor_y, s->corner_y ) );
+    Sint64 last_x = SDL_min( b->columns - 1, SDL_max( s->anchor_x, s->corner_x ) );
+    Sint64 last_y = SDL_min( b->rows - 1, SDL_max( s->anchor_y, s->corner_y ) );
+    if ( first_x > last_x || first_y > last_y )
+    {
+        return FALSE;
+    }
+    *x = ( int ) first_x;
+    *y = ( int ) first_y;
+    *width = ( int ) ( last_x - first_x + 1 );
+    *height = ( int ) ( last_y - first_y + 1 );
+    return TRUE;
+}
+
+void draw_selection( SDL_Renderer* renderer, view* v, selection* s, board* b )
+{
+    int x, y, width, height;
+    if ( !selected_cells( s, b, &x, &y, &width, &height ) )
+    {
+        return;
+    }
+    // In pixels, zoomed out a pixel covers 2^cell_shift x 2^cell_shift cells. Cut down to just outside of the window.
+    int shift = v->cell_shift;
+    Sint64 left = ( ( x >> shift ) - ( v->camera_x >> shift ) ) * v->cell_size;
+    Sint64 top = ( ( y >> shift ) - ( v->camera_y >> shift ) ) * v->cell_size;
+    Sint64 right = ( ( ( ( Sint64 ) x + width - 1 ) >> shift ) - ( v->camera_x >> shift ) + 1 ) * v->cell_size;
+    Sint64 bottom = ( ( ( ( Sint64 ) y + height - 1 ) >> shift ) - ( v->camera_y >> shift ) + 1 ) * v->cell_size;
+    left = SDL_max( -1, left );
+    top = SDL_max( -1, top );
+    right = SDL_min( v->window_width + 1, right );
+    bottom = SDL_min( v->window_height + 1, bottom );
+    if ( left >= right || top >= bottom )
+    {
+        return;
+    }
+    SDL_Rect outline = { ( int ) left, ( int ) top, ( int ) ( right - left ), ( int ) ( bottom - top ) };
+    SDL_SetRenderDrawColor( renderer, SELECTION_R, SELECTION_G, SELECTION_B, 255 );
+    SDL_RenderDrawRect( renderer, &outline );
+}
+
+void queue_region_task( simulation* s, board_task task, int x, int y, int width, int height, paste_mode mode, cell_region** clipboard )
+{
+    region_edit *edit = malloc( sizeof( region_edit ) );
+    edit->x = x;
+    edit->y = y;
+    edit->width = width;
+    edit->height = height;
+    edit->mode = mode;
+    edit->clipboard = clipboard;
+    queue_board_task( s, task, edit );
+}
+
+/* Replaces the clipboard with the edit's cells, a copy that doesn't fit into memory keeps the old clipboard */
+void copy_to_clipboard( board* b, region_edit* edit )
+{
+    cell_region *copy = copy_region( b, edit->x, edit->y, edit->width, edit->height );
+    if ( copy )
+    {
+        if ( *edit->clipboard )
+        {
+            free_region( *edit->clipboard );
+        }
+        *edit->clipboard = copy;
+    }
+}
+
+void copy_region_task( board* b, void* data )
+{
+    copy_to_clipboard( b, data );
+    free( data );
+}
+
+void cut_region_task( board* b, void* data )
+{
+    region_edit *edit = data;
+    copy_to_clipboard( b, edit );
+    clear_region( b, edit->x, edit->y, edit->width, edit->height );
+    free( edit );
+}
+
+void clear_region_task( board* b, void* data )
+{
+    region_edit *edit = data;
+    clear_region( b, edit->x, edit->y, edit->width, edit->height );
+    free( edit );
+}
+
+void paste_region_task( board* b, void* data )
+{
+    region_edit *edit = data;
+    if ( *edit->clipboard )
+    {
+        paste_region( b, *edit->clipboard, edit->x, edit->y, edit->mode );
+    }
+    free( edit );
+}
+
+void flip_horizontally_task( board* b, void* data )
+{
+    region_edit *edit = data;
+    cell_region *cells = copy_region( b, edit->x, edit->y, edit->width, edit->height );
+    if ( cells )
+    {
+        flip_region_horizontally( cells );
+        paste_region( b, cells, edit->x, edit->y, PASTE_REPLACE );
+        free_region( cells );
+    }
+    free( edit );
+}
+
+void flip_vertically_task( board* b, void* data )
+{
+    region_edit *edit = data;
+    cell_region *cells = copy_region( b, edit->x, edit->y, edit->width, edit->height );
+    if ( cells )
+    {
+        flip_region_vertically( cells );
+        paste_region( b, cells, edit->x, edit->y, PASTE_REPLACE );
+        free_region( cells );
+    }
+    free( edit );
+}
+
+/* Turns the cells clockwise around the top left corner of the rectangle, the turned cells that don't fit into the board are dropped */
+void rotate_region_task( board* b, void* data )
+{
+    region_edit *edit = data;
+    cell_region *cells = copy_region( b, edit->x, edit->y, edit->width, edit->height );
+    cell_region *rotated = cells ? rotate_region( cells, TRUE ) : NULL;
+    if ( rotated )
+    {
+        clear_region( b, edit->x, edit->y, edit->width, edit->height );
+        paste_region( b, rotated, edit->x, edit->y, PASTE_REPLACE );
+        free_region( rotated );
+    }
+    if ( cells )
+    {
+        free_region( cells );
     }
+    free( edit );
 }
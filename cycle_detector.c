@@ -0,0 +1,180 @@
+#include "cycle_detector.h"
+
+// The table of seen hashes has two entries per bucket, so two boards of a cycle whose hashes
+// fall into the same bucket don't keep replacing each other
+#define SEEN_BUCKETS ( 2 * CYCLE_HISTORY )
+
+struct cycle_detector
+{
+    // The hash of generation g is at g % CYCLE_HISTORY, from first_generation to last_generation
+    Uint64 hashes[ CYCLE_HISTORY ];
+    Uint64 first_generation;
+    Uint64 last_generation;
+    bool has_history;
+    // The board's edit_count when the history started
+    Uint64 edit_count;
+    // The newest generation each hash was seen in, entries outside of the history are stale
+    Uint64 seen_hashes[ SEEN_BUCKETS ][ 2 ];
+    Uint64 seen_generations[ SEEN_BUCKETS ][ 2 ];
+    // A period the last generations match, and how many generations in a row matched it
+    Uint64 candidate_period;
+    Uint64 matched_generations;
+    Uint64 period;
+    Uint64 start;
+};
+
+cycle_detector* create_cycle_detector( void )
+{
+    return calloc( 1, sizeof( cycle_detector ) );
+}
+
+void destroy_cycle_detector( cycle_detector* d )
+{
+    free( d );
+}
+
+void remember_hash( cycle_detector *d, Uint64 hash, Uint64 generation );
+
+/* Forgets everything and starts the history with the board's current generation */
+void restart_history( cycle_detector *d, board *b, Uint64 hash )
+{
+    memset( d->seen_generations, 0, sizeof( d->seen_generations ) );
+    memset( d->seen_hashes, 0, sizeof( d->seen_hashes ) );
+    d->first_generation = b->generation;
+    d->last_generation = b->generation;
+    d->has_history = TRUE;
+    d->edit_count = b->edit_count;
+    d->candidate_period = 0;
+    d->matched_generations = 0;
+    d->period = 0;
+    d->hashes[ b->generation % CYCLE_HISTORY ] = hash;
+    remember_hash( d, hash, b->generation );
+}
+
+/* Returns the hash of a generation in the history */
+static inline Uint64 history_hash( cycle_detector *d, Uint64 generation )
+{
+    return d->hashes[ generation % CYCLE_HISTORY ];
+}
+
+/* Returns how many generations ago the board last had the hash, or 0 if that isn't in the history */
+Uint64 find_repeat( cycle_detector *d, Uint64 hash, Uint64 generation )
+{
+    Uint64 *bucket = d->seen_hashes[ hash % SEEN_BUCKETS ];
+    Uint64 *generations = d->seen_generations[ hash % SEEN_BUCKETS ];
+    for ( int i = 0; i < 2; i++ )
+    {
+        if ( bucket[ i ] == hash && generations[ i ] >= d->first_generation && generations[ i ] < generation &&
+             history_hash( d, generations[ i ] ) == hash )
+        {
+            return generation - generations[ i ];
+        }
+    }
+    return 0;
+}
+
+/* Remembers that the board had the hash in the generation, replacing the older entry of the bucket */
+void remember_hash( cycle_detector *d, Uint64 hash, Uint64 generation )
+{
+    Uint64 *bucket = d->seen_hashes[ hash % SEEN_BUCKETS ];
+    Uint64 *generations = d->seen_generations[ hash % SEEN_BUCKETS ];
+    int entry = bucket[ 1 ] == hash || ( bucket[ 0 ] != hash && generations[ 1 ] < generations[ 0 ] );
+    bucket[ entry ] = hash;
+    generations[ entry ] = generation;
+}
+
+/* Sets the period and finds the first generation of the cycle in the history */
+void enter_cycle( cycle_detector *d, Uint64 period, Uint64 generation )
+{
+    d->period = period;
+    d->start = generation - period;
+    while ( d->start > d->first_generation && history_hash( d, d->start - 1 ) == history_hash( d, d->start - 1 + period ) )
+    {
+        d->start--;
+    }
+}
+
+Uint64 observe_generation( cycle_detector* d, board* b )
+{
+    Uint64 hash = board_hash( b );
+    Uint64 generation = b->generation;
+    if ( !d->has_history || b->edit_count != d->edit_count || generation != d->last_generation + 1 )
+    {
+        restart_history( d, b, hash );
+        return 0;
+    }
+    d->last_generation = generation;
+    // The update only depends on the cells, so the board stays in its cycle until it is edited
+    if ( d->period )
+    {
+        return d->period;
+    }
+
+    d->hashes[ generation % CYCLE_HISTORY ] = hash;
+    if ( generation - d->first_generation >= CYCLE_HISTORY )
+    {
+        d->first_generation = generation - CYCLE_HISTORY + 1;
+    }
+
+    // A board without births and deaths is a still life, no need to wait for the hashes
+    if ( b->births == 0 && b->deaths == 0 )
+    {
+        enter_cycle( d, 1, generation );
+        return d->period;
+    }
+    if ( d->candidate_period )
+    {
+        Uint64 earlier = generation - d->candidate_period;
+        if ( earlier >= d->first_generation && history_hash( d, earlier ) == hash )
+        {
+            d->matched_generations++;
+        }
+        else
+        {
+            d->candidate_period = 0;
+        }
+    }
+    if ( !d->candidate_period )
+    {
+        Uint64 period = find_repeat( d, hash, generation );
+        // Both repetitions of the period have to fit into the history
+        if ( period && period <= CYCLE_HISTORY / 2 )
+        {
+            d->candidate_period = period;
+            d->matched_generations = 1;
+        }
+    }
+    remember_hash( d, hash, generation );
+
+    if ( d->candidate_period && d->matched_generations >= d->candidate_period )
+    {
+        enter_cycle( d, d->candidate_period, generation );
+    }
+    return d->period;
+}
+
+Uint64 cycle_period( cycle_detector* d )
+{
+    return d->period;
+}
+
+Uint64 cycle_start( cycle_detector* d )
+{
+    return d->start;
+}
+
+bool fast_forward_board( cycle_detector* d, board* b, Uint64 target_generation )
+{
+    if ( !d->period || b->edit_count != d->edit_count || b->generation != d->last_generation || target_generation < b->generation )
+    {
+        return FALSE;
+    }
+    Uint64 updates = ( target_generation - b->generation ) % d->period;
+    for ( Uint64 i = 0; i < updates; i++ )
+    {
+        update_board( b );
+    }
+    b->generation = target_generation;
+    d->last_generation = target_generation;
+    return TRUE;
+}
@@ -0,0 +1,52 @@
+#ifndef CYCLE_DETECTOR_H
+#define CYCLE_DETECTOR_H
+
+#include "board.h"
+
+/*
+ * Detects when a board has settled into a still life or an oscillator. The hashes of the last generations are kept
+ * in a ring, a table from hashes to the generations they were seen in finds repeated boards in constant time.
+ * A period is only reported after the whole period has repeated, so a single hash collision isn't taken for a cycle.
+ * Once the period is known the board can skip to any later generation by updating it at most period - 1 times.
+ */
+typedef struct cycle_detector cycle_detector;
+
+// The number of generations the detector remembers, cycles with a longer period than half of it aren't detected
+#define CYCLE_HISTORY 1024
+
+
+/**
+* Create a detector without any history.
+*/
+cycle_detector* create_cycle_detector( void );
+
+/**
+* Free the detector.
+*/
+void destroy_cycle_detector( cycle_detector* d );
+
+/**
+* Record the board's generation, called after every update_board. The history starts over if the board was edited
+* or its generation doesn't follow the last recorded one. Returns the board's period once it has entered a cycle, 0 until then.
+*/
+Uint64 observe_generation( cycle_detector* d, board* b );
+
+/**
+* Return the period of the board's cycle or 0 if it hasn't been detected ( see observe_generation ).
+*/
+Uint64 cycle_period( cycle_detector* d );
+
+/**
+* Return the first generation in which the board was part of the cycle, as far as the history reaches back.
+* Only meaningful if cycle_period isn't 0.
+*/
+Uint64 cycle_start( cycle_detector* d );
+
+/**
+* Bring the board to the given later generation without computing the generations in between. The board is
+* updated ( target_generation - generation ) % period times, then its generation is set to target_generation.
+* Returns FALSE and leaves the board alone if no cycle was detected or the board was edited since.
+*/
+bool fast_forward_board( cycle_detector* d, board* b, Uint64 target_generation );
+
+#endif
@@ -0,0 +1,295 @@
+#include "density_pyramid.h"
+
+// Enough levels for boards with 2^31 rows or columns
+#define MAX_PYRAMID_LEVELS 32
+// The blocks of this level and above can have 2^32 or more living cells and are counted in 64 bits
+#define WIDE_PYRAMID_LEVEL 16
+// The first level whose blocks cover several tiles, a block of the level below is a whole tile
+#define MULTI_TILE_LEVEL 7
+
+struct density_pyramid
+{
+    int rows;
+    int columns;
+    int top_level;
+    // The size of every level in blocks, the levels below PYRAMID_FIRST_LEVEL are empty
+    Sint64 widths[ MAX_PYRAMID_LEVELS ];
+    Sint64 heights[ MAX_PYRAMID_LEVELS ];
+    // Uint32 counts below WIDE_PYRAMID_LEVEL, Uint64 counts from it on
+    void *counts[ MAX_PYRAMID_LEVELS ];
+    // The board's change_stamp when the pyramid was last updated
+    Uint64 stamp;
+    // The blocks of a level from MULTI_TILE_LEVEL on that are summed up again, and whether a block is listed already
+    Sint64 *dirty_blocks;
+    Uint8 *dirty_marks[ MAX_PYRAMID_LEVELS ];
+};
+
+static inline size_t count_size( int level )
+{
+    return level < WIDE_PYRAMID_LEVEL ? sizeof( Uint32 ) : sizeof( Uint64 );
+}
+
+static inline size_t level_size( const density_pyramid *p, int level )
+{
+    return ( size_t ) ( p->widths[ level ] * p->heights[ level ] ) * count_size( level );
+}
+
+static inline Uint64 block_count( const density_pyramid *p, int level, Sint64 x, Sint64 y )
+{
+    Sint64 index = y * p->widths[ level ] + x;
+    return level < WIDE_PYRAMID_LEVEL ? ( ( Uint32* ) p->counts[ level ] )[ index ] : ( ( Uint64* ) p->counts[ level ] )[ index ];
+}
+
+static inline void set_block_count( density_pyramid *p, int level, Sint64 x, Sint64 y, Uint64 count )
+{
+    Sint64 index = y * p->widths[ level ] + x;
+    if ( level < WIDE_PYRAMID_LEVEL )
+    {
+        ( ( Uint32* ) p->counts[ level ] )[ index ] = ( Uint32 ) count;
+    }
+    else
+    {
+        ( ( Uint64* ) p->counts[ level ] )[ index ] = count;
+    }
+}
+
+/* Returns the number of set bits of every byte of the word in that byte */
+static inline Uint64 byte_popcounts( cell_word word )
+{
+    word -= ( word >> 1 ) & 0x5555555555555555ULL;
+    word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+    return ( word + ( word >> 4 ) ) & 0x0f0f0f0f0f0f0f0fULL;
+}
+
+/* Counts the blocks of the first level in the tile. They are 8 x 8 cells, a byte of 8 rows of the tile's word. */
+void count_tile_blocks( density_pyramid *p, board *b, int tile_x, int tile_y )
+{
+    int level = PYRAMID_FIRST_LEVEL;
+    int block_size = 1 << level;
+    int blocks_per_word = CELLS_PER_WORD / block_size;
+    int blocks_per_tile = TILE_ROWS / block_size;
+    Sint64 first_x = ( Sint64 ) tile_x * blocks_per_word;
+    int columns = p->widths[ level ] - first_x < blocks_per_word ? ( int ) ( p->widths[ level ] - first_x ) : blocks_per_word;
+    for ( int block_y = tile_y * blocks_per_tile; block_y < ( tile_y + 1 ) * blocks_per_tile && block_y < p->heights[ level ]; block_y++ )
+    {
+        // All 8 blocks are counted at once, one per byte, a byte of 8 rows has at most 64 living cells
+        Uint64 counts = 0;
+        int last_row = ( block_y + 1 ) * block_size < p->rows ? ( block_y + 1 ) * block_size : p->rows;
+        for ( int y = block_y * block_size; y < last_row; y++ )
+        {
+            counts += byte_popcounts( b->grid[ ( Sint64 ) y * b->words_per_row + tile_x ] );
+        }
+        Uint32 *level_counts = ( Uint32* ) p->counts[ level ] + block_y * p->widths[ level ] + first_x;
+        for ( int block = 0; block < columns; block++ )
+        {
+            level_counts[ block ] = ( Uint32 ) ( counts >> ( block * block_size ) ) & 0xff;
+        }
+    }
+}
+
+/* Sums up the four blocks of the level below that make up the block */
+void sum_block( density_pyramid *p, int level, Sint64 x, Sint64 y )
+{
+    Uint64 count = 0;
+    for ( Sint64 child_y = 2 * y; child_y < 2 * y + 2 && child_y < p->heights[ level - 1 ]; child_y++ )
+    {
+        for ( Sint64 child_x = 2 * x; child_x < 2 * x + 2 && child_x < p->widths[ level - 1 ]; child_x++ )
+        {
+            count += block_count( p, level - 1, child_x, child_y );
+        }
+    }
+    set_block_count( p, level, x, y, count );
+}
+
+/* Counts the blocks of the tile and sums up the blocks above them that don't cover other tiles */
+void count_tile( density_pyramid *p, board *b, int tile_x, int tile_y )
+{
+    count_tile_blocks( p, b, tile_x, tile_y );
+    for ( int level = PYRAMID_FIRST_LEVEL + 1; level < MULTI_TILE_LEVEL && level <= p->top_level; level++ )
+    {
+        Sint64 first_x = ( ( Sint64 ) tile_x * CELLS_PER_WORD ) >> level;
+        Sint64 first_y = ( ( Sint64 ) tile_y * TILE_ROWS ) >> level;
+        for ( Sint64 y = first_y; y < first_y + ( TILE_ROWS >> level ) && y < p->heights[ level ]; y++ )
+        {
+            for ( Sint64 x = first_x; x < first_x + ( CELLS_PER_WORD >> level ) && x < p->widths[ level ]; x++ )
+            {
+                sum_block( p, level, x, y );
+            }
+        }
+    }
+}
+
+void count_all_blocks( density_pyramid *p, board *b )
+{
+    for ( int tile_y = 0; tile_y < b->tile_rows; tile_y++ )
+    {
+        for ( int tile_x = 0; tile_x < b->tile_columns; tile_x++ )
+        {
+            count_tile_blocks( p, b, tile_x, tile_y );
+        }
+    }
+    for ( int level = PYRAMID_FIRST_LEVEL + 1; level <= p->top_level; level++ )
+    {
+        for ( Sint64 y = 0; y < p->heights[ level ]; y++ )
+        {
+            for ( Sint64 x = 0; x < p->widths[ level ]; x++ )
+            {
+                sum_block( p, level, x, y );
+            }
+        }
+    }
+}
+
+density_pyramid* create_density_pyramid( board* b )
+{
+    density_pyramid *p = calloc( 1, sizeof( density_pyramid ) );
+    if ( !p )
+    {
+        fprintf( stderr, "error creating the density pyramid of a %d x %d board\n", b->rows, b->columns );
+        return NULL;
+    }
+    p->rows = b->rows;
+    p->columns = b->columns;
+    int level = PYRAMID_FIRST_LEVEL;
+    for ( ;; level++ )
+    {
+        p->widths[ level ] = ( ( Sint64 ) b->columns + ( ( Sint64 ) 1 << level ) - 1 ) >> level;
+        p->heights[ level ] = ( ( Sint64 ) b->rows + ( ( Sint64 ) 1 << level ) - 1 ) >> level;
+        p->counts[ level ] = malloc( level_size( p, level ) );
+        if ( !p->counts[ level ] )
+        {
+            fprintf( stderr, "error creating the density pyramid of a %d x %d board\n", b->rows, b->columns );
+            p->top_level = level - 1;
+            destroy_density_pyramid( p );
+            return NULL;
+        }
+        if ( p->widths[ level ] == 1 && p->heights[ level ] == 1 )
+        {
+            break;
+        }
+    }
+    p->top_level = level;
+    if ( p->top_level >= MULTI_TILE_LEVEL )
+    {
+        // The dirty blocks of every level fit into the space of the first one
+        p->dirty_blocks = malloc( ( size_t ) ( p->widths[ MULTI_TILE_LEVEL ] * p->heights[ MULTI_TILE_LEVEL ] ) * sizeof( Sint64 ) );
+        bool allocated = p->dirty_blocks != NULL;
+        for ( level = MULTI_TILE_LEVEL; level <= p->top_level; level++ )
+        {
+            p->dirty_marks[ level ] = calloc( ( size_t ) ( p->widths[ level ] * p->heights[ level ] ), 1 );
+            allocated &= p->dirty_marks[ level ] != NULL;
+        }
+        if ( !allocated )
+        {
+            fprintf( stderr, "error creating the density pyramid of a %d x %d board\n", b->rows, b->columns );
+            destroy_density_pyramid( p );
+            return NULL;
+        }
+    }
+    count_all_blocks( p, b );
+    p->stamp = b->change_stamp;
+    return p;
+}
+
+void destroy_density_pyramid( density_pyramid* p )
+{
+    for ( int level = PYRAMID_FIRST_LEVEL; level <= p->top_level; level++ )
+    {
+        free( p->counts[ level ] );
+        free( p->dirty_marks[ level ] );
+    }
+    free( p->dirty_blocks );
+    free( p );
+}
+
+/* Adds the block to the dirty blocks of the level unless it is listed already, returns the new number of dirty blocks */
+static inline Sint64 add_dirty_block( density_pyramid *p, int level, Sint64 x, Sint64 y, Sint64 dirty_count )
+{
+    Sint64 index = y * p->widths[ level ] + x;
+    if ( !p->dirty_marks[ level ][ index ] )
+    {
+        p->dirty_marks[ level ][ index ] = TRUE;
+        p->dirty_blocks[ dirty_count++ ] = index;
+    }
+    return dirty_count;
+}
+
+void update_density_pyramid( density_pyramid* p, board* b )
+{
+    if ( b->change_stamp == p->stamp )
+    {
+        return;
+    }
+    Uint64 stamp = p->stamp;
+    p->stamp = b->change_stamp;
+    if ( b->all_tiles_stamp > stamp )
+    {
+        count_all_blocks( p, b );
+        return;
+    }
+
+    // The changed tiles are counted up to the level of a tile, the blocks above them are listed once per level
+    Sint64 dirty_count = 0;
+    for ( int tile_y = 0; tile_y < b->tile_rows; tile_y++ )
+    {
+        for ( int tile_x = 0; tile_x < b->tile_columns; tile_x++ )
+        {
+            if ( b->tile_stamps[ ( Sint64 ) tile_y * b->tile_columns + tile_x ] <= stamp )
+            {
+                continue;
+            }
+            count_tile( p, b, tile_x, tile_y );
+            if ( p->top_level >= MULTI_TILE_LEVEL )
+            {
+                dirty_count = add_dirty_block( p, MULTI_TILE_LEVEL, ( ( Sint64 ) tile_x * CELLS_PER_WORD ) >> MULTI_TILE_LEVEL,
+                                               ( ( Sint64 ) tile_y * TILE_ROWS ) >> MULTI_TILE_LEVEL, dirty_count );
+            }
+        }
+    }
+    // A level's dirty blocks are summed up and replaced by their parents. There are no more parents than
+    // blocks and a block is read before its slot is reused, so the list is rewritten in place.
+    for ( int level = MULTI_TILE_LEVEL; level <= p->top_level && dirty_count; level++ )
+    {
+        Sint64 parent_count = 0;
+        for ( Sint64 i = 0; i < dirty_count; i++ )
+        {
+            Sint64 x = p->dirty_blocks[ i ] % p->widths[ level ];
+            Sint64 y = p->dirty_blocks[ i ] / p->widths[ level ];
+            p->dirty_marks[ level ][ p->dirty_blocks[ i ] ] = FALSE;
+            sum_block( p, level, x, y );
+            if ( level < p->top_level )
+            {
+                parent_count = add_dirty_block( p, level + 1, x / 2, y / 2, parent_count );
+            }
+        }
+        dirty_count = parent_count;
+    }
+}
+
+int pyramid_top_level( const density_pyramid* p )
+{
+    return p->top_level;
+}
+
+Uint8 block_density( Uint64 living_cells, int level )
+{
+    Uint64 cells = ( Uint64 ) 1 << 2 * level;
+    // Rounded up, so a single living cell in a big block doesn't disappear
+    return ( Uint8 ) ( ( living_cells * 255 + cells - 1 ) >> 2 * level );
+}
+
+void read_pyramid_row( const density_pyramid* p, int level, Sint64 x, Sint64 y, int width, Uint8* out )
+{
+    memset( out, 0, width );
+    if ( y < 0 || y >= p->heights[ level ] )
+    {
+        return;
+    }
+    for ( int i = 0; i < width; i++ )
+    {
+        if ( x + i >= 0 && x + i < p->widths[ level ] )
+        {
+            out[ i ] = block_density( block_count( p, level, x + i, y ), level );
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef DENSITY_PYRAMID_H
+#define DENSITY_PYRAMID_H
+
+#include "board.h"
+
+/*
+ * The number of living cells in blocks of 2^level x 2^level cells of a board, like the mipmaps of a texture.
+ * Every level halves the width and height of the one below it, the top level has a single block that covers the
+ * whole board. A view that is zoomed out below one pixel per cell reads one count per pixel instead of every cell.
+ * The levels below PYRAMID_FIRST_LEVEL aren't stored, their blocks have few enough cells to be counted when they are drawn.
+ * After an update only the tiles that changed are counted again, and only the blocks above them are summed up again.
+ */
+typedef struct density_pyramid density_pyramid;
+
+// The first stored level, its blocks are a byte of 8 rows of a tile
+#define PYRAMID_FIRST_LEVEL 3
+
+
+/**
+* Create a pyramid of the board's cells. Returns NULL if the memory can't be allocated.
+*/
+density_pyramid* create_density_pyramid( board* b );
+
+/**
+* Free the pyramid.
+*/
+void destroy_density_pyramid( density_pyramid* p );
+
+/**
+* Bring the pyramid up to date with the board's cells, called after every update and edit. Only the tiles whose
+* stamps are newer than the last call are counted and only the blocks above them are summed up again, once per block.
+* After a bulk change ( e.g. kill_all_cells ) every tile is counted.
+*/
+void update_density_pyramid( density_pyramid* p, board* b );
+
+/**
+* Return the highest level, the level whose single block covers the whole board.
+*/
+int pyramid_top_level( const density_pyramid* p );
+
+/**
+* Return the share of living cells of a block of the level with the given living cells, as read_pyramid_row writes it.
+*/
+Uint8 block_density( Uint64 living_cells, int level );
+
+/**
+* Write the share of living cells of the blocks x to x + width - 1 of block row y of the level into out, from 0 for no
+* living cells to 255 for only living cells. A block with any living cell is at least 1. Blocks outside of the board are 0.
+* level has to be between PYRAMID_FIRST_LEVEL and the top level.
+*/
+void read_pyramid_row( const density_pyramid* p, int level, Sint64 x, Sint64 y, int width, Uint8* out );
+
+#endif
@@ -0,0 +1,566 @@
+#ifndef _WIN32
+// fork, mmap and the process shared barriers aren't part of C99
+#define _DEFAULT_SOURCE
+#endif
+#include "domains.h"
+#include "random_generator.h"
+
+#ifdef _WIN32
+
+domain_run* create_domain_run( board* b, int domain_columns, int domain_rows )
+{
+    fprintf( stderr, "error starting the worker processes: not supported on Windows\n" );
+    return NULL;
+}
+
+void step_domains( domain_run* d, board* b, int generations )
+{
+}
+
+void gather_domains( domain_run* d, board* b )
+{
+}
+
+void destroy_domain_run( domain_run* d )
+{
+}
+
+int check_domains( int board_count )
+{
+    printf( "domains  not supported on Windows\n" );
+    return 0;
+}
+
+#else
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The ghost margin left and right of a subdomain is a whole word, so the subdomain's words line up with the board's.
+// Only the column next to the subdomain holds a neighbor's cells, the rest of the word stays dead.
+#define GHOST_COLUMNS CELLS_PER_WORD
+// The pieces of the shared memory start on cache lines
+#define SHARED_ALIGNMENT 64
+
+typedef enum
+{
+    DOMAIN_STEP,
+    DOMAIN_GATHER,
+    DOMAIN_QUIT
+} domain_command;
+
+// The edges a worker posts, in the order they are laid out in its mailbox
+typedef enum
+{
+    EDGE_TOP,
+    EDGE_BOTTOM,
+    EDGE_LEFT,
+    EDGE_RIGHT
+} domain_edge;
+
+/* The counts a worker reports for the last generation of its subdomain, the ghost cells aren't counted */
+typedef struct
+{
+    Sint64 living_cells;
+    Sint64 births;
+    Sint64 deaths;
+    int active_tiles;
+    // Set if the worker couldn't create its board
+    bool failed;
+} domain_report;
+
+/* The shared memory starts with the control block */
+typedef struct
+{
+    // The coordinator and the workers meet at it before and after every command
+    pthread_barrier_t command_barrier;
+    // The workers meet at it every generation once they have posted their edges
+    pthread_barrier_t exchange_barrier;
+    domain_command command;
+    int generations;
+} domain_control;
+
+/* The rows and words of the board a worker owns */
+typedef struct
+{
+    int first_row;
+    int rows;
+    int first_word;
+    int words;
+    int columns;
+} subdomain;
+
+struct domain_run
+{
+    int domain_columns;
+    int domain_rows;
+    int count;
+    boundary_mode boundary;
+    int board_rows;
+    int board_columns;
+    int board_words;
+
+    // Every worker has two mailboxes, the one of even generations and the one of odd generations. A worker can be
+    // one generation ahead of its neighbors, it never overwrites the edges they are reading.
+    int max_words;
+    int column_words;
+    size_t mailbox_words;
+
+    // Mapped before the workers are forked, so they all share it
+    char *shared;
+    size_t shared_size;
+    domain_control *control;
+    domain_report *reports;
+    cell_word *mailboxes;
+    // The board's grid the workers gather their cells into
+    cell_word *snapshot;
+    pid_t *workers;
+};
+
+static inline size_t align_shared( size_t size )
+{
+    return ( size + SHARED_ALIGNMENT - 1 ) / SHARED_ALIGNMENT * SHARED_ALIGNMENT;
+}
+
+subdomain subdomain_at( domain_run *d, int column, int row )
+{
+    subdomain s;
+    s.first_word = ( int ) ( ( Sint64 ) d->board_words * column / d->domain_columns );
+    int end_word = ( int ) ( ( Sint64 ) d->board_words * ( column + 1 ) / d->domain_columns );
+    s.words = end_word - s.first_word;
+    int end_column = ( Sint64 ) end_word * CELLS_PER_WORD < d->board_columns ? end_word * CELLS_PER_WORD : d->board_columns;
+    s.columns = end_column - s.first_word * CELLS_PER_WORD;
+    s.first_row = ( int ) ( ( Sint64 ) d->board_rows * row / d->domain_rows );
+    s.rows = ( int ) ( ( Sint64 ) d->board_rows * ( row + 1 ) / d->domain_rows ) - s.first_row;
+    return s;
+}
+
+/* Returns the index of the worker dx, dy subdomains away, or -1 if that is beyond a dead boundary */
+int neighbor_domain( domain_run *d, int column, int row, int dx, int dy )
+{
+    column += dx;
+    row += dy;
+    if ( d->boundary == BOUNDARY_TORUS )
+    {
+        column = ( column + d->domain_columns ) % d->domain_columns;
+        row = ( row + d->domain_rows ) % d->domain_rows;
+    }
+    else if ( column < 0 || column >= d->domain_columns || row < 0 || row >= d->domain_rows )
+    {
+        return -1;
+    }
+    return row * d->domain_columns + column;
+}
+
+/* Returns an edge in the mailbox of a worker */
+cell_word* mailbox_edge( domain_run *d, int index, int parity, domain_edge edge )
+{
+    cell_word *mailbox = d->mailboxes + ( ( size_t ) index * 2 + parity ) * d->mailbox_words;
+    return mailbox + ( edge <= EDGE_BOTTOM ? edge * d->max_words : 2 * d->max_words + ( edge - EDGE_LEFT ) * d->column_words );
+}
+
+static inline bool bit_at( const cell_word *bits, int i )
+{
+    return ( bits[ i / CELLS_PER_WORD ] >> ( i % CELLS_PER_WORD ) ) & 1;
+}
+
+/* Posts the edges of the subdomain, which starts at GHOST_COLUMNS, 1 in the worker's board */
+void post_edges( domain_run *d, board *local, subdomain *s, int index, int parity )
+{
+    cell_word mask = last_word_mask( s->columns );
+    for ( int edge = EDGE_TOP; edge <= EDGE_BOTTOM; edge++ )
+    {
+        cell_word *posted = mailbox_edge( d, index, parity, ( domain_edge ) edge );
+        int y = edge == EDGE_TOP ? 1 : s->rows;
+        memcpy( posted, local->grid + ( Sint64 ) y*local->words_per_row + 1, s->words * sizeof( cell_word ) );
+        // The last word can hold the right ghost column
+        posted[ s->words - 1 ] &= mask;
+    }
+    cell_word *left = mailbox_edge( d, index, parity, EDGE_LEFT );
+    cell_word *right = mailbox_edge( d, index, parity, EDGE_RIGHT );
+    memset( left, 0, d->column_words * sizeof( cell_word ) );
+    memset( right, 0, d->column_words * sizeof( cell_word ) );
+    for ( int y = 0; y < s->rows; y++ )
+    {
+        left[ y / CELLS_PER_WORD ] |= ( cell_word ) cell_state( GHOST_COLUMNS, y + 1, local ) << ( y % CELLS_PER_WORD );
+        right[ y / CELLS_PER_WORD ] |= ( cell_word ) cell_state( GHOST_COLUMNS + s->columns - 1, y + 1, local ) << ( y % CELLS_PER_WORD );
+    }
+}
+
+/* Copies the edges the neighbors posted into the ghost cells around the subdomain. row_buffer has room for a row of the worker's board. */
+void receive_edges( domain_run *d, board *local, subdomain *s, int column, int row, int parity, cell_word *row_buffer )
+{
+    int right_ghost = GHOST_COLUMNS + s->columns;
+    // The row above is the bottom row of the neighbor above and the corner cells of the neighbors above left and right,
+    // the row below is made of the top rows of the neighbors below
+    for ( int dy = -1; dy <= 1; dy += 2 )
+    {
+        domain_edge edge = dy < 0 ? EDGE_BOTTOM : EDGE_TOP;
+        memset( row_buffer, 0, local->words_per_row * sizeof( cell_word ) );
+        int vertical = neighbor_domain( d, column, row, 0, dy );
+        if ( vertical >= 0 )
+        {
+            memcpy( row_buffer + 1, mailbox_edge( d, vertical, parity, edge ), s->words * sizeof( cell_word ) );
+        }
+        int left = neighbor_domain( d, column, row, -1, dy );
+        if ( left >= 0 )
+        {
+            subdomain neighbor = subdomain_at( d, left % d->domain_columns, left / d->domain_columns );
+            row_buffer[ 0 ] |= ( cell_word ) bit_at( mailbox_edge( d, left, parity, edge ), neighbor.columns - 1 ) << ( CELLS_PER_WORD - 1 );
+        }
+        int right = neighbor_domain( d, column, row, 1, dy );
+        if ( right >= 0 )
+        {
+            row_buffer[ right_ghost / CELLS_PER_WORD ] |= ( cell_word ) bit_at( mailbox_edge( d, right, parity, edge ), 0 ) << ( right_ghost % CELLS_PER_WORD );
+        }
+        write_board_row( local, 0, dy < 0 ? 0 : s->rows + 1, local->columns, row_buffer );
+    }
+
+    // The columns left and right are the right column of the left neighbor and the left column of the right neighbor
+    int left = neighbor_domain( d, column, row, -1, 0 );
+    int right = neighbor_domain( d, column, row, 1, 0 );
+    const cell_word *left_column = left >= 0 ? mailbox_edge( d, left, parity, EDGE_RIGHT ) : NULL;
+    const cell_word *right_column = right >= 0 ? mailbox_edge( d, right, parity, EDGE_LEFT ) : NULL;
+    for ( int y = 0; y < s->rows; y++ )
+    {
+        cell_word ghost = left_column ? ( cell_word ) bit_at( left_column, y ) << ( CELLS_PER_WORD - 1 ) : 0;
+        write_board_row( local, 0, y + 1, GHOST_COLUMNS, &ghost );
+        cell_word ghosts[ 2 ] = { right_column ? bit_at( right_column, y ) : 0, 0 };
+        write_board_row( local, right_ghost, y + 1, local->columns - right_ghost, ghosts );
+    }
+}
+
+/* Counts the ghost cells that are set in grid but not in except ( if it isn't NULL ) */
+Sint64 count_ghost_cells( board *local, subdomain *s, const cell_word *grid, const cell_word *except )
+{
+    int words = local->words_per_row;
+    int right_ghost = GHOST_COLUMNS + s->columns;
+    Sint64 count = 0;
+    for ( int y = 0; y < local->rows; y++ )
+    {
+        const cell_word *row = grid + ( Sint64 ) y*words;
+        const cell_word *except_row = except ? except + ( Sint64 ) y*words : NULL;
+        bool ghost_row = y == 0 || y == local->rows - 1;
+        for ( int word = 0; word < words; word++ )
+        {
+            // The ghost bits of the word: all of them in the ghost rows and words, the ones from right_ghost on in the word it falls into
+            cell_word mask;
+            if ( ghost_row || word == 0 || word > right_ghost / CELLS_PER_WORD )
+            {
+                mask = ~( cell_word ) 0;
+            }
+            else if ( word == right_ghost / CELLS_PER_WORD )
+            {
+                mask = ~( ( ( cell_word ) 1 << ( right_ghost % CELLS_PER_WORD ) ) - 1 );
+            }
+            else
+            {
+                continue;
+            }
+            count += popcount64( row[ word ] & ( except_row ? ~except_row[ word ] : ~( cell_word ) 0 ) & mask );
+        }
+    }
+    return count;
+}
+
+/* Copies the subdomain from the board the run was created from into the worker's board */
+void load_subdomain( board *b, board *local, subdomain *s )
+{
+    for ( int y = 0; y < s->rows; y++ )
+    {
+        write_board_row( local, GHOST_COLUMNS, y + 1, s->columns, b->grid + ( Sint64 ) ( s->first_row + y )*b->words_per_row + s->first_word );
+    }
+}
+
+/* Copies the subdomain into the snapshot */
+void gather_subdomain( domain_run *d, board *local, subdomain *s )
+{
+    for ( int y = 0; y < s->rows; y++ )
+    {
+        cell_word *target = d->snapshot + ( Sint64 ) ( s->first_row + y )*d->board_words + s->first_word;
+        memcpy( target, local->grid + ( Sint64 ) ( y + 1 )*local->words_per_row + 1, s->words * sizeof( cell_word ) );
+        target[ s->words - 1 ] &= last_word_mask( s->columns );
+    }
+}
+
+/* The main loop of a worker process, never returns */
+void run_worker( domain_run *d, board *b, int index )
+{
+    int column = index % d->domain_columns;
+    int row = index / d->domain_columns;
+    subdomain s = subdomain_at( d, column, row );
+    domain_report *report = &d->reports[ index ];
+    board *local = create_board( s.rows + 2, s.columns + 2 * GHOST_COLUMNS );
+    cell_word *row_buffer = local ? malloc( local->words_per_row * sizeof( cell_word ) ) : NULL;
+    if ( local )
+    {
+        set_board_rule( local, b->rule );
+        load_subdomain( b, local, &s );
+        report->living_cells = local->living_cells;
+    }
+    report->failed = !local;
+    pthread_barrier_wait( &d->control->command_barrier );
+
+    for ( ;; )
+    {
+        pthread_barrier_wait( &d->control->command_barrier );
+        if ( d->control->command == DOMAIN_QUIT )
+        {
+            break;
+        }
+        if ( d->control->command == DOMAIN_STEP && local )
+        {
+            for ( int i = 0; i < d->control->generations; i++ )
+            {
+                int parity = local->generation % 2;
+                post_edges( d, local, &s, index, parity );
+                pthread_barrier_wait( &d->control->exchange_barrier );
+                receive_edges( d, local, &s, column, row, parity, row_buffer );
+                // Writing the ghost cells doesn't change the subdomain's population
+                Sint64 living_cells = report->living_cells;
+                update_board( local );
+                report->living_cells = local->living_cells - count_ghost_cells( local, &s, local->grid, NULL );
+                // The other grid holds the generation before the update
+                report->births = local->births - count_ghost_cells( local, &s, local->grid, local->next_grid );
+                report->deaths = report->births - ( report->living_cells - living_cells );
+                report->active_tiles = local->active_tile_count;
+            }
+        }
+        else if ( d->control->command == DOMAIN_GATHER && local )
+        {
+            gather_subdomain( d, local, &s );
+        }
+        pthread_barrier_wait( &d->control->command_barrier );
+    }
+    free( row_buffer );
+    if ( local )
+    {
+        free_board( local );
+    }
+    // Don't run the coordinator's exit handlers or flush its buffers
+    _exit( EXIT_SUCCESS );
+}
+
+/* Sends a command to the workers and waits until they have carried it out */
+void run_command( domain_run *d, domain_command command, int generations )
+{
+    d->control->command = command;
+    d->control->generations = generations;
+    pthread_barrier_wait( &d->control->command_barrier );
+    pthread_barrier_wait( &d->control->command_barrier );
+}
+
+/* Stops the workers, which are waiting for a command */
+void stop_workers( domain_run *d, int started )
+{
+    d->control->command = DOMAIN_QUIT;
+    pthread_barrier_wait( &d->control->command_barrier );
+    for ( int i = 0; i < started; i++ )
+    {
+        waitpid( d->workers[ i ], NULL, 0 );
+    }
+}
+
+void free_domain_run( domain_run *d )
+{
+    pthread_barrier_destroy( &d->control->command_barrier );
+    pthread_barrier_destroy( &d->control->exchange_barrier );
+    munmap( d->shared, d->shared_size );
+    free( d->workers );
+    free( d );
+}
+
+domain_run* create_domain_run( board* b, int domain_columns, int domain_rows )
+{
+    if ( b->boundary == BOUNDARY_KLEIN_BOTTLE )
+    {
+        fprintf( stderr, "error starting the worker processes: the Klein bottle boundary isn't supported\n" );
+        return NULL;
+    }
+    if ( domain_columns < 1 || domain_rows < 1 || domain_columns > b->words_per_row || domain_rows > b->rows )
+    {
+        fprintf( stderr, "error starting the worker processes: a %d x %d board can't be split into %d x %d subdomains "
+                         "( at most one column of subdomains per %d columns )\n", b->columns, b->rows, domain_columns, domain_rows, CELLS_PER_WORD );
+        return NULL;
+    }
+
+    domain_run *d = calloc( 1, sizeof( domain_run ) );
+    d->domain_columns = domain_columns;
+    d->domain_rows = domain_rows;
+    d->count = domain_columns * domain_rows;
+    d->boundary = b->boundary;
+    d->board_rows = b->rows;
+    d->board_columns = b->columns;
+    d->board_words = b->words_per_row;
+    // The last subdomains in each direction are the largest ones
+    subdomain largest = subdomain_at( d, domain_columns - 1, domain_rows - 1 );
+    d->max_words = largest.words;
+    d->column_words = ( largest.rows + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    d->mailbox_words = 2 * ( size_t ) d->max_words + 2 * ( size_t ) d->column_words;
+
+    size_t control_size = align_shared( sizeof( domain_control ) );
+    size_t reports_size = align_shared( d->count * sizeof( domain_report ) );
+    size_t mailboxes_size = align_shared( ( size_t ) d->count * 2 * d->mailbox_words * sizeof( cell_word ) );
+    size_t snapshot_size = ( size_t ) b->rows * b->words_per_row * sizeof( cell_word );
+    d->shared_size = control_size + reports_size + mailboxes_size + snapshot_size;
+    void *shared = mmap( NULL, d->shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if ( shared == MAP_FAILED )
+    {
+        fprintf( stderr, "error starting the worker processes: can't map %.1f MiB of shared memory\n", d->shared_size / ( 1024.0 * 1024.0 ) );
+        free( d );
+        return NULL;
+    }
+    d->shared = shared;
+    d->control = shared;
+    d->reports = ( domain_report* ) ( d->shared + control_size );
+    d->mailboxes = ( cell_word* ) ( d->shared + control_size + reports_size );
+    d->snapshot = ( cell_word* ) ( d->shared + control_size + reports_size + mailboxes_size );
+
+    pthread_barrierattr_t attributes;
+    pthread_barrierattr_init( &attributes );
+    pthread_barrierattr_setpshared( &attributes, PTHREAD_PROCESS_SHARED );
+    pthread_barrier_init( &d->control->command_barrier, &attributes, d->count + 1 );
+    pthread_barrier_init( &d->control->exchange_barrier, &attributes, d->count );
+    pthread_barrierattr_destroy( &attributes );
+
+    d->workers = calloc( d->count, sizeof( pid_t ) );
+    // Buffered output would be written by every worker otherwise
+    fflush( stdout );
+    fflush( stderr );
+    for ( int i = 0; i < d->count; i++ )
+    {
+        pid_t worker = fork( );
+        if ( worker == 0 )
+        {
+            run_worker( d, b, i );
+        }
+        if ( worker < 0 )
+        {
+            fprintf( stderr, "error starting the worker processes: fork failed\n" );
+            // The started workers wait for the others at the barrier that never fills up
+            for ( int j = 0; j < i; j++ )
+            {
+                kill( d->workers[ j ], SIGKILL );
+                waitpid( d->workers[ j ], NULL, 0 );
+            }
+            free_domain_run( d );
+            return NULL;
+        }
+        d->workers[ i ] = worker;
+    }
+
+    // Wait for the workers to load their subdomains
+    pthread_barrier_wait( &d->control->command_barrier );
+    for ( int i = 0; i < d->count; i++ )
+    {
+        if ( d->reports[ i ].failed )
+        {
+            fprintf( stderr, "error starting the worker processes: worker %d couldn't create its board\n", i );
+            stop_workers( d, d->count );
+            free_domain_run( d );
+            return NULL;
+        }
+    }
+    return d;
+}
+
+void step_domains( domain_run* d, board* b, int generations )
+{
+    if ( generations <= 0 )
+    {
+        return;
+    }
+    run_command( d, DOMAIN_STEP, generations );
+    b->living_cells = 0;
+    b->births = 0;
+    b->deaths = 0;
+    b->active_tile_count = 0;
+    for ( int i = 0; i < d->count; i++ )
+    {
+        b->living_cells += d->reports[ i ].living_cells;
+        b->births += d->reports[ i ].births;
+        b->deaths += d->reports[ i ].deaths;
+        b->active_tile_count += d->reports[ i ].active_tiles;
+    }
+    b->generation += generations;
+}
+
+void gather_domains( domain_run* d, board* b )
+{
+    run_command( d, DOMAIN_GATHER, 0 );
+    load_board_grid( b, d->snapshot );
+}
+
+void destroy_domain_run( domain_run* d )
+{
+    stop_workers( d, d->count );
+    free_domain_run( d );
+}
+
+// Rules on the specialized kernels and on the generic ones
+const char *CHECKED_DOMAIN_RULES[ ] = { "B3/S23", "B36/S23", "B2/S", "B35678/S5678" };
+
+int check_domains( int board_count )
+{
+    int failed_checks = 0;
+    int rule_count = sizeof( CHECKED_DOMAIN_RULES ) / sizeof( CHECKED_DOMAIN_RULES[ 0 ] );
+    random_generator g;
+    seed_generator( &g, DEFAULT_RANDOM_SEED, 0 );
+    for ( int i = 0; i < board_count; i++ )
+    {
+        int rows = 3 + ( int ) random_below( &g, 300 );
+        int columns = 1 + ( int ) random_below( &g, 700 );
+        int words = ( columns + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+        int domain_columns = 1 + ( int ) random_below( &g, words < 4 ? words : 4 );
+        int domain_rows = 1 + ( int ) random_below( &g, rows < 4 ? rows : 4 );
+        life_rule rule;
+        parse_life_rule( CHECKED_DOMAIN_RULES[ i % rule_count ], &rule );
+
+        // update_board is the reference
+        board *expected = create_board( rows, columns );
+        board *b = create_board( rows, columns );
+        set_board_boundary( expected, ( boundary_mode ) ( i % 2 ) );
+        set_board_boundary( b, expected->boundary );
+        set_board_rule( expected, rule );
+        set_board_rule( b, rule );
+        fill_board_random( expected, 0.2 + 0.05 * ( i % 5 ) );
+        load_board_grid( b, expected->grid );
+        domain_run *d = create_domain_run( b, domain_columns, domain_rows );
+        bool differs = d == NULL;
+        for ( int step = 0; step < 12 && !differs; step++ )
+        {
+            int generations = 1 + ( int ) random_below( &g, 20 );
+            for ( int generation = 0; generation < generations; generation++ )
+            {
+                update_board( expected );
+            }
+            step_domains( d, b, generations );
+            differs = b->generation != expected->generation || b->living_cells != expected->living_cells ||
+                      b->births != expected->births || b->deaths != expected->deaths;
+            if ( step % 4 == 3 )
+            {
+                gather_domains( d, b );
+                differs |= memcmp( b->grid, expected->grid, ( size_t ) rows * b->words_per_row * sizeof( cell_word ) ) != 0;
+            }
+        }
+        if ( d )
+        {
+            destroy_domain_run( d );
+        }
+        if ( differs )
+        {
+            fprintf( stderr, "%dx%d subdomains differ from update_board on a %dx%d board with a %s boundary and the rule %s\n",
+                     domain_columns, domain_rows, columns, rows, boundary_mode_name( b->boundary ), CHECKED_DOMAIN_RULES[ i % rule_count ] );
+            failed_checks++;
+        }
+        free_board( expected );
+        free_board( b );
+    }
+    printf( "%d domain runs, %d failed checks\n", board_count, failed_checks );
+    return failed_checks;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef DOMAINS_H
+#define DOMAINS_H
+
+#include "board.h"
+
+/*
+ * Runs a board on several worker processes. The board is split into a grid of rectangular subdomains,
+ * each worker process updates one of them on a board of its own that has a margin of ghost cells around it.
+ * Before every generation the workers post the cells on the edges of their subdomains ( the top and bottom row,
+ * the left and right column ) and copy the edges their eight neighbors posted into their ghost cells.
+ * The posts are messages between neighbors, they live in shared memory now but map onto a network transport
+ * the same way. The coordinator, the process that creates the run, only sends commands, sums up what the
+ * workers report and gathers snapshots of the whole board.
+ * The generations are bit for bit the ones update_board computes. Worker processes need a POSIX system.
+ */
+typedef struct domain_run domain_run;
+
+
+/**
+* Split the board into domain_columns x domain_rows subdomains and start a worker process for each of them.
+* The subdomains' column boundaries fall on word boundaries, so there can't be more domain columns than words in
+* a row or more domain rows than rows. The workers start with the board's cells and rule, the board's boundary
+* must be dead or a torus. Prints an error and returns NULL if the run can't be started.
+*/
+domain_run* create_domain_run( board* b, int domain_columns, int domain_rows );
+
+/**
+* Let the workers compute the given number of generations. The board the run was created from gets the new
+* generation and the population, births, deaths and active tiles of the last generation, its cells stay
+* the same until gather_domains.
+*/
+void step_domains( domain_run* d, board* b, int generations );
+
+/**
+* Copy the cells of all subdomains into the board the run was created from.
+*/
+void gather_domains( domain_run* d, board* b );
+
+/**
+* Stop the worker processes and free the run.
+*/
+void destroy_domain_run( domain_run* d );
+
+/**
+* Run board_count random boards split into random subdomains and compare their generations, counts and gathered cells
+* with update_board, for both boundary modes and several rules, and print the results. Returns the number of mismatches.
+*/
+int check_domains( int board_count );
+
+#endif
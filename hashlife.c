@@ -0,0 +1,736 @@
+#include "hashlife.h"
+#include "random_generator.h"
+
+#define NODES_PER_BLOCK 4096
+#define INITIAL_BUCKET_COUNT ( 1 << 16 )
+// Coordinates of cells in the universe have to fit into 64 bit integers
+#define MAX_LEVEL 62
+
+typedef struct quadtree_node
+{
+    // The four quadrants of the node, NULL for the leaves ( level 0 )
+    struct quadtree_node *nw, *ne, *sw, *se;
+    // The memoized center of the node 2^step_log generations later
+    struct quadtree_node *result;
+    // The next node in the hash table's bucket or in the free list
+    struct quadtree_node *next;
+    Uint64 population;
+    // -1 for nodes in the free list
+    int level;
+    int marked;
+} quadtree_node;
+
+typedef struct node_block
+{
+    struct node_block *next;
+    quadtree_node nodes[ NODES_PER_BLOCK ];
+} node_block;
+
+struct hashlife
+{
+    quadtree_node **buckets;
+    size_t bucket_count;
+    size_t node_count;
+    node_block *blocks;
+    size_t block_count;
+    quadtree_node *free_nodes;
+    size_t memory_limit;
+    // Set when a node couldn't be allocated, the step that is running is abandoned
+    bool out_of_memory;
+
+    quadtree_node dead_leaf;
+    quadtree_node living_leaf;
+    // The canonical empty node of every level, they are created with the universe and never freed
+    quadtree_node *empty[ MAX_LEVEL + 2 ];
+
+    quadtree_node *root;
+    // The board coordinates of the universe's cell (0, 0). The root is centered around it.
+    Sint64 origin_x;
+    Sint64 origin_y;
+    // The results of the nodes advance 2^step_log generations
+    int step_log;
+    Uint64 generation;
+    // The rule the memoized results were computed with
+    life_rule rule;
+};
+
+Uint64 hash_children( quadtree_node *nw, quadtree_node *ne, quadtree_node *sw, quadtree_node *se )
+{
+    Uint64 hash = ( Uint64 ) ( uintptr_t ) nw;
+    hash = hash * 0x9e3779b97f4a7c15ULL + ( Uint64 ) ( uintptr_t ) ne;
+    hash = hash * 0x9e3779b97f4a7c15ULL + ( Uint64 ) ( uintptr_t ) sw;
+    hash = hash * 0x9e3779b97f4a7c15ULL + ( Uint64 ) ( uintptr_t ) se;
+    return hash ^ ( hash >> 29 );
+}
+
+size_t hashlife_memory_usage( hashlife* h )
+{
+    return h->block_count * sizeof( node_block ) + h->bucket_count * sizeof( quadtree_node* );
+}
+
+/* Rehashes the nodes into bucket_count buckets. If they can't be allocated the old buckets stay, longer chains are slower but still correct. */
+void resize_hash_table( hashlife *h, size_t bucket_count )
+{
+    if ( bucket_count > h->bucket_count &&
+         hashlife_memory_usage( h ) + ( bucket_count - h->bucket_count ) * sizeof( quadtree_node* ) > h->memory_limit )
+    {
+        return;
+    }
+    quadtree_node **buckets = calloc( bucket_count, sizeof( quadtree_node* ) );
+    if ( !buckets )
+    {
+        return;
+    }
+    for ( size_t i = 0; i < h->bucket_count; i++ )
+    {
+        quadtree_node *n = h->buckets[ i ];
+        while ( n )
+        {
+            quadtree_node *next = n->next;
+            size_t bucket = hash_children( n->nw, n->ne, n->sw, n->se ) & ( bucket_count - 1 );
+            n->next = buckets[ bucket ];
+            buckets[ bucket ] = n;
+            n = next;
+        }
+    }
+    free( h->buckets );
+    h->buckets = buckets;
+    h->bucket_count = bucket_count;
+}
+
+/* Returns NULL and sets out_of_memory if another block of nodes would exceed the memory limit or can't be allocated */
+quadtree_node* allocate_node( hashlife *h )
+{
+    if ( !h->free_nodes )
+    {
+        node_block *block = NULL;
+        if ( hashlife_memory_usage( h ) + sizeof( node_block ) <= h->memory_limit )
+        {
+            block = malloc( sizeof( node_block ) );
+        }
+        if ( !block )
+        {
+            h->out_of_memory = TRUE;
+            return NULL;
+        }
+        block->next = h->blocks;
+        h->blocks = block;
+        h->block_count++;
+        for ( int i = 0; i < NODES_PER_BLOCK; i++ )
+        {
+            block->nodes[ i ].level = -1;
+            block->nodes[ i ].next = h->free_nodes;
+            h->free_nodes = &block->nodes[ i ];
+        }
+    }
+    quadtree_node *n = h->free_nodes;
+    h->free_nodes = n->next;
+    return n;
+}
+
+/*
+ * Returns the canonical node with the given quadrants, creating it if it doesn't exist yet.
+ * If it can't be created the empty node of its level stands in for it, so the callers don't have to check,
+ * and out_of_memory tells the step to throw its results away.
+ */
+quadtree_node* find_node( hashlife *h, quadtree_node *nw, quadtree_node *ne, quadtree_node *sw, quadtree_node *se )
+{
+    size_t bucket = hash_children( nw, ne, sw, se ) & ( h->bucket_count - 1 );
+    for ( quadtree_node *n = h->buckets[ bucket ]; n; n = n->next )
+    {
+        if ( n->nw == nw && n->ne == ne && n->sw == sw && n->se == se )
+        {
+            return n;
+        }
+    }
+
+    quadtree_node *n = allocate_node( h );
+    if ( !n )
+    {
+        return h->empty[ nw->level + 1 ];
+    }
+    n->nw = nw;
+    n->ne = ne;
+    n->sw = sw;
+    n->se = se;
+    n->result = NULL;
+    n->population = nw->population + ne->population + sw->population + se->population;
+    n->level = nw->level + 1;
+    n->marked = FALSE;
+    n->next = h->buckets[ bucket ];
+    h->buckets[ bucket ] = n;
+    if ( ++h->node_count > h->bucket_count )
+    {
+        resize_hash_table( h, h->bucket_count * 2 );
+    }
+    return n;
+}
+
+quadtree_node* empty_node( hashlife *h, int level )
+{
+    if ( !h->empty[ level ] )
+    {
+        quadtree_node *quadrant = empty_node( h, level - 1 );
+        h->empty[ level ] = find_node( h, quadrant, quadrant, quadrant, quadrant );
+    }
+    return h->empty[ level ];
+}
+
+/* The node of the next lower level at the center of n */
+quadtree_node* centered_node( hashlife *h, quadtree_node *n )
+{
+    return find_node( h, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw );
+}
+
+/* The node of the same level as w and e centered on the border between them */
+quadtree_node* centered_horizontal( hashlife *h, quadtree_node *w, quadtree_node *e )
+{
+    return find_node( h, w->ne, e->nw, w->se, e->sw );
+}
+
+/* The node of the same level as n and s centered on the border between them */
+quadtree_node* centered_vertical( hashlife *h, quadtree_node *n, quadtree_node *s )
+{
+    return find_node( h, n->sw, n->se, s->nw, s->ne );
+}
+
+/* Returns the state of the cell at x, y ( 0 to 3 ) of a level 2 node */
+int level_two_cell( quadtree_node *n, int x, int y )
+{
+    quadtree_node *quadrant = y < 2 ? ( x < 2 ? n->nw : n->ne ) : ( x < 2 ? n->sw : n->se );
+    x %= 2;
+    y %= 2;
+    quadtree_node *leaf = y == 0 ? ( x == 0 ? quadrant->nw : quadrant->ne ) : ( x == 0 ? quadrant->sw : quadrant->se );
+    return ( int ) leaf->population;
+}
+
+/* Advances the center 2x2 cells of a 4x4 node by one generation with the scalar rule */
+quadtree_node* advance_level_two( hashlife *h, quadtree_node *n )
+{
+    quadtree_node *center[ 4 ];
+    for ( int i = 0; i < 4; i++ )
+    {
+        int x = 1 + i % 2;
+        int y = 1 + i / 2;
+        int living_neighbors = 0;
+        for ( int dy = -1; dy <= 1; dy++ )
+        {
+            for ( int dx = -1; dx <= 1; dx++ )
+            {
+                living_neighbors += ( dx || dy ) ? level_two_cell( n, x + dx, y + dy ) : 0;
+            }
+        }
+        bool alive = next_cell_state( &h->rule, level_two_cell( n, x, y ), living_neighbors );
+        center[ i ] = alive ? &h->living_leaf : &h->dead_leaf;
+    }
+    return find_node( h, center[ 0 ], center[ 1 ], center[ 2 ], center[ 3 ] );
+}
+
+/*
+ * Returns the center of n ( one level lower ) 2^step_log generations later.
+ * Nodes that are too small for that many generations ( level - 2 < step_log ) advance 2^( level - 2 ) generations.
+ */
+quadtree_node* advance( hashlife *h, quadtree_node *n )
+{
+    // An abandoned step unwinds without doing any more work
+    if ( h->out_of_memory )
+    {
+        return h->empty[ n->level - 1 ];
+    }
+    if ( n->result )
+    {
+        return n->result;
+    }
+    if ( n->population == 0 )
+    {
+        return n->result = empty_node( h, n->level - 1 );
+    }
+    if ( n->level == 2 )
+    {
+        return n->result = advance_level_two( h, n );
+    }
+
+    // Nine overlapping nodes of the next lower level that cover n
+    quadtree_node *n00 = n->nw;
+    quadtree_node *n01 = centered_horizontal( h, n->nw, n->ne );
+    quadtree_node *n02 = n->ne;
+    quadtree_node *n10 = centered_vertical( h, n->nw, n->sw );
+    quadtree_node *n11 = centered_node( h, n );
+    quadtree_node *n12 = centered_vertical( h, n->ne, n->se );
+    quadtree_node *n20 = n->sw;
+    quadtree_node *n21 = centered_horizontal( h, n->sw, n->se );
+    quadtree_node *n22 = n->se;
+
+    quadtree_node *r00, *r01, *r02, *r10, *r11, *r12, *r20, *r21, *r22;
+    if ( h->step_log >= n->level - 2 )
+    {
+        // Full speed: both halves of the step advance 2^( level - 3 ) generations
+        r00 = advance( h, n00 ); r01 = advance( h, n01 ); r02 = advance( h, n02 );
+        r10 = advance( h, n10 ); r11 = advance( h, n11 ); r12 = advance( h, n12 );
+        r20 = advance( h, n20 ); r21 = advance( h, n21 ); r22 = advance( h, n22 );
+    }
+    else
+    {
+        // Smaller steps: the first half only moves to the centers, the second half does all the work
+        r00 = centered_node( h, n00 ); r01 = centered_node( h, n01 ); r02 = centered_node( h, n02 );
+        r10 = centered_node( h, n10 ); r11 = centered_node( h, n11 ); r12 = centered_node( h, n12 );
+        r20 = centered_node( h, n20 ); r21 = centered_node( h, n21 ); r22 = centered_node( h, n22 );
+    }
+
+    quadtree_node *nw = advance( h, find_node( h, r00, r01, r10, r11 ) );
+    quadtree_node *ne = advance( h, find_node( h, r01, r02, r11, r12 ) );
+    quadtree_node *sw = advance( h, find_node( h, r10, r11, r20, r21 ) );
+    quadtree_node *se = advance( h, find_node( h, r11, r12, r21, r22 ) );
+    return n->result = find_node( h, nw, ne, sw, se );
+}
+
+/* Returns a node one level higher with n at its center */
+quadtree_node* expand( hashlife *h, quadtree_node *n )
+{
+    quadtree_node *border = empty_node( h, n->level - 1 );
+    return find_node( h,
+                      find_node( h, border, border, border, n->nw ),
+                      find_node( h, border, border, n->ne, border ),
+                      find_node( h, border, n->sw, border, border ),
+                      find_node( h, n->se, border, border, border ) );
+}
+
+/* Whether all living cells of n are in the center square that is a quarter of n's width */
+bool in_center_quarter( quadtree_node *n )
+{
+    return n->population == n->nw->se->se->population + n->ne->sw->sw->population +
+                            n->sw->ne->ne->population + n->se->nw->nw->population;
+}
+
+void mark_node( quadtree_node *n )
+{
+    while ( n && !n->marked )
+    {
+        n->marked = TRUE;
+        if ( n->level == 0 )
+        {
+            return;
+        }
+        mark_node( n->nw );
+        mark_node( n->ne );
+        mark_node( n->sw );
+        mark_node( n->se );
+        n = n->result;
+    }
+}
+
+void forget_results( hashlife *h )
+{
+    for ( size_t i = 0; i < h->bucket_count; i++ )
+    {
+        for ( quadtree_node *n = h->buckets[ i ]; n; n = n->next )
+        {
+            n->result = NULL;
+        }
+    }
+}
+
+/* Frees all nodes that can't be reached from the root, the empty nodes or the memoized results */
+void collect_garbage( hashlife *h )
+{
+    mark_node( h->root );
+    for ( int level = 0; level <= MAX_LEVEL + 1; level++ )
+    {
+        mark_node( h->empty[ level ] );
+    }
+
+    for ( size_t i = 0; i < h->bucket_count; i++ )
+    {
+        quadtree_node **link = &h->buckets[ i ];
+        while ( *link )
+        {
+            quadtree_node *n = *link;
+            if ( n->marked )
+            {
+                n->marked = FALSE;
+                link = &n->next;
+                continue;
+            }
+            *link = n->next;
+            n->level = -1;
+            n->next = h->free_nodes;
+            h->free_nodes = n;
+            h->node_count--;
+        }
+    }
+    h->dead_leaf.marked = h->living_leaf.marked = FALSE;
+}
+
+/* Frees the blocks whose nodes are all in the free list and rebuilds the free list from the other blocks, shrinks the hash table to the nodes that are left */
+void release_empty_blocks( hashlife *h )
+{
+    size_t bucket_count = h->bucket_count;
+    while ( bucket_count > INITIAL_BUCKET_COUNT && h->node_count < bucket_count / 4 )
+    {
+        bucket_count /= 2;
+    }
+    if ( bucket_count != h->bucket_count )
+    {
+        resize_hash_table( h, bucket_count );
+    }
+
+    h->free_nodes = NULL;
+    node_block **link = &h->blocks;
+    while ( *link )
+    {
+        node_block *block = *link;
+        int free_count = 0;
+        for ( int i = 0; i < NODES_PER_BLOCK; i++ )
+        {
+            free_count += block->nodes[ i ].level < 0;
+        }
+        if ( free_count == NODES_PER_BLOCK )
+        {
+            *link = block->next;
+            free( block );
+            h->block_count--;
+            continue;
+        }
+        for ( int i = 0; i < NODES_PER_BLOCK; i++ )
+        {
+            if ( block->nodes[ i ].level < 0 )
+            {
+                block->nodes[ i ].next = h->free_nodes;
+                h->free_nodes = &block->nodes[ i ];
+            }
+        }
+        link = &block->next;
+    }
+}
+
+/* Throws the memoized results away and frees every node that isn't part of the root or an empty node */
+void free_unused_nodes( hashlife *h )
+{
+    forget_results( h );
+    collect_garbage( h );
+    release_empty_blocks( h );
+}
+
+/*
+ * Keeps half of the memory limit free for the next step. The unused nodes are freed once more than half of it is used,
+ * if most of the nodes are still reachable through the memoized results the results are thrown away too.
+ */
+void enforce_memory_limit( hashlife *h )
+{
+    if ( hashlife_memory_usage( h ) <= h->memory_limit / 2 )
+    {
+        return;
+    }
+    size_t node_limit = h->memory_limit / sizeof( quadtree_node );
+    collect_garbage( h );
+    // If most of the nodes are still reachable through the memoized results, throw the results away
+    if ( h->node_count > node_limit / 4 )
+    {
+        forget_results( h );
+        collect_garbage( h );
+    }
+    release_empty_blocks( h );
+}
+
+hashlife* create_hashlife( size_t memory_limit )
+{
+    hashlife *h = calloc( 1, sizeof( hashlife ) );
+    if ( !h )
+    {
+        fprintf( stderr, "error creating a hashlife universe\n" );
+        return NULL;
+    }
+    h->bucket_count = INITIAL_BUCKET_COUNT;
+    h->buckets = calloc( h->bucket_count, sizeof( quadtree_node* ) );
+    h->memory_limit = memory_limit;
+    h->living_leaf.population = 1;
+    h->empty[ 0 ] = &h->dead_leaf;
+    // find_node falls back to the empty nodes when it runs out of memory, so all of them have to exist
+    if ( h->buckets )
+    {
+        empty_node( h, MAX_LEVEL + 1 );
+    }
+    if ( !h->buckets || h->out_of_memory )
+    {
+        fprintf( stderr, "error creating a hashlife universe: out of memory\n" );
+        destroy_hashlife( h );
+        return NULL;
+    }
+    h->root = empty_node( h, 3 );
+    h->rule = conway_rule( );
+    return h;
+}
+
+void destroy_hashlife( hashlife* h )
+{
+    if ( !h )
+    {
+        return;
+    }
+    while ( h->blocks )
+    {
+        node_block *next = h->blocks->next;
+        free( h->blocks );
+        h->blocks = next;
+    }
+    free( h->buckets );
+    free( h );
+}
+
+/* Builds the node of the given level whose top left cell is the board's cell x, y */
+quadtree_node* node_from_board( hashlife *h, board *b, int x, int y, int level )
+{
+    if ( x >= b->columns || y >= b->rows || h->out_of_memory )
+    {
+        return empty_node( h, level );
+    }
+    if ( level == 0 )
+    {
+        return cell_state( x, y, b ) ? &h->living_leaf : &h->dead_leaf;
+    }
+    // Nodes up to 64 cells wide lie within one word of each row, skip them if the words are empty
+    Sint64 size = ( Sint64 ) 1 << level;
+    if ( size <= CELLS_PER_WORD )
+    {
+        cell_word mask = ( size == CELLS_PER_WORD ? ~( cell_word ) 0 : ( ( cell_word ) 1 << size ) - 1 ) << ( x % CELLS_PER_WORD );
+        cell_word cells = 0;
+        for ( int row = y; row < y + size && row < b->rows; row++ )
+        {
+            cells |= b->grid[ ( Sint64 ) row*b->words_per_row + x / CELLS_PER_WORD ] & mask;
+        }
+        if ( !cells )
+        {
+            return empty_node( h, level );
+        }
+    }
+    int half = ( int ) ( size / 2 );
+    return find_node( h,
+                      node_from_board( h, b, x, y, level - 1 ),
+                      node_from_board( h, b, x + half, y, level - 1 ),
+                      node_from_board( h, b, x, y + half, level - 1 ),
+                      node_from_board( h, b, x + half, y + half, level - 1 ) );
+}
+
+bool hashlife_load_board( hashlife* h, board* b )
+{
+    int level = 3;
+    while ( ( ( Uint64 ) 1 << level ) < ( Uint64 ) b->rows || ( ( Uint64 ) 1 << level ) < ( Uint64 ) b->columns )
+    {
+        level++;
+    }
+    // The memoized results only hold for the rule they were computed with
+    if ( h->rule.birth != b->rule.birth || h->rule.survival != b->rule.survival )
+    {
+        forget_results( h );
+        h->rule = b->rule;
+    }
+    h->out_of_memory = FALSE;
+    h->root = node_from_board( h, b, 0, 0, level );
+    h->origin_x = h->origin_y = ( Sint64 ) 1 << ( level - 1 );
+    h->generation = 0;
+    if ( h->out_of_memory )
+    {
+        fprintf( stderr, "error loading the board into hashlife: more than %.1f MiB of nodes\n", h->memory_limit / ( 1024.0 * 1024.0 ) );
+        h->root = h->empty[ 3 ];
+        free_unused_nodes( h );
+        return FALSE;
+    }
+    enforce_memory_limit( h );
+    return TRUE;
+}
+
+/* Brings the living cells of n to life in the board. x and y are the board coordinates of n's top left cell */
+void node_to_board( quadtree_node *n, board *b, Sint64 x, Sint64 y )
+{
+    Sint64 size = ( Sint64 ) 1 << n->level;
+    if ( n->population == 0 || x >= b->columns || y >= b->rows || x + size <= 0 || y + size <= 0 )
+    {
+        return;
+    }
+    if ( n->level == 0 )
+    {
+        toggle_cell_state( ( int ) x, ( int ) y, b );
+        return;
+    }
+    Sint64 half = size / 2;
+    node_to_board( n->nw, b, x, y );
+    node_to_board( n->ne, b, x + half, y );
+    node_to_board( n->sw, b, x, y + half );
+    node_to_board( n->se, b, x + half, y + half );
+}
+
+void hashlife_store_board( hashlife* h, board* b )
+{
+    kill_all_cells( b );
+    Sint64 half = ( Sint64 ) 1 << ( h->root->level - 1 );
+    node_to_board( h->root, b, h->origin_x - half, h->origin_y - half );
+}
+
+bool hashlife_can_advance_board( board* b, int log2_generations )
+{
+    if ( b->boundary != BOUNDARY_DEAD )
+    {
+        return FALSE;
+    }
+    if ( b->living_cells == 0 )
+    {
+        return TRUE;
+    }
+    Sint64 margin = ( Sint64 ) 1 << log2_generations;
+    if ( 2 * margin >= b->rows || 2 * margin >= b->columns )
+    {
+        return FALSE;
+    }
+    int margin_words = ( int ) ( ( margin + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD );
+    cell_word *cells = malloc( margin_words * sizeof( cell_word ) );
+    bool clear = TRUE;
+    for ( int y = 0; y < b->rows && clear; y++ )
+    {
+        const cell_word *row = b->grid + ( Sint64 ) y * b->words_per_row;
+        if ( y < margin || y >= b->rows - margin )
+        {
+            // The rows at the top and bottom have to be dead all the way
+            for ( int word = 0; word < b->words_per_row; word++ )
+            {
+                clear &= row[ word ] == 0;
+            }
+            continue;
+        }
+        // The other rows only at their ends
+        // read_board_row reads whole words, the cells past the margin are masked off
+        read_board_row( b, 0, y, ( int ) margin, cells );
+        cells[ margin_words - 1 ] &= last_word_mask( ( int ) margin );
+        for ( int word = 0; word < margin_words; word++ )
+        {
+            clear &= cells[ word ] == 0;
+        }
+        read_board_row( b, b->columns - margin, y, ( int ) margin, cells );
+        cells[ margin_words - 1 ] &= last_word_mask( ( int ) margin );
+        for ( int word = 0; word < margin_words; word++ )
+        {
+            clear &= cells[ word ] == 0;
+        }
+    }
+    free( cells );
+    return clear;
+}
+
+bool hashlife_advance_board( hashlife* h, board* b, int log2_generations )
+{
+    if ( !hashlife_can_advance_board( b, log2_generations ) || !hashlife_load_board( h, b ) || !hashlife_step( h, log2_generations ) )
+    {
+        return FALSE;
+    }
+    hashlife_store_board( h, b );
+    b->generation += ( Uint64 ) 1 << log2_generations;
+    return TRUE;
+}
+
+bool hashlife_step( hashlife* h, int log2_generations )
+{
+    assert( log2_generations >= 0 && log2_generations <= MAX_LEVEL - 3 );
+    if ( log2_generations != h->step_log )
+    {
+        // The memoized results are only valid for one step size
+        forget_results( h );
+        h->step_log = log2_generations;
+    }
+
+    quadtree_node *root = h->root;
+    // A step that runs out of memory is tried again once without the memoized results
+    for ( int attempt = 0; attempt < 2; attempt++ )
+    {
+        h->out_of_memory = FALSE;
+        // Nothing may reach the root's borders while it is advanced, so there has to be enough empty space around the cells
+        quadtree_node *expanded = root;
+        while ( !h->out_of_memory && ( expanded->level < log2_generations + 3 || !in_center_quarter( expanded ) ) )
+        {
+            assert( expanded->level < MAX_LEVEL );
+            expanded = expand( h, expanded );
+        }
+        quadtree_node *advanced = advance( h, expanded );
+        if ( !h->out_of_memory )
+        {
+            h->root = advanced;
+            h->generation += ( Uint64 ) 1 << log2_generations;
+            enforce_memory_limit( h );
+            return TRUE;
+        }
+        // The results of the abandoned step may hold the empty nodes that stood in for the missing ones
+        h->root = root;
+        free_unused_nodes( h );
+    }
+    fprintf( stderr, "error advancing hashlife: more than %.1f MiB of nodes\n", h->memory_limit / ( 1024.0 * 1024.0 ) );
+    return FALSE;
+}
+
+Uint64 hashlife_population( hashlife* h )
+{
+    return h->root->population;
+}
+
+Uint64 hashlife_generation( hashlife* h )
+{
+    return h->generation;
+}
+
+// Rules without births on 0 neighbors, the infinite plane would fill up with them
+const char *CHECKED_HASHLIFE_RULES[ ] = { "B3/S23", "B36/S23", "B3678/S34678", "B2/S", "B35678/S5678" };
+
+int check_hashlife( int board_count )
+{
+    int failed_checks = 0;
+    int rule_count = sizeof( CHECKED_HASHLIFE_RULES ) / sizeof( CHECKED_HASHLIFE_RULES[ 0 ] );
+    hashlife *h = create_hashlife( ( size_t ) 64 << 20 );
+    random_generator g;
+    seed_generator( &g, DEFAULT_RANDOM_SEED, 3 );
+    for ( int i = 0; h && i < board_count; i++ )
+    {
+        int log2_generations = ( int ) random_below( &g, 6 );
+        int margin = 1 << log2_generations;
+        int rows = 2 * margin + 1 + ( int ) random_below( &g, 250 );
+        int columns = 2 * margin + 1 + ( int ) random_below( &g, 250 );
+        life_rule rule;
+        parse_life_rule( CHECKED_HASHLIFE_RULES[ i % rule_count ], &rule );
+        board *b = create_board( rows, columns );
+        board *expected = create_board( rows, columns );
+        set_board_rule( b, rule );
+        set_board_rule( expected, rule );
+        // A soup that reaches right up to the margin, so the cells just past it are checked as well
+        for ( int y = margin; y < rows - margin; y++ )
+        {
+            for ( int x = margin; x < columns - margin; x++ )
+            {
+                if ( random_below( &g, 100 ) < 35 )
+                {
+                    toggle_cell_state( x, y, b );
+                }
+            }
+        }
+        load_board_grid( expected, b->grid );
+        for ( int generation = 0; generation < margin; generation++ )
+        {
+            update_board( expected );
+        }
+        bool same = hashlife_advance_board( h, b, log2_generations ) && b->generation == expected->generation &&
+                    b->living_cells == expected->living_cells &&
+                    memcmp( b->grid, expected->grid, ( size_t ) rows * b->words_per_row * sizeof( cell_word ) ) == 0;
+        // A single living cell within the left or right margin has to be refused
+        kill_all_cells( b );
+        int x = ( int ) random_below( &g, margin );
+        toggle_cell_state( random_below( &g, 2 ) ? x : columns - 1 - x, ( int ) random_below( &g, rows ), b );
+        same &= !hashlife_can_advance_board( b, log2_generations );
+        if ( !same )
+        {
+            fprintf( stderr, "hashlife differs from %d calls of update_board on a %dx%d board with the rule %s\n",
+                     margin, columns, rows, CHECKED_HASHLIFE_RULES[ i % rule_count ] );
+            failed_checks++;
+        }
+        free_board( b );
+        free_board( expected );
+    }
+    failed_checks += h == NULL;
+    destroy_hashlife( h );
+    printf( "%d hashlife jumps, %d failed checks\n", board_count, failed_checks );
+    return failed_checks;
+}
@@ -0,0 +1,79 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include "board.h"
+
+/*
+ * A HashLife universe: an infinite plane stored as a quadtree of canonical ( shared ) nodes.
+ * The next states of the nodes are memoized, so repetitive patterns can be advanced by
+ * 2^k generations at the cost of a few node lookups.
+ */
+typedef struct hashlife hashlife;
+
+
+/**
+* Create an empty universe. The nodes and their hash table use at most memory_limit bytes. Once half of it is used
+* the unused nodes are freed between steps, together with the memoized results if most nodes are still in use.
+* Prints an error and returns NULL if the universe can't be allocated.
+*/
+hashlife* create_hashlife( size_t memory_limit );
+
+/**
+* Free the universe and all of its nodes.
+*/
+void destroy_hashlife( hashlife* h );
+
+/**
+* Replace the universe's cells with the cells of the board.
+* The board's cell (0, 0) becomes the universe's cell (0, 0). The universe follows the board's rule from now on.
+* Prints an error and returns FALSE if the board's nodes don't fit into the memory limit, the universe is empty then.
+*/
+bool hashlife_load_board( hashlife* h, board* b );
+
+/**
+* Write the part of the universe that overlaps the board into it. Cells outside of the board are dropped.
+*/
+void hashlife_store_board( hashlife* h, board* b );
+
+/**
+* Return whether loading the board, advancing it by 2^log2_generations generations and storing it gives the same cells
+* as that many update_board calls. That is the case if the boundary is dead and no living cell is within 2^log2_generations
+* cells of an edge, so nothing can grow past the edge in time. Otherwise the infinite plane would keep cells the board kills.
+*/
+bool hashlife_can_advance_board( board* b, int log2_generations );
+
+/**
+* Advance the board by 2^log2_generations generations through the universe, the same as that many update_board calls.
+* Returns FALSE and leaves the board alone if hashlife_can_advance_board refuses it or the nodes don't fit into the memory limit.
+*/
+bool hashlife_advance_board( hashlife* h, board* b, int log2_generations );
+
+/**
+* Advance the universe by 2^log2_generations generations.
+* Unlike update_board the universe has no edges, patterns keep moving past the board's borders.
+* Prints an error and returns FALSE if the step needs more nodes than the memory limit allows, the universe is left as it was.
+*/
+bool hashlife_step( hashlife* h, int log2_generations );
+
+/**
+* Return the number of living cells in the universe.
+*/
+Uint64 hashlife_population( hashlife* h );
+
+/**
+* Return the number of generations the universe has been advanced since it was loaded.
+*/
+Uint64 hashlife_generation( hashlife* h );
+
+/**
+* Return the number of bytes used by the nodes and the hash table.
+*/
+size_t hashlife_memory_usage( hashlife* h );
+
+/**
+* Compare hashlife_advance_board with update_board on board_count random soups with several rules, sizes and jumps
+* and print the results. Returns the number of mismatches.
+*/
+int check_hashlife( int board_count );
+
+#endif
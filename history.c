@@ -0,0 +1,483 @@
+#include "history.h"
+#include "random_generator.h"
+
+// A tile's entry: the number of unchanged tiles since the last one ( at most 10 bytes ), the mask of its changed rows
+// and one word per changed row
+#define MAX_TILE_ENTRY_SIZE ( 10 + sizeof( Uint64 ) + TILE_ROWS * sizeof( cell_word ) )
+
+typedef struct
+{
+    Uint64 generation;
+    // Keyframes are XORed with a dead board, deltas with the previous entry
+    bool keyframe;
+    size_t size;
+    Uint8 *data;
+} history_entry;
+
+struct board_history
+{
+    int rows;
+    int words_per_row;
+    int tile_rows;
+    int tile_columns;
+    // The copy of the cells counts towards the budget as well as the entries
+    size_t memory_budget;
+    size_t memory_used;
+
+    // A ring of entries, the oldest one is always a keyframe
+    history_entry *entries;
+    int capacity;
+    int first;
+    int count;
+    // The deltas after the newest keyframe
+    int since_keyframe;
+
+    // The cells, generation and change stamp of the board when the newest entry was made
+    cell_word *cells;
+    Uint64 generation;
+    Uint64 stamp;
+
+    // The entry that is being encoded
+    Uint8 *buffer;
+    size_t buffer_size;
+};
+
+static inline size_t history_grid_size( board_history *h )
+{
+    return ( size_t ) h->rows * h->words_per_row * sizeof( cell_word );
+}
+
+static inline history_entry *entry_at( board_history *h, int index )
+{
+    return &h->entries[ ( h->first + index ) % h->capacity ];
+}
+
+/* Writes value in 7 bit groups, the high bit of a byte is set if another one follows. Returns the number of bytes. */
+int write_varint( Uint8 *out, Uint64 value )
+{
+    int size = 0;
+    while ( value >= 0x80 )
+    {
+        out[ size++ ] = ( Uint8 ) ( value | 0x80 );
+        value >>= 7;
+    }
+    out[ size++ ] = ( Uint8 ) value;
+    return size;
+}
+
+Uint64 read_varint( const Uint8 *data, size_t *position )
+{
+    Uint64 value = 0;
+    int shift = 0;
+    Uint8 byte;
+    do
+    {
+        byte = data[ ( *position )++ ];
+        value |= ( Uint64 ) ( byte & 0x7f ) << shift;
+        shift += 7;
+    } while ( byte & 0x80 );
+    return value;
+}
+
+/*
+ * Encodes the XOR of the board's cells and base ( a dead board if base is NULL ) into the buffer and sets size to its size.
+ * If changed_only is TRUE only the tiles stamped after since are compared, the others have to match base already.
+ * base is updated to the board's cells. Returns FALSE if the buffer can't grow, base is then only partly updated.
+ */
+bool encode_cells( board_history *h, board *b, cell_word *base, bool changed_only, Uint64 since, size_t *encoded_size )
+{
+    size_t size = 0;
+    Sint64 last_tile = -1;
+    for ( int tile_y = 0; tile_y < h->tile_rows; tile_y++ )
+    {
+        int first_row = tile_y * TILE_ROWS;
+        int rows = h->rows - first_row < TILE_ROWS ? h->rows - first_row : TILE_ROWS;
+        for ( int tile_x = 0; tile_x < h->tile_columns; tile_x++ )
+        {
+            Sint64 tile = ( Sint64 ) tile_y * h->tile_columns + tile_x;
+            if ( changed_only && b->tile_stamps[ tile ] <= since )
+            {
+                continue;
+            }
+            if ( h->buffer_size < size + MAX_TILE_ENTRY_SIZE )
+            {
+                Uint8 *buffer = realloc( h->buffer, 2 * ( size + MAX_TILE_ENTRY_SIZE ) );
+                if ( !buffer )
+                {
+                    return FALSE;
+                }
+                h->buffer = buffer;
+                h->buffer_size = 2 * ( size + MAX_TILE_ENTRY_SIZE );
+            }
+            size_t tile_start = size;
+            size += write_varint( h->buffer + size, ( Uint64 ) ( tile - last_tile - 1 ) );
+            size_t mask_position = size;
+            size += sizeof( Uint64 );
+            Uint64 mask = 0;
+            for ( int row = 0; row < rows; row++ )
+            {
+                Sint64 index = ( Sint64 ) ( first_row + row ) * h->words_per_row + tile_x;
+                cell_word change = b->grid[ index ] ^ ( base ? base[ index ] : 0 );
+                // Branchless, about half of the words of a chaotic region change
+                memcpy( h->buffer + size, &change, sizeof( cell_word ) );
+                size += change ? sizeof( cell_word ) : 0;
+                mask |= ( Uint64 ) ( change != 0 ) << row;
+                if ( base )
+                {
+                    base[ index ] = b->grid[ index ];
+                }
+            }
+            // Tiles without changes aren't stored
+            if ( !mask )
+            {
+                size = tile_start;
+                continue;
+            }
+            memcpy( h->buffer + mask_position, &mask, sizeof( Uint64 ) );
+            last_tile = tile;
+        }
+    }
+    *encoded_size = size;
+    return TRUE;
+}
+
+/* XORs the entry into cells */
+void apply_entry( board_history *h, const history_entry *entry, cell_word *cells )
+{
+    size_t position = 0;
+    Sint64 tile = -1;
+    while ( position < entry->size )
+    {
+        tile += ( Sint64 ) read_varint( entry->data, &position ) + 1;
+        Uint64 mask;
+        memcpy( &mask, entry->data + position, sizeof( Uint64 ) );
+        position += sizeof( Uint64 );
+        int tile_y = ( int ) ( tile / h->tile_columns );
+        int tile_x = ( int ) ( tile % h->tile_columns );
+        for ( int row = 0; mask; row++, mask >>= 1 )
+        {
+            if ( mask & 1 )
+            {
+                cell_word change;
+                memcpy( &change, entry->data + position, sizeof( cell_word ) );
+                position += sizeof( cell_word );
+                cells[ ( Sint64 ) ( tile_y * TILE_ROWS + row ) * h->words_per_row + tile_x ] ^= change;
+            }
+        }
+    }
+}
+
+void free_entry( board_history *h, history_entry *entry )
+{
+    h->memory_used -= entry->size + sizeof( history_entry );
+    free( entry->data );
+    entry->data = NULL;
+}
+
+void forget_all_generations( board_history *h )
+{
+    for ( int i = 0; i < h->count; i++ )
+    {
+        free_entry( h, entry_at( h, i ) );
+    }
+    h->first = 0;
+    h->count = 0;
+    h->since_keyframe = 0;
+}
+
+/* Drops the oldest keyframe and the deltas after it, returns FALSE if it is the only keyframe */
+bool drop_oldest_keyframe( board_history *h )
+{
+    int next_keyframe = 1;
+    while ( next_keyframe < h->count && !entry_at( h, next_keyframe )->keyframe )
+    {
+        next_keyframe++;
+    }
+    if ( next_keyframe == h->count )
+    {
+        return FALSE;
+    }
+    for ( int i = 0; i < next_keyframe; i++ )
+    {
+        free_entry( h, entry_at( h, i ) );
+    }
+    h->first = ( h->first + next_keyframe ) % h->capacity;
+    h->count -= next_keyframe;
+    return TRUE;
+}
+
+/* Returns FALSE and leaves the history as it is if there is no memory for the entry */
+bool append_entry( board_history *h, Uint64 generation, bool keyframe, size_t size )
+{
+    Uint8 *data = NULL;
+    if ( size )
+    {
+        data = malloc( size );
+        if ( !data )
+        {
+            return FALSE;
+        }
+        memcpy( data, h->buffer, size );
+    }
+    if ( h->count == h->capacity )
+    {
+        // Unwrap the ring into the bigger array
+        int capacity = h->capacity ? 2 * h->capacity : HISTORY_KEYFRAME_INTERVAL;
+        history_entry *entries = malloc( capacity * sizeof( history_entry ) );
+        if ( !entries )
+        {
+            free( data );
+            return FALSE;
+        }
+        for ( int i = 0; i < h->count; i++ )
+        {
+            entries[ i ] = *entry_at( h, i );
+        }
+        free( h->entries );
+        h->entries = entries;
+        h->capacity = capacity;
+        h->first = 0;
+    }
+    history_entry *entry = entry_at( h, h->count++ );
+    entry->generation = generation;
+    entry->keyframe = keyframe;
+    entry->size = size;
+    entry->data = data;
+    h->memory_used += size + sizeof( history_entry );
+    h->since_keyframe = keyframe ? 0 : h->since_keyframe + 1;
+    return TRUE;
+}
+
+board_history* create_board_history( board* b, size_t memory_budget )
+{
+    board_history *h = calloc( 1, sizeof( board_history ) );
+    if ( !h )
+    {
+        fprintf( stderr, "error creating the history of a %d x %d board\n", b->rows, b->columns );
+        return NULL;
+    }
+    h->rows = b->rows;
+    h->words_per_row = b->words_per_row;
+    h->tile_rows = b->tile_rows;
+    h->tile_columns = b->tile_columns;
+    h->memory_budget = memory_budget;
+    if ( history_grid_size( h ) > memory_budget )
+    {
+        fprintf( stderr, "error creating the history of a %d x %d board: a copy of its cells needs more than %.1f MiB\n",
+                 b->rows, b->columns, memory_budget / ( 1024.0 * 1024 ) );
+        free( h );
+        return NULL;
+    }
+    h->cells = malloc( history_grid_size( h ) );
+    if ( !h->cells )
+    {
+        fprintf( stderr, "error creating the history of a %d x %d board\n", b->rows, b->columns );
+        free( h );
+        return NULL;
+    }
+    h->memory_used = history_grid_size( h );
+    return h;
+}
+
+void destroy_board_history( board_history* h )
+{
+    forget_all_generations( h );
+    free( h->entries );
+    free( h->cells );
+    free( h->buffer );
+    free( h );
+}
+
+void remember_generation( board_history* h, board* b )
+{
+    // The board started over
+    if ( h->count && b->generation < h->generation )
+    {
+        forget_all_generations( h );
+    }
+    if ( h->count && b->generation == h->generation && b->change_stamp == h->stamp )
+    {
+        return;
+    }
+    bool keyframe = !h->count || h->since_keyframe + 1 >= HISTORY_KEYFRAME_INTERVAL;
+    size_t size;
+    bool encoded;
+    if ( keyframe )
+    {
+        encoded = encode_cells( h, b, NULL, FALSE, 0, &size );
+        memcpy( h->cells, b->grid, history_grid_size( h ) );
+    }
+    else
+    {
+        // The tiles stamped since the last entry cover any number of updates and edits, only a bulk change needs every tile compared
+        encoded = encode_cells( h, b, h->cells, b->all_tiles_stamp <= h->stamp, h->stamp, &size );
+    }
+    // Without memory the generation isn't remembered, the cells of the last entry may be gone so the history starts over
+    if ( !encoded )
+    {
+        fprintf( stderr, "error remembering generation %llu: no memory\n", ( unsigned long long ) b->generation );
+        forget_all_generations( h );
+        return;
+    }
+    h->generation = b->generation;
+    h->stamp = b->change_stamp;
+
+    size_t cost = size + sizeof( history_entry );
+    while ( h->memory_used + cost > h->memory_budget && drop_oldest_keyframe( h ) )
+    {
+    }
+    // A keyframe doesn't need the entries before it
+    if ( h->memory_used + cost > h->memory_budget && keyframe )
+    {
+        forget_all_generations( h );
+    }
+    if ( h->memory_used + cost > h->memory_budget )
+    {
+        // A single keyframe and its deltas don't fit, start over with a keyframe. A keyframe that doesn't fit isn't remembered.
+        forget_all_generations( h );
+        if ( !keyframe )
+        {
+            remember_generation( h, b );
+        }
+        return;
+    }
+    if ( !append_entry( h, b->generation, keyframe, size ) )
+    {
+        fprintf( stderr, "error remembering generation %llu: no memory\n", ( unsigned long long ) b->generation );
+        // A delta after the missing entry couldn't be applied
+        forget_all_generations( h );
+    }
+}
+
+bool rewind_board( board_history* h, board* b, Uint64 generations )
+{
+    if ( !h->count )
+    {
+        return FALSE;
+    }
+    Uint64 target = b->generation > generations ? b->generation - generations : 0;
+    if ( target < entry_at( h, 0 )->generation )
+    {
+        target = entry_at( h, 0 )->generation;
+    }
+    // The newest entry at or before the target, the edits of a generation are entries of their own
+    int index = h->count - 1;
+    while ( index > 0 && entry_at( h, index )->generation > target )
+    {
+        index--;
+    }
+    int keyframe = index;
+    while ( !entry_at( h, keyframe )->keyframe )
+    {
+        keyframe--;
+    }
+    memset( h->cells, 0, history_grid_size( h ) );
+    for ( int i = keyframe; i <= index; i++ )
+    {
+        apply_entry( h, entry_at( h, i ), h->cells );
+    }
+    // The generations after it are computed again
+    for ( int i = index + 1; i < h->count; i++ )
+    {
+        free_entry( h, entry_at( h, i ) );
+    }
+    h->count = index + 1;
+    h->since_keyframe = index - keyframe;
+
+    load_board_grid( b, h->cells );
+    b->generation = entry_at( h, index )->generation;
+    h->generation = b->generation;
+    h->stamp = b->change_stamp;
+    return TRUE;
+}
+
+Uint64 oldest_remembered_generation( board_history* h )
+{
+    return h->count ? entry_at( h, 0 )->generation : 0;
+}
+
+size_t history_memory_used( board_history* h )
+{
+    return h->memory_used;
+}
+
+// The generations a checked board is updated to, every one of them is kept to compare the rewinds with
+#define CHECKED_GENERATIONS 300
+
+int check_board_history( int board_count )
+{
+    int failed_checks = 0;
+    random_generator g;
+    seed_generator( &g, DEFAULT_RANDOM_SEED, 1 );
+    for ( int i = 0; i < board_count; i++ )
+    {
+        int rows = 1 + ( int ) random_below( &g, 300 );
+        int columns = 1 + ( int ) random_below( &g, 300 );
+        board *b = create_board( rows, columns );
+        set_board_boundary( b, ( boundary_mode ) ( i % 3 ) );
+        fill_board_random( b, 0.3 );
+        size_t grid_size = ( size_t ) rows * b->words_per_row * sizeof( cell_word );
+        size_t words = grid_size / sizeof( cell_word );
+        // Every other history only has room for a few keyframes, so its oldest ones are dropped
+        size_t budget = i % 2 ? 8 * grid_size + 4096 : ( size_t ) 64 << 20;
+        board_history *h = create_board_history( b, budget );
+        // The cells of every generation as they were remembered last, the edits of a generation replace its cells
+        cell_word *expected = malloc( ( CHECKED_GENERATIONS + 1 ) * grid_size );
+        bool differs = !h || !expected;
+        if ( !differs )
+        {
+            remember_generation( h, b );
+            memcpy( expected, b->grid, grid_size );
+        }
+        for ( int step = 0; step < 1000 && !differs; step++ )
+        {
+            Uint64 action = random_below( &g, 10 );
+            if ( action == 0 )
+            {
+                Uint64 generations = 1 + random_below( &g, 100 );
+                Uint64 target = b->generation > generations ? b->generation - generations : 0;
+                target = target > oldest_remembered_generation( h ) ? target : oldest_remembered_generation( h );
+                if ( rewind_board( h, b, generations ) )
+                {
+                    differs = b->generation != target || b->living_cells != count_living_cells( b ) ||
+                              memcmp( b->grid, expected + target * words, grid_size ) != 0;
+                }
+                continue;
+            }
+            if ( action == 1 )
+            {
+                toggle_cell_state( ( int ) random_below( &g, columns ), ( int ) random_below( &g, rows ), b );
+            }
+            else if ( action == 2 )
+            {
+                set_cells_alive( ( int ) random_below( &g, columns ), ( int ) random_below( &g, rows ), 1 + ( int ) random_below( &g, 200 ), b );
+            }
+            else if ( action == 3 && random_below( &g, 20 ) == 0 )
+            {
+                // A bulk change, every tile is compared
+                kill_all_cells( b );
+            }
+            else if ( b->generation < CHECKED_GENERATIONS )
+            {
+                update_board( b );
+            }
+            remember_generation( h, b );
+            memcpy( expected + b->generation * words, b->grid, grid_size );
+            differs = history_memory_used( h ) > budget;
+        }
+        if ( differs )
+        {
+            fprintf( stderr, "the history of a %dx%d board with a %s boundary rewound to different cells\n",
+                     columns, rows, boundary_mode_name( b->boundary ) );
+            failed_checks++;
+        }
+        if ( h )
+        {
+            destroy_board_history( h );
+        }
+        free( expected );
+        free_board( b );
+    }
+    printf( "%d histories, %d failed checks\n", board_count, failed_checks );
+    return failed_checks;
+}
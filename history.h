@@ -0,0 +1,63 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "board.h"
+
+/*
+ * Remembers the past generations of a board so it can be rewound. Every HISTORY_KEYFRAME_INTERVAL entries the whole
+ * board is stored as a keyframe, the entries in between are deltas: the XOR of the cells with the previous entry's.
+ * Both only store the tiles that aren't zero and in them only the words that aren't zero, so an entry costs about as
+ * much as the number of words that changed ( or are alive, for a keyframe ) and the scan only visits the tiles whose
+ * change stamps are newer than the previous entry. Once the entries and the copy of the board's cells the deltas are
+ * taken against exceed the memory budget the oldest keyframe and its deltas are dropped.
+ * Rewinding decodes the nearest keyframe at or before the wanted generation and applies the deltas after it.
+ */
+typedef struct board_history board_history;
+
+// The number of entries from one keyframe to the next, a rewind applies fewer deltas than this
+#define HISTORY_KEYFRAME_INTERVAL 64
+
+
+/**
+* Create an empty history for boards with the size of b that keeps its entries and its copy of the board's cells in
+* at most memory_budget bytes. Prints an error and returns NULL if the copy doesn't fit into the budget or can't be allocated.
+*/
+board_history* create_board_history( board* b, size_t memory_budget );
+
+/**
+* Free the history.
+*/
+void destroy_board_history( board_history* h );
+
+/**
+* Remember the board's current cells as its current generation, called after every update and edit.
+* Generations after the previous entry that weren't remembered can't be rewound to. A board whose generation went
+* backwards ( e.g. populate_board ) starts a new history.
+*/
+void remember_generation( board_history* h, board* b );
+
+/**
+* Restore the board to its cells generations generations ago, or to the oldest generation that is remembered.
+* The remembered generations after it are forgotten, the board computes them again. Returns FALSE and leaves
+* the board alone if nothing is remembered.
+*/
+bool rewind_board( board_history* h, board* b, Uint64 generations );
+
+/**
+* Return the oldest generation the board can be rewound to, only meaningful if anything is remembered.
+*/
+Uint64 oldest_remembered_generation( board_history* h );
+
+/**
+* Return the number of bytes the remembered generations and the copy of the board's cells take.
+*/
+size_t history_memory_used( board_history* h );
+
+/**
+* Update, edit and rewind board_count random boards with histories, some with budgets that only hold a few keyframes,
+* and compare the rewound cells with the cells of the generation as they were remembered. Prints the results and
+* returns the number of mismatches.
+*/
+int check_board_history( int board_count );
+
+#endif
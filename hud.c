@@ -0,0 +1,101 @@
+#include "hud.h"
+
+#define HUD_LINE_SIZE 64
+// The number of step times in the graph
+#define GRAPH_GENERATIONS 256
+// The graph's height in font pixels
+#define GRAPH_HEIGHT 20
+// The window height that is drawn with one screen pixel per font pixel
+#define HUD_PIXEL_HEIGHT 360
+
+// The characters of the font, every glyph is 3 x 5 pixels. Bit 14 is the top left pixel, bit 0 the bottom right one.
+const char GLYPH_CHARACTERS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/+-%";
+const Uint16 GLYPHS[] =
+{
+    0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7249,
+    0x7bef, 0x7bcf, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4,
+    0x396b, 0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x6b6d,
+    0x2b6a, 0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a,
+    0x5bfd, 0x5aad, 0x5a92, 0x72a7, 0x0002, 0x0410, 0x12a4, 0x05d0,
+    0x01c0, 0x52a5
+};
+
+/* Draws upper case text with the top left corner at x, y, characters without a glyph are left empty */
+void draw_text( SDL_Renderer* renderer, int x, int y, int scale, const char* text )
+{
+    SDL_Rect pixels[ HUD_LINE_SIZE * 15 ];
+    int count = 0;
+    for ( int i = 0; text[ i ] && i < HUD_LINE_SIZE; i++ )
+    {
+        const char *glyph = strchr( GLYPH_CHARACTERS, toupper( ( unsigned char ) text[ i ] ) );
+        if ( !glyph )
+        {
+            continue;
+        }
+        Uint16 bits = GLYPHS[ glyph - GLYPH_CHARACTERS ];
+        for ( int pixel = 0; pixel < 15; pixel++ )
+        {
+            if ( bits >> ( 14 - pixel ) & 1 )
+            {
+                SDL_Rect r = { x + ( i * 4 + pixel % 3 ) * scale, y + pixel / 3 * scale, scale, scale };
+                pixels[ count++ ] = r;
+            }
+        }
+    }
+    SDL_RenderFillRects( renderer, pixels, count );
+}
+
+void draw_hud( SDL_Renderer* renderer, metrics* m, int window_height )
+{
+    generation_metrics recent[ GRAPH_GENERATIONS ];
+    int count = recent_generations( m, recent, GRAPH_GENERATIONS );
+    if ( !count )
+    {
+        return;
+    }
+    generation_metrics *newest = &recent[ count - 1 ];
+    double span = newest->time - recent[ 0 ].time;
+    double generations_per_second = span > 0 ? ( newest->generation - recent[ 0 ].generation ) / span : 0;
+    double max_step_ms = 0;
+    for ( int i = 0; i < count; i++ )
+    {
+        max_step_ms = recent[ i ].step_ms > max_step_ms ? recent[ i ].step_ms : max_step_ms;
+    }
+
+    char lines[ 6 ][ HUD_LINE_SIZE ];
+    snprintf( lines[ 0 ], HUD_LINE_SIZE, "GEN %llu  %.1f GEN/S", ( unsigned long long ) newest->generation, generations_per_second );
+    snprintf( lines[ 1 ], HUD_LINE_SIZE, "POP %llu", ( unsigned long long ) newest->population );
+    snprintf( lines[ 2 ], HUD_LINE_SIZE, "BORN %llu  DIED %llu", ( unsigned long long ) newest->births, ( unsigned long long ) newest->deaths );
+    snprintf( lines[ 3 ], HUD_LINE_SIZE, "STEP %.3f MS  MAX %.3f MS", newest->step_ms, max_step_ms );
+    snprintf( lines[ 4 ], HUD_LINE_SIZE, "DRAW %.3f MS", newest->render_ms );
+    snprintf( lines[ 5 ], HUD_LINE_SIZE, "ACTIVE %d", newest->active_regions );
+
+    // The font's pixels grow with the window
+    int scale = window_height / HUD_PIXEL_HEIGHT > 1 ? window_height / HUD_PIXEL_HEIGHT : 1;
+    int line_height = 7 * scale;
+    int width = ( GRAPH_GENERATIONS + 4 ) * scale;
+    int height = ( 6 * 7 + GRAPH_HEIGHT + 4 ) * scale;
+    SDL_Rect background = { 0, 0, width, height };
+    SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_BLEND );
+    SDL_SetRenderDrawColor( renderer, 0, 0, 0, 192 );
+    SDL_RenderFillRect( renderer, &background );
+
+    SDL_SetRenderDrawColor( renderer, 255, 255, 255, 255 );
+    for ( int line = 0; line < 6; line++ )
+    {
+        draw_text( renderer, 2 * scale, 2 * scale + line * line_height, scale, lines[ line ] );
+    }
+
+    // One bar per generation, scaled to the slowest step
+    SDL_Rect bars[ GRAPH_GENERATIONS ];
+    int graph_bottom = height - 2 * scale;
+    for ( int i = 0; i < count; i++ )
+    {
+        int bar_height = max_step_ms > 0 ? ( int ) ( recent[ i ].step_ms / max_step_ms * GRAPH_HEIGHT * scale + 0.5 ) : 0;
+        SDL_Rect bar = { ( 2 + GRAPH_GENERATIONS - count + i ) * scale, graph_bottom - bar_height, scale, bar_height };
+        bars[ i ] = bar;
+    }
+    SDL_SetRenderDrawColor( renderer, 80, 200, 80, 255 );
+    SDL_RenderFillRects( renderer, bars, count );
+    SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_NONE );
+}
@@ -0,0 +1,12 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include "metrics.h"
+
+/**
+* Draw an overlay with the newest generation's metrics and a graph of the recent step times
+* into the top left corner of the renderer. Doesn't present.
+*/
+void draw_hud( SDL_Renderer* renderer, metrics* m, int window_height );
+
+#endif
@@ -0,0 +1,741 @@
+#include "life_kernel.h"
+#include "life_rule.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define X86_64_KERNELS
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit instructions of other instruction sets in functions marked for them
+#if defined( X86_64_KERNELS ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#define TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#define TARGET_AVX512 __attribute__( ( target( "avx512f" ) ) )
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+SDL_bool always_supported( void )
+{
+    return SDL_TRUE;
+}
+
+#ifdef X86_64_KERNELS
+
+/*
+ * The vector kernels compute the same adders as next_cell_word and next_rule_word in board.c, one 64 bit lane per word.
+ * The words to the west and east of the lanes are loaded from one word before and after the vector.
+ * The first and last word of a row and the rows at the edges of the board are left to the scalar code.
+ */
+
+TARGET_SSE2 __m128i popcount_sse2( __m128i v )
+{
+    const __m128i m1 = _mm_set1_epi8( 0x55 );
+    const __m128i m2 = _mm_set1_epi8( 0x33 );
+    const __m128i m4 = _mm_set1_epi8( 0x0f );
+    v = _mm_sub_epi8( v, _mm_and_si128( _mm_srli_epi64( v, 1 ), m1 ) );
+    v = _mm_add_epi8( _mm_and_si128( v, m2 ), _mm_and_si128( _mm_srli_epi64( v, 2 ), m2 ) );
+    v = _mm_and_si128( _mm_add_epi8( v, _mm_srli_epi64( v, 4 ) ), m4 );
+    // Sum up the bytes of each lane
+    return _mm_sad_epu8( v, _mm_setzero_si128( ) );
+}
+
+TARGET_SSE2 __m128i next_cells_sse2( const cell_word *above, const cell_word *row, const cell_word *below )
+{
+    __m128i nw = _mm_loadu_si128( ( const __m128i* ) ( above - 1 ) );
+    __m128i n  = _mm_loadu_si128( ( const __m128i* ) ( above ) );
+    __m128i ne = _mm_loadu_si128( ( const __m128i* ) ( above + 1 ) );
+    __m128i w  = _mm_loadu_si128( ( const __m128i* ) ( row - 1 ) );
+    __m128i c  = _mm_loadu_si128( ( const __m128i* ) ( row ) );
+    __m128i e  = _mm_loadu_si128( ( const __m128i* ) ( row + 1 ) );
+    __m128i sw = _mm_loadu_si128( ( const __m128i* ) ( below - 1 ) );
+    __m128i s  = _mm_loadu_si128( ( const __m128i* ) ( below ) );
+    __m128i se = _mm_loadu_si128( ( const __m128i* ) ( below + 1 ) );
+
+    __m128i n_left  = _mm_or_si128( _mm_slli_epi64( n, 1 ), _mm_srli_epi64( nw, 63 ) );
+    __m128i n_right = _mm_or_si128( _mm_srli_epi64( n, 1 ), _mm_slli_epi64( ne, 63 ) );
+    __m128i c_left  = _mm_or_si128( _mm_slli_epi64( c, 1 ), _mm_srli_epi64( w, 63 ) );
+    __m128i c_right = _mm_or_si128( _mm_srli_epi64( c, 1 ), _mm_slli_epi64( e, 63 ) );
+    __m128i s_left  = _mm_or_si128( _mm_slli_epi64( s, 1 ), _mm_srli_epi64( sw, 63 ) );
+    __m128i s_right = _mm_or_si128( _mm_srli_epi64( s, 1 ), _mm_slli_epi64( se, 63 ) );
+
+    __m128i n_ones = _mm_xor_si128( _mm_xor_si128( n_left, n ), n_right );
+    __m128i n_twos = _mm_or_si128( _mm_and_si128( n_left, n ), _mm_and_si128( n_right, _mm_xor_si128( n_left, n ) ) );
+    __m128i c_ones = _mm_xor_si128( c_left, c_right );
+    __m128i c_twos = _mm_and_si128( c_left, c_right );
+    __m128i s_ones = _mm_xor_si128( _mm_xor_si128( s_left, s ), s_right );
+    __m128i s_twos = _mm_or_si128( _mm_and_si128( s_left, s ), _mm_and_si128( s_right, _mm_xor_si128( s_left, s ) ) );
+
+    __m128i ones = _mm_xor_si128( _mm_xor_si128( n_ones, c_ones ), s_ones );
+    __m128i ones_carry = _mm_or_si128( _mm_and_si128( n_ones, c_ones ), _mm_and_si128( s_ones, _mm_xor_si128( n_ones, c_ones ) ) );
+
+    __m128i twos_a = _mm_xor_si128( n_twos, c_twos );
+    __m128i twos_b = _mm_xor_si128( s_twos, ones_carry );
+    __m128i more_than_one_two = _mm_or_si128( _mm_and_si128( n_twos, c_twos ), _mm_and_si128( s_twos, ones_carry ) );
+    __m128i exactly_one_two = _mm_andnot_si128( more_than_one_two, _mm_xor_si128( twos_a, twos_b ) );
+
+    return _mm_and_si128( exactly_one_two, _mm_or_si128( ones, c ) );
+}
+
+/* Computes the bit planes of the neighbor counts of the cells at row, a cell's count is ones + 2 twos + 4 fours + 8 eights */
+ALWAYS_INLINE TARGET_SSE2 void count_neighbors_sse2( const cell_word *above, const cell_word *row, const cell_word *below,
+                                                     __m128i *ones, __m128i *twos, __m128i *fours, __m128i *eights )
+{
+    __m128i nw = _mm_loadu_si128( ( const __m128i* ) ( above - 1 ) );
+    __m128i n  = _mm_loadu_si128( ( const __m128i* ) ( above ) );
+    __m128i ne = _mm_loadu_si128( ( const __m128i* ) ( above + 1 ) );
+    __m128i w  = _mm_loadu_si128( ( const __m128i* ) ( row - 1 ) );
+    __m128i c  = _mm_loadu_si128( ( const __m128i* ) ( row ) );
+    __m128i e  = _mm_loadu_si128( ( const __m128i* ) ( row + 1 ) );
+    __m128i sw = _mm_loadu_si128( ( const __m128i* ) ( below - 1 ) );
+    __m128i s  = _mm_loadu_si128( ( const __m128i* ) ( below ) );
+    __m128i se = _mm_loadu_si128( ( const __m128i* ) ( below + 1 ) );
+
+    __m128i n_left  = _mm_or_si128( _mm_slli_epi64( n, 1 ), _mm_srli_epi64( nw, 63 ) );
+    __m128i n_right = _mm_or_si128( _mm_srli_epi64( n, 1 ), _mm_slli_epi64( ne, 63 ) );
+    __m128i c_left  = _mm_or_si128( _mm_slli_epi64( c, 1 ), _mm_srli_epi64( w, 63 ) );
+    __m128i c_right = _mm_or_si128( _mm_srli_epi64( c, 1 ), _mm_slli_epi64( e, 63 ) );
+    __m128i s_left  = _mm_or_si128( _mm_slli_epi64( s, 1 ), _mm_srli_epi64( sw, 63 ) );
+    __m128i s_right = _mm_or_si128( _mm_srli_epi64( s, 1 ), _mm_slli_epi64( se, 63 ) );
+
+    __m128i n_ones = _mm_xor_si128( _mm_xor_si128( n_left, n ), n_right );
+    __m128i n_twos = _mm_or_si128( _mm_and_si128( n_left, n ), _mm_and_si128( n_right, _mm_xor_si128( n_left, n ) ) );
+    __m128i c_ones = _mm_xor_si128( c_left, c_right );
+    __m128i c_twos = _mm_and_si128( c_left, c_right );
+    __m128i s_ones = _mm_xor_si128( _mm_xor_si128( s_left, s ), s_right );
+    __m128i s_twos = _mm_or_si128( _mm_and_si128( s_left, s ), _mm_and_si128( s_right, _mm_xor_si128( s_left, s ) ) );
+
+    *ones = _mm_xor_si128( _mm_xor_si128( n_ones, c_ones ), s_ones );
+    __m128i ones_carry = _mm_or_si128( _mm_and_si128( n_ones, c_ones ), _mm_and_si128( s_ones, _mm_xor_si128( n_ones, c_ones ) ) );
+
+    // Add the four twos into the full count
+    __m128i twos_sum = _mm_xor_si128( _mm_xor_si128( n_twos, c_twos ), s_twos );
+    __m128i twos_carry = _mm_or_si128( _mm_and_si128( n_twos, c_twos ), _mm_and_si128( s_twos, _mm_xor_si128( n_twos, c_twos ) ) );
+    *twos = _mm_xor_si128( twos_sum, ones_carry );
+    __m128i fours_carry = _mm_and_si128( twos_sum, ones_carry );
+    *fours = _mm_xor_si128( twos_carry, fours_carry );
+    *eights = _mm_and_si128( twos_carry, fours_carry );
+}
+
+/* The cells whose count is in counts, see select_rule_cells in board.c. low_k are the cells whose count is k modulo 4. */
+ALWAYS_INLINE TARGET_SSE2 __m128i select_counts_sse2( __m128i low_0, __m128i low_1, __m128i low_2, __m128i low_3, __m128i fours, __m128i eights,
+                                                      Uint16 counts )
+{
+    __m128i has_0 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 0 ) );
+    __m128i has_1 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 1 ) );
+    __m128i has_2 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 2 ) );
+    __m128i has_3 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 3 ) );
+    __m128i has_4 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 4 ) );
+    __m128i has_5 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 5 ) );
+    __m128i has_6 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 6 ) );
+    __m128i has_7 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 7 ) );
+    __m128i has_8 = _mm_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 8 ) );
+    __m128i below_four = _mm_or_si128( _mm_or_si128( _mm_and_si128( low_0, has_0 ), _mm_and_si128( low_1, has_1 ) ),
+                                       _mm_or_si128( _mm_and_si128( low_2, has_2 ), _mm_and_si128( low_3, has_3 ) ) );
+    __m128i four_to_seven = _mm_or_si128( _mm_or_si128( _mm_and_si128( low_0, has_4 ), _mm_and_si128( low_1, has_5 ) ),
+                                          _mm_or_si128( _mm_and_si128( low_2, has_6 ), _mm_and_si128( low_3, has_7 ) ) );
+    // Only the count 8 has eights set
+    return _mm_or_si128( _mm_or_si128( _mm_andnot_si128( _mm_or_si128( fours, eights ), below_four ), _mm_and_si128( fours, four_to_seven ) ),
+                         _mm_and_si128( eights, has_8 ) );
+}
+
+/* Like next_cells_sse2, but for the rule with the given bits */
+ALWAYS_INLINE TARGET_SSE2 __m128i next_rule_cells_sse2( const cell_word *above, const cell_word *row, const cell_word *below,
+                                                        Uint16 birth, Uint16 survival )
+{
+    __m128i ones, twos, fours, eights;
+    count_neighbors_sse2( above, row, below, &ones, &twos, &fours, &eights );
+    __m128i c = _mm_loadu_si128( ( const __m128i* ) ( row ) );
+    __m128i low_0 = _mm_andnot_si128( _mm_or_si128( ones, twos ), _mm_set1_epi64x( -1 ) );
+    __m128i low_1 = _mm_andnot_si128( twos, ones );
+    __m128i low_2 = _mm_andnot_si128( ones, twos );
+    __m128i low_3 = _mm_and_si128( ones, twos );
+    __m128i born = select_counts_sse2( low_0, low_1, low_2, low_3, fours, eights, birth );
+    __m128i survived = select_counts_sse2( low_0, low_1, low_2, low_3, fours, eights, survival );
+    return _mm_or_si128( _mm_andnot_si128( c, born ), _mm_and_si128( survived, c ) );
+}
+
+/*
+ * Only words that have a word to the west and to the east in the row can be part of a vector.
+ * Returns the index of the first such word of the range and updates the words before it with the scalar code.
+ */
+int update_words_before_vectors( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                 int first_word, int last_word, int words, cell_word last_word_mask,
+                                 int *living_cells_change, int *births )
+{
+    int first_vector_word = first_word > 0 ? first_word : 1;
+    *living_cells_change = 0;
+    if ( first_vector_word > first_word && first_word < last_word )
+    {
+        *living_cells_change = update_words( rule, above, row, below, out, first_word, first_vector_word, words, last_word_mask, births );
+    }
+    return first_vector_word;
+}
+
+/* The end of the words that can be part of a vector */
+int vector_words_end( int last_word, int words )
+{
+    return last_word < words - 1 ? last_word : words - 1;
+}
+
+/* Updates the words from i to last_word - 1 that are left over after the vectors with the scalar code */
+int update_words_after_vectors( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                int i, int last_word, int words, cell_word last_word_mask, int *births )
+{
+    return i < last_word ? update_words( rule, above, row, below, out, i, last_word, words, last_word_mask, births ) : 0;
+}
+
+/*
+ * Updates the vectors from word i to end for the rule with the given bits, see DISPATCH_LIFE_RULE.
+ * Adds the changes to living_cells_change and births and returns the first word that is left.
+ */
+ALWAYS_INLINE TARGET_SSE2 int update_vectors_sse2( const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                                   int i, int end, int *living_cells_change, int *births, Uint16 birth, Uint16 survival )
+{
+    __m128i born_counts = _mm_setzero_si128( );
+    __m128i died_counts = _mm_setzero_si128( );
+    for ( ; i + 2 <= end; i += 2 )
+    {
+        __m128i c = _mm_loadu_si128( ( const __m128i* ) ( row + i ) );
+        __m128i next = birth == CONWAY_BIRTH && survival == CONWAY_SURVIVAL ? next_cells_sse2( above + i, row + i, below + i )
+                                                                            : next_rule_cells_sse2( above + i, row + i, below + i, birth, survival );
+        _mm_storeu_si128( ( __m128i* ) ( out + i ), next );
+        born_counts = _mm_add_epi64( born_counts, popcount_sse2( _mm_andnot_si128( c, next ) ) );
+        died_counts = _mm_add_epi64( died_counts, popcount_sse2( _mm_andnot_si128( next, c ) ) );
+    }
+    cell_word born[ 2 ], died[ 2 ];
+    _mm_storeu_si128( ( __m128i* ) born, born_counts );
+    _mm_storeu_si128( ( __m128i* ) died, died_counts );
+    *births += ( int ) ( born[ 0 ] + born[ 1 ] );
+    *living_cells_change += ( int ) ( born[ 0 ] + born[ 1 ] ) - ( int ) ( died[ 0 ] + died[ 1 ] );
+    return i;
+}
+
+TARGET_SSE2 int update_words_sse2( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                   int first_word, int last_word, int words, cell_word last_word_mask, int *births )
+{
+    if ( !above || !below )
+    {
+        return update_words( rule, above, row, below, out, first_word, last_word, words, last_word_mask, births );
+    }
+    int living_cells_change;
+    int i = update_words_before_vectors( rule, above, row, below, out, first_word, last_word, words, last_word_mask,
+                                         &living_cells_change, births );
+    int end = vector_words_end( last_word, words );
+#define UPDATE_VECTORS( birth, survival ) \
+    i = update_vectors_sse2( above, row, below, out, i, end, &living_cells_change, births, birth, survival )
+    DISPATCH_LIFE_RULE( rule, UPDATE_VECTORS );
+#undef UPDATE_VECTORS
+    return living_cells_change + update_words_after_vectors( rule, above, row, below, out, i, last_word, words, last_word_mask, births );
+}
+
+TARGET_SSE2 Sint64 count_cells_sse2( const cell_word *words, Sint64 word_count )
+{
+    __m128i counts = _mm_setzero_si128( );
+    Sint64 i = 0;
+    for ( ; i + 2 <= word_count; i += 2 )
+    {
+        counts = _mm_add_epi64( counts, popcount_sse2( _mm_loadu_si128( ( const __m128i* ) ( words + i ) ) ) );
+    }
+    cell_word lanes[ 2 ];
+    _mm_storeu_si128( ( __m128i* ) lanes, counts );
+    return ( Sint64 ) ( lanes[ 0 ] + lanes[ 1 ] ) + count_cells( words + i, word_count - i );
+}
+
+/* Counts the bits of each lane with a nibble lookup table */
+TARGET_AVX2 __m256i popcount_avx2( __m256i v )
+{
+    const __m256i lookup = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+    const __m256i low_nibbles = _mm256_set1_epi8( 0x0f );
+    __m256i low = _mm256_and_si256( v, low_nibbles );
+    __m256i high = _mm256_and_si256( _mm256_srli_epi16( v, 4 ), low_nibbles );
+    __m256i bytes = _mm256_add_epi8( _mm256_shuffle_epi8( lookup, low ), _mm256_shuffle_epi8( lookup, high ) );
+    return _mm256_sad_epu8( bytes, _mm256_setzero_si256( ) );
+}
+
+TARGET_AVX2 __m256i next_cells_avx2( const cell_word *above, const cell_word *row, const cell_word *below )
+{
+    __m256i nw = _mm256_loadu_si256( ( const __m256i* ) ( above - 1 ) );
+    __m256i n  = _mm256_loadu_si256( ( const __m256i* ) ( above ) );
+    __m256i ne = _mm256_loadu_si256( ( const __m256i* ) ( above + 1 ) );
+    __m256i w  = _mm256_loadu_si256( ( const __m256i* ) ( row - 1 ) );
+    __m256i c  = _mm256_loadu_si256( ( const __m256i* ) ( row ) );
+    __m256i e  = _mm256_loadu_si256( ( const __m256i* ) ( row + 1 ) );
+    __m256i sw = _mm256_loadu_si256( ( const __m256i* ) ( below - 1 ) );
+    __m256i s  = _mm256_loadu_si256( ( const __m256i* ) ( below ) );
+    __m256i se = _mm256_loadu_si256( ( const __m256i* ) ( below + 1 ) );
+
+    __m256i n_left  = _mm256_or_si256( _mm256_slli_epi64( n, 1 ), _mm256_srli_epi64( nw, 63 ) );
+    __m256i n_right = _mm256_or_si256( _mm256_srli_epi64( n, 1 ), _mm256_slli_epi64( ne, 63 ) );
+    __m256i c_left  = _mm256_or_si256( _mm256_slli_epi64( c, 1 ), _mm256_srli_epi64( w, 63 ) );
+    __m256i c_right = _mm256_or_si256( _mm256_srli_epi64( c, 1 ), _mm256_slli_epi64( e, 63 ) );
+    __m256i s_left  = _mm256_or_si256( _mm256_slli_epi64( s, 1 ), _mm256_srli_epi64( sw, 63 ) );
+    __m256i s_right = _mm256_or_si256( _mm256_srli_epi64( s, 1 ), _mm256_slli_epi64( se, 63 ) );
+
+    __m256i n_ones = _mm256_xor_si256( _mm256_xor_si256( n_left, n ), n_right );
+    __m256i n_twos = _mm256_or_si256( _mm256_and_si256( n_left, n ), _mm256_and_si256( n_right, _mm256_xor_si256( n_left, n ) ) );
+    __m256i c_ones = _mm256_xor_si256( c_left, c_right );
+    __m256i c_twos = _mm256_and_si256( c_left, c_right );
+    __m256i s_ones = _mm256_xor_si256( _mm256_xor_si256( s_left, s ), s_right );
+    __m256i s_twos = _mm256_or_si256( _mm256_and_si256( s_left, s ), _mm256_and_si256( s_right, _mm256_xor_si256( s_left, s ) ) );
+
+    __m256i ones = _mm256_xor_si256( _mm256_xor_si256( n_ones, c_ones ), s_ones );
+    __m256i ones_carry = _mm256_or_si256( _mm256_and_si256( n_ones, c_ones ), _mm256_and_si256( s_ones, _mm256_xor_si256( n_ones, c_ones ) ) );
+
+    __m256i twos_a = _mm256_xor_si256( n_twos, c_twos );
+    __m256i twos_b = _mm256_xor_si256( s_twos, ones_carry );
+    __m256i more_than_one_two = _mm256_or_si256( _mm256_and_si256( n_twos, c_twos ), _mm256_and_si256( s_twos, ones_carry ) );
+    __m256i exactly_one_two = _mm256_andnot_si256( more_than_one_two, _mm256_xor_si256( twos_a, twos_b ) );
+
+    return _mm256_and_si256( exactly_one_two, _mm256_or_si256( ones, c ) );
+}
+
+/* Computes the bit planes of the neighbor counts of the cells at row, a cell's count is ones + 2 twos + 4 fours + 8 eights */
+ALWAYS_INLINE TARGET_AVX2 void count_neighbors_avx2( const cell_word *above, const cell_word *row, const cell_word *below,
+                                                     __m256i *ones, __m256i *twos, __m256i *fours, __m256i *eights )
+{
+    __m256i nw = _mm256_loadu_si256( ( const __m256i* ) ( above - 1 ) );
+    __m256i n  = _mm256_loadu_si256( ( const __m256i* ) ( above ) );
+    __m256i ne = _mm256_loadu_si256( ( const __m256i* ) ( above + 1 ) );
+    __m256i w  = _mm256_loadu_si256( ( const __m256i* ) ( row - 1 ) );
+    __m256i c  = _mm256_loadu_si256( ( const __m256i* ) ( row ) );
+    __m256i e  = _mm256_loadu_si256( ( const __m256i* ) ( row + 1 ) );
+    __m256i sw = _mm256_loadu_si256( ( const __m256i* ) ( below - 1 ) );
+    __m256i s  = _mm256_loadu_si256( ( const __m256i* ) ( below ) );
+    __m256i se = _mm256_loadu_si256( ( const __m256i* ) ( below + 1 ) );
+
+    __m256i n_left  = _mm256_or_si256( _mm256_slli_epi64( n, 1 ), _mm256_srli_epi64( nw, 63 ) );
+    __m256i n_right = _mm256_or_si256( _mm256_srli_epi64( n, 1 ), _mm256_slli_epi64( ne, 63 ) );
+    __m256i c_left  = _mm256_or_si256( _mm256_slli_epi64( c, 1 ), _mm256_srli_epi64( w, 63 ) );
+    __m256i c_right = _mm256_or_si256( _mm256_srli_epi64( c, 1 ), _mm256_slli_epi64( e, 63 ) );
+    __m256i s_left  = _mm256_or_si256( _mm256_slli_epi64( s, 1 ), _mm256_srli_epi64( sw, 63 ) );
+    __m256i s_right = _mm256_or_si256( _mm256_srli_epi64( s, 1 ), _mm256_slli_epi64( se, 63 ) );
+
+    __m256i n_ones = _mm256_xor_si256( _mm256_xor_si256( n_left, n ), n_right );
+    __m256i n_twos = _mm256_or_si256( _mm256_and_si256( n_left, n ), _mm256_and_si256( n_right, _mm256_xor_si256( n_left, n ) ) );
+    __m256i c_ones = _mm256_xor_si256( c_left, c_right );
+    __m256i c_twos = _mm256_and_si256( c_left, c_right );
+    __m256i s_ones = _mm256_xor_si256( _mm256_xor_si256( s_left, s ), s_right );
+    __m256i s_twos = _mm256_or_si256( _mm256_and_si256( s_left, s ), _mm256_and_si256( s_right, _mm256_xor_si256( s_left, s ) ) );
+
+    *ones = _mm256_xor_si256( _mm256_xor_si256( n_ones, c_ones ), s_ones );
+    __m256i ones_carry = _mm256_or_si256( _mm256_and_si256( n_ones, c_ones ), _mm256_and_si256( s_ones, _mm256_xor_si256( n_ones, c_ones ) ) );
+
+    // Add the four twos into the full count
+    __m256i twos_sum = _mm256_xor_si256( _mm256_xor_si256( n_twos, c_twos ), s_twos );
+    __m256i twos_carry = _mm256_or_si256( _mm256_and_si256( n_twos, c_twos ), _mm256_and_si256( s_twos, _mm256_xor_si256( n_twos, c_twos ) ) );
+    *twos = _mm256_xor_si256( twos_sum, ones_carry );
+    __m256i fours_carry = _mm256_and_si256( twos_sum, ones_carry );
+    *fours = _mm256_xor_si256( twos_carry, fours_carry );
+    *eights = _mm256_and_si256( twos_carry, fours_carry );
+}
+
+/* The cells whose count is in counts, see select_rule_cells in board.c. low_k are the cells whose count is k modulo 4. */
+ALWAYS_INLINE TARGET_AVX2 __m256i select_counts_avx2( __m256i low_0, __m256i low_1, __m256i low_2, __m256i low_3, __m256i fours, __m256i eights,
+                                                      Uint16 counts )
+{
+    __m256i has_0 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 0 ) );
+    __m256i has_1 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 1 ) );
+    __m256i has_2 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 2 ) );
+    __m256i has_3 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 3 ) );
+    __m256i has_4 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 4 ) );
+    __m256i has_5 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 5 ) );
+    __m256i has_6 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 6 ) );
+    __m256i has_7 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 7 ) );
+    __m256i has_8 = _mm256_set1_epi64x( ( long long ) RULE_COUNT_MASK( counts, 8 ) );
+    __m256i below_four = _mm256_or_si256( _mm256_or_si256( _mm256_and_si256( low_0, has_0 ), _mm256_and_si256( low_1, has_1 ) ),
+                                          _mm256_or_si256( _mm256_and_si256( low_2, has_2 ), _mm256_and_si256( low_3, has_3 ) ) );
+    __m256i four_to_seven = _mm256_or_si256( _mm256_or_si256( _mm256_and_si256( low_0, has_4 ), _mm256_and_si256( low_1, has_5 ) ),
+                                             _mm256_or_si256( _mm256_and_si256( low_2, has_6 ), _mm256_and_si256( low_3, has_7 ) ) );
+    // Only the count 8 has eights set
+    return _mm256_or_si256( _mm256_or_si256( _mm256_andnot_si256( _mm256_or_si256( fours, eights ), below_four ), _mm256_and_si256( fours, four_to_seven ) ),
+                            _mm256_and_si256( eights, has_8 ) );
+}
+
+/* Like next_cells_avx2, but for the rule with the given bits */
+ALWAYS_INLINE TARGET_AVX2 __m256i next_rule_cells_avx2( const cell_word *above, const cell_word *row, const cell_word *below,
+                                                        Uint16 birth, Uint16 survival )
+{
+    __m256i ones, twos, fours, eights;
+    count_neighbors_avx2( above, row, below, &ones, &twos, &fours, &eights );
+    __m256i c = _mm256_loadu_si256( ( const __m256i* ) ( row ) );
+    __m256i low_0 = _mm256_andnot_si256( _mm256_or_si256( ones, twos ), _mm256_set1_epi64x( -1 ) );
+    __m256i low_1 = _mm256_andnot_si256( twos, ones );
+    __m256i low_2 = _mm256_andnot_si256( ones, twos );
+    __m256i low_3 = _mm256_and_si256( ones, twos );
+    __m256i born = select_counts_avx2( low_0, low_1, low_2, low_3, fours, eights, birth );
+    __m256i survived = select_counts_avx2( low_0, low_1, low_2, low_3, fours, eights, survival );
+    return _mm256_or_si256( _mm256_andnot_si256( c, born ), _mm256_and_si256( survived, c ) );
+}
+
+TARGET_AVX2 Sint64 sum_lanes_avx2( __m256i counts )
+{
+    cell_word lanes[ 4 ];
+    _mm256_storeu_si256( ( __m256i* ) lanes, counts );
+    return ( Sint64 ) ( lanes[ 0 ] + lanes[ 1 ] + lanes[ 2 ] + lanes[ 3 ] );
+}
+
+/* Like update_vectors_sse2 */
+ALWAYS_INLINE TARGET_AVX2 int update_vectors_avx2( const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                                   int i, int end, int *living_cells_change, int *births, Uint16 birth, Uint16 survival )
+{
+    __m256i born_counts = _mm256_setzero_si256( );
+    __m256i died_counts = _mm256_setzero_si256( );
+    for ( ; i + 4 <= end; i += 4 )
+    {
+        __m256i c = _mm256_loadu_si256( ( const __m256i* ) ( row + i ) );
+        __m256i next = birth == CONWAY_BIRTH && survival == CONWAY_SURVIVAL ? next_cells_avx2( above + i, row + i, below + i )
+                                                                            : next_rule_cells_avx2( above + i, row + i, below + i, birth, survival );
+        _mm256_storeu_si256( ( __m256i* ) ( out + i ), next );
+        born_counts = _mm256_add_epi64( born_counts, popcount_avx2( _mm256_andnot_si256( c, next ) ) );
+        died_counts = _mm256_add_epi64( died_counts, popcount_avx2( _mm256_andnot_si256( next, c ) ) );
+    }
+    *births += sum_lanes_avx2( born_counts );
+    *living_cells_change += sum_lanes_avx2( born_counts ) - sum_lanes_avx2( died_counts );
+    return i;
+}
+
+TARGET_AVX2 int update_words_avx2( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                   int first_word, int last_word, int words, cell_word last_word_mask, int *births )
+{
+    if ( !above || !below )
+    {
+        return update_words( rule, above, row, below, out, first_word, last_word, words, last_word_mask, births );
+    }
+    int living_cells_change;
+    int i = update_words_before_vectors( rule, above, row, below, out, first_word, last_word, words, last_word_mask,
+                                         &living_cells_change, births );
+    int end = vector_words_end( last_word, words );
+#define UPDATE_VECTORS( birth, survival ) \
+    i = update_vectors_avx2( above, row, below, out, i, end, &living_cells_change, births, birth, survival )
+    DISPATCH_LIFE_RULE( rule, UPDATE_VECTORS );
+#undef UPDATE_VECTORS
+    // Words left over after the vectors are left to SSE2
+    return living_cells_change + ( i < last_word ? update_words_sse2( rule, above, row, below, out, i, last_word, words, last_word_mask, births ) : 0 );
+}
+
+TARGET_AVX2 Sint64 count_cells_avx2( const cell_word *words, Sint64 word_count )
+{
+    __m256i counts = _mm256_setzero_si256( );
+    Sint64 i = 0;
+    for ( ; i + 4 <= word_count; i += 4 )
+    {
+        counts = _mm256_add_epi64( counts, popcount_avx2( _mm256_loadu_si256( ( const __m256i* ) ( words + i ) ) ) );
+    }
+    return sum_lanes_avx2( counts ) + count_cells( words + i, word_count - i );
+}
+
+/* AVX-512F has no byte shuffles, so the bits are counted with shifts and adds within each lane */
+TARGET_AVX512 __m512i popcount_avx512( __m512i v )
+{
+    const __m512i m1 = _mm512_set1_epi64( 0x5555555555555555LL );
+    const __m512i m2 = _mm512_set1_epi64( 0x3333333333333333LL );
+    const __m512i m4 = _mm512_set1_epi64( 0x0f0f0f0f0f0f0f0fLL );
+    v = _mm512_sub_epi64( v, _mm512_and_si512( _mm512_srli_epi64( v, 1 ), m1 ) );
+    v = _mm512_add_epi64( _mm512_and_si512( v, m2 ), _mm512_and_si512( _mm512_srli_epi64( v, 2 ), m2 ) );
+    v = _mm512_and_si512( _mm512_add_epi64( v, _mm512_srli_epi64( v, 4 ) ), m4 );
+    v = _mm512_add_epi64( v, _mm512_srli_epi64( v, 8 ) );
+    v = _mm512_add_epi64( v, _mm512_srli_epi64( v, 16 ) );
+    v = _mm512_add_epi64( v, _mm512_srli_epi64( v, 32 ) );
+    return _mm512_and_si512( v, _mm512_set1_epi64( 0x7f ) );
+}
+
+TARGET_AVX512 __m512i next_cells_avx512( const cell_word *above, const cell_word *row, const cell_word *below )
+{
+    __m512i nw = _mm512_loadu_si512( above - 1 );
+    __m512i n  = _mm512_loadu_si512( above );
+    __m512i ne = _mm512_loadu_si512( above + 1 );
+    __m512i w  = _mm512_loadu_si512( row - 1 );
+    __m512i c  = _mm512_loadu_si512( row );
+    __m512i e  = _mm512_loadu_si512( row + 1 );
+    __m512i sw = _mm512_loadu_si512( below - 1 );
+    __m512i s  = _mm512_loadu_si512( below );
+    __m512i se = _mm512_loadu_si512( below + 1 );
+
+    __m512i n_left  = _mm512_or_si512( _mm512_slli_epi64( n, 1 ), _mm512_srli_epi64( nw, 63 ) );
+    __m512i n_right = _mm512_or_si512( _mm512_srli_epi64( n, 1 ), _mm512_slli_epi64( ne, 63 ) );
+    __m512i c_left  = _mm512_or_si512( _mm512_slli_epi64( c, 1 ), _mm512_srli_epi64( w, 63 ) );
+    __m512i c_right = _mm512_or_si512( _mm512_srli_epi64( c, 1 ), _mm512_slli_epi64( e, 63 ) );
+    __m512i s_left  = _mm512_or_si512( _mm512_slli_epi64( s, 1 ), _mm512_srli_epi64( sw, 63 ) );
+    __m512i s_right = _mm512_or_si512( _mm512_srli_epi64( s, 1 ), _mm512_slli_epi64( se, 63 ) );
+
+    // Ternary logic evaluates a full adder's sum ( 0x96 ) and carry ( 0xe8 ) in one instruction each
+    __m512i n_ones = _mm512_ternarylogic_epi64( n_left, n, n_right, 0x96 );
+    __m512i n_twos = _mm512_ternarylogic_epi64( n_left, n, n_right, 0xe8 );
+    __m512i c_ones = _mm512_xor_si512( c_left, c_right );
+    __m512i c_twos = _mm512_and_si512( c_left, c_right );
+    __m512i s_ones = _mm512_ternarylogic_epi64( s_left, s, s_right, 0x96 );
+    __m512i s_twos = _mm512_ternarylogic_epi64( s_left, s, s_right, 0xe8 );
+
+    __m512i ones = _mm512_ternarylogic_epi64( n_ones, c_ones, s_ones, 0x96 );
+    __m512i ones_carry = _mm512_ternarylogic_epi64( n_ones, c_ones, s_ones, 0xe8 );
+
+    __m512i twos_a = _mm512_xor_si512( n_twos, c_twos );
+    __m512i twos_b = _mm512_xor_si512( s_twos, ones_carry );
+    __m512i more_than_one_two = _mm512_or_si512( _mm512_and_si512( n_twos, c_twos ), _mm512_and_si512( s_twos, ones_carry ) );
+    __m512i exactly_one_two = _mm512_andnot_si512( more_than_one_two, _mm512_xor_si512( twos_a, twos_b ) );
+
+    return _mm512_and_si512( exactly_one_two, _mm512_or_si512( ones, c ) );
+}
+
+/* Computes the bit planes of the neighbor counts of the cells at row, a cell's count is ones + 2 twos + 4 fours + 8 eights */
+ALWAYS_INLINE TARGET_AVX512 void count_neighbors_avx512( const cell_word *above, const cell_word *row, const cell_word *below,
+                                                         __m512i *ones, __m512i *twos, __m512i *fours, __m512i *eights )
+{
+    __m512i nw = _mm512_loadu_si512( above - 1 );
+    __m512i n  = _mm512_loadu_si512( above );
+    __m512i ne = _mm512_loadu_si512( above + 1 );
+    __m512i w  = _mm512_loadu_si512( row - 1 );
+    __m512i c  = _mm512_loadu_si512( row );
+    __m512i e  = _mm512_loadu_si512( row + 1 );
+    __m512i sw = _mm512_loadu_si512( below - 1 );
+    __m512i s  = _mm512_loadu_si512( below );
+    __m512i se = _mm512_loadu_si512( below + 1 );
+
+    __m512i n_left  = _mm512_or_si512( _mm512_slli_epi64( n, 1 ), _mm512_srli_epi64( nw, 63 ) );
+    __m512i n_right = _mm512_or_si512( _mm512_srli_epi64( n, 1 ), _mm512_slli_epi64( ne, 63 ) );
+    __m512i c_left  = _mm512_or_si512( _mm512_slli_epi64( c, 1 ), _mm512_srli_epi64( w, 63 ) );
+    __m512i c_right = _mm512_or_si512( _mm512_srli_epi64( c, 1 ), _mm512_slli_epi64( e, 63 ) );
+    __m512i s_left  = _mm512_or_si512( _mm512_slli_epi64( s, 1 ), _mm512_srli_epi64( sw, 63 ) );
+    __m512i s_right = _mm512_or_si512( _mm512_srli_epi64( s, 1 ), _mm512_slli_epi64( se, 63 ) );
+
+    __m512i n_ones = _mm512_xor_si512( _mm512_xor_si512( n_left, n ), n_right );
+    __m512i n_twos = _mm512_or_si512( _mm512_and_si512( n_left, n ), _mm512_and_si512( n_right, _mm512_xor_si512( n_left, n ) ) );
+    __m512i c_ones = _mm512_xor_si512( c_left, c_right );
+    __m512i c_twos = _mm512_and_si512( c_left, c_right );
+    __m512i s_ones = _mm512_xor_si512( _mm512_xor_si512( s_left, s ), s_right );
+    __m512i s_twos = _mm512_or_si512( _mm512_and_si512( s_left, s ), _mm512_and_si512( s_right, _mm512_xor_si512( s_left, s ) ) );
+
+    *ones = _mm512_xor_si512( _mm512_xor_si512( n_ones, c_ones ), s_ones );
+    __m512i ones_carry = _mm512_or_si512( _mm512_and_si512( n_ones, c_ones ), _mm512_and_si512( s_ones, _mm512_xor_si512( n_ones, c_ones ) ) );
+
+    // Add the four twos into the full count
+    __m512i twos_sum = _mm512_xor_si512( _mm512_xor_si512( n_twos, c_twos ), s_twos );
+    __m512i twos_carry = _mm512_or_si512( _mm512_and_si512( n_twos, c_twos ), _mm512_and_si512( s_twos, _mm512_xor_si512( n_twos, c_twos ) ) );
+    *twos = _mm512_xor_si512( twos_sum, ones_carry );
+    __m512i fours_carry = _mm512_and_si512( twos_sum, ones_carry );
+    *fours = _mm512_xor_si512( twos_carry, fours_carry );
+    *eights = _mm512_and_si512( twos_carry, fours_carry );
+}
+
+/* The cells whose count is in counts, see select_rule_cells in board.c. low_k are the cells whose count is k modulo 4. */
+ALWAYS_INLINE TARGET_AVX512 __m512i select_counts_avx512( __m512i low_0, __m512i low_1, __m512i low_2, __m512i low_3, __m512i fours, __m512i eights,
+                                                          Uint16 counts )
+{
+    __m512i has_0 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 0 ) );
+    __m512i has_1 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 1 ) );
+    __m512i has_2 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 2 ) );
+    __m512i has_3 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 3 ) );
+    __m512i has_4 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 4 ) );
+    __m512i has_5 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 5 ) );
+    __m512i has_6 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 6 ) );
+    __m512i has_7 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 7 ) );
+    __m512i has_8 = _mm512_set1_epi64( ( long long ) RULE_COUNT_MASK( counts, 8 ) );
+    __m512i below_four = _mm512_or_si512( _mm512_or_si512( _mm512_and_si512( low_0, has_0 ), _mm512_and_si512( low_1, has_1 ) ),
+                                          _mm512_or_si512( _mm512_and_si512( low_2, has_2 ), _mm512_and_si512( low_3, has_3 ) ) );
+    __m512i four_to_seven = _mm512_or_si512( _mm512_or_si512( _mm512_and_si512( low_0, has_4 ), _mm512_and_si512( low_1, has_5 ) ),
+                                             _mm512_or_si512( _mm512_and_si512( low_2, has_6 ), _mm512_and_si512( low_3, has_7 ) ) );
+    // Only the count 8 has eights set
+    return _mm512_or_si512( _mm512_or_si512( _mm512_andnot_si512( _mm512_or_si512( fours, eights ), below_four ), _mm512_and_si512( fours, four_to_seven ) ),
+                            _mm512_and_si512( eights, has_8 ) );
+}
+
+/* Like next_cells_avx512, but for the rule with the given bits */
+ALWAYS_INLINE TARGET_AVX512 __m512i next_rule_cells_avx512( const cell_word *above, const cell_word *row, const cell_word *below,
+                                                            Uint16 birth, Uint16 survival )
+{
+    __m512i ones, twos, fours, eights;
+    count_neighbors_avx512( above, row, below, &ones, &twos, &fours, &eights );
+    __m512i c = _mm512_loadu_si512( row );
+    __m512i low_0 = _mm512_andnot_si512( _mm512_or_si512( ones, twos ), _mm512_set1_epi64( -1 ) );
+    __m512i low_1 = _mm512_andnot_si512( twos, ones );
+    __m512i low_2 = _mm512_andnot_si512( ones, twos );
+    __m512i low_3 = _mm512_and_si512( ones, twos );
+    __m512i born = select_counts_avx512( low_0, low_1, low_2, low_3, fours, eights, birth );
+    __m512i survived = select_counts_avx512( low_0, low_1, low_2, low_3, fours, eights, survival );
+    return _mm512_or_si512( _mm512_andnot_si512( c, born ), _mm512_and_si512( survived, c ) );
+}
+
+/* Like update_vectors_sse2 */
+ALWAYS_INLINE TARGET_AVX512 int update_vectors_avx512( const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                                       int i, int end, int *living_cells_change, int *births, Uint16 birth, Uint16 survival )
+{
+    __m512i born_counts = _mm512_setzero_si512( );
+    __m512i died_counts = _mm512_setzero_si512( );
+    for ( ; i + 8 <= end; i += 8 )
+    {
+        __m512i c = _mm512_loadu_si512( row + i );
+        __m512i next = birth == CONWAY_BIRTH && survival == CONWAY_SURVIVAL ? next_cells_avx512( above + i, row + i, below + i )
+                                                                            : next_rule_cells_avx512( above + i, row + i, below + i, birth, survival );
+        _mm512_storeu_si512( out + i, next );
+        born_counts = _mm512_add_epi64( born_counts, popcount_avx512( _mm512_andnot_si512( c, next ) ) );
+        died_counts = _mm512_add_epi64( died_counts, popcount_avx512( _mm512_andnot_si512( next, c ) ) );
+    }
+    *births += ( int ) _mm512_reduce_add_epi64( born_counts );
+    *living_cells_change += ( int ) _mm512_reduce_add_epi64( _mm512_sub_epi64( born_counts, died_counts ) );
+    return i;
+}
+
+TARGET_AVX512 int update_words_avx512( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                                       int first_word, int last_word, int words, cell_word last_word_mask, int *births )
+{
+    if ( !above || !below )
+    {
+        return update_words( rule, above, row, below, out, first_word, last_word, words, last_word_mask, births );
+    }
+    int living_cells_change;
+    int i = update_words_before_vectors( rule, above, row, below, out, first_word, last_word, words, last_word_mask,
+                                         &living_cells_change, births );
+    int end = vector_words_end( last_word, words );
+#define UPDATE_VECTORS( birth, survival ) \
+    i = update_vectors_avx512( above, row, below, out, i, end, &living_cells_change, births, birth, survival )
+    DISPATCH_LIFE_RULE( rule, UPDATE_VECTORS );
+#undef UPDATE_VECTORS
+    // Words left over after the vectors are left to SSE2
+    return living_cells_change + ( i < last_word ? update_words_sse2( rule, above, row, below, out, i, last_word, words, last_word_mask, births ) : 0 );
+}
+
+TARGET_AVX512 Sint64 count_cells_avx512( const cell_word *words, Sint64 word_count )
+{
+    __m512i counts = _mm512_setzero_si512( );
+    Sint64 i = 0;
+    for ( ; i + 8 <= word_count; i += 8 )
+    {
+        counts = _mm512_add_epi64( counts, popcount_avx512( _mm512_loadu_si512( words + i ) ) );
+    }
+    return ( Sint64 ) _mm512_reduce_add_epi64( counts ) + count_cells( words + i, word_count - i );
+}
+
+#endif
+
+const life_kernel LIFE_KERNELS[ ] =
+{
+    { "scalar", update_words, count_cells, always_supported },
+#ifdef X86_64_KERNELS
+    { "sse2", update_words_sse2, count_cells_sse2, SDL_HasSSE2 },
+    { "avx2", update_words_avx2, count_cells_avx2, SDL_HasAVX2 },
+    { "avx512", update_words_avx512, count_cells_avx512, SDL_HasAVX512F },
+#endif
+};
+
+int life_kernel_count( void )
+{
+    return sizeof( LIFE_KERNELS ) / sizeof( LIFE_KERNELS[ 0 ] );
+}
+
+const life_kernel* life_kernel_at( int index )
+{
+    return &LIFE_KERNELS[ index ];
+}
+
+const life_kernel* best_life_kernel( void )
+{
+    static const life_kernel *best;
+    if ( !best )
+    {
+        best = &LIFE_KERNELS[ 0 ];
+        for ( int i = 1; i < life_kernel_count( ); i++ )
+        {
+            if ( LIFE_KERNELS[ i ].supported( ) )
+            {
+                best = &LIFE_KERNELS[ i ];
+            }
+        }
+    }
+    return best;
+}
+
+/* Updates a copy of the given board with the kernel and compares it with the expected next generation. */
+int check_kernel_on_board( const life_kernel *kernel, board *b, const bool *expected, int expected_living_cells )
+{
+    board *copy = init_board( b->rows, b->columns, 0 );
+    copy->kernel = kernel;
+    set_board_boundary( copy, b->boundary );
+    set_board_rule( copy, b->rule );
+    for ( int y = 0; y < b->rows; y++ )
+    {
+        for ( int x = 0; x < b->columns; x++ )
+        {
+            if ( cell_state( x, y, b ) )
+            {
+                toggle_cell_state( x, y, copy );
+            }
+        }
+    }
+
+    int mismatches = update_board( copy ) != expected_living_cells;
+    mismatches += count_living_cells( copy ) != expected_living_cells;
+    int expected_births = 0;
+    for ( int y = 0; y < b->rows; y++ )
+    {
+        for ( int x = 0; x < b->columns; x++ )
+        {
+            mismatches += cell_state( x, y, copy ) != expected[ y*b->columns + x ];
+            expected_births += expected[ y*b->columns + x ] && !cell_state( x, y, b );
+        }
+    }
+    mismatches += copy->births != expected_births;
+    free_board( copy );
+    return mismatches;
+}
+
+// The specialized rules and rules that run on the generic kernels, with counts of 0, 1 and 8
+const char *CHECKED_RULES[ ] =
+{
+    "B3/S23", "B36/S23", "B3678/S34678", "B2/S", "B3/S012345678", "B36/S125", "B35678/S5678", "B1/S1", "B18/S08"
+};
+
+int check_life_kernels( int board_count )
+{
+    int failed_checks = 0;
+    int rule_count = sizeof( CHECKED_RULES ) / sizeof( CHECKED_RULES[ 0 ] );
+    for ( int i = 0; i < board_count; i++ )
+    {
+        // Cover narrow rows that only the scalar code handles as well as rows that fill several vectors
+        int rows = 1 + i % 37;
+        int columns = 1 + ( i * 97 ) % 1100;
+        int density = 5 + ( i * 13 ) % 60;
+        board *b = init_board( rows, columns, rows * columns * density / 100 );
+        // The scalar rule looks across the edges the same way and follows the same rule
+        set_board_boundary( b, ( boundary_mode ) ( i % 3 ) );
+        life_rule rule;
+        parse_life_rule( CHECKED_RULES[ ( i / 3 ) % rule_count ], &rule );
+        set_board_rule( b, rule );
+
+        // The scalar rule is the reference
+        bool *expected = malloc( rows * columns * sizeof( bool ) );
+        int expected_living_cells = 0;
+        for ( int y = 0; y < rows; y++ )
+        {
+            for ( int x = 0; x < columns; x++ )
+            {
+                expected[ y*columns + x ] = updated_cell_state( x, y, b );
+                expected_living_cells += expected[ y*columns + x ];
+            }
+        }
+
+        for ( int k = 0; k < life_kernel_count( ); k++ )
+        {
+            const life_kernel *kernel = life_kernel_at( k );
+            if ( kernel->supported( ) && check_kernel_on_board( kernel, b, expected, expected_living_cells ) )
+            {
+                fprintf( stderr, "%s kernel differs from the scalar rule on a %dx%d board with a %s boundary and the rule %s\n",
+                         kernel->name, columns, rows, boundary_mode_name( b->boundary ), CHECKED_RULES[ ( i / 3 ) % rule_count ] );
+                failed_checks++;
+            }
+        }
+        free( expected );
+        free_board( b );
+    }
+
+    for ( int k = 0; k < life_kernel_count( ); k++ )
+    {
+        const life_kernel *kernel = life_kernel_at( k );
+        printf( "%-8s %s\n", kernel->name, kernel->supported( ) ? "checked" : "not supported by this CPU" );
+    }
+    printf( "%d boards, %d failed checks, using the %s kernel\n", board_count, failed_checks, best_life_kernel( )->name );
+    return failed_checks;
+}
@@ -0,0 +1,45 @@
+#ifndef LIFE_KERNEL_H
+#define LIFE_KERNEL_H
+
+#include "board.h"
+
+/*
+ * The code a board's rows are updated with. Besides the scalar kernel there are
+ * SSE2, AVX2 and AVX-512 kernels that update 2, 4 or 8 words ( 128, 256 or 512 cells ) at once.
+ * Every kernel has compiled loops for the rules DISPATCH_LIFE_RULE lists and a loop for any other rule.
+ */
+typedef struct life_kernel
+{
+    const char *name;
+    // Same contract as update_words in board.h
+    int ( *update_words )( const life_rule *rule, const cell_word *above, const cell_word *row, const cell_word *below, cell_word *out,
+                           int first_word, int last_word, int words, cell_word last_word_mask, int *births );
+    // Same contract as count_cells in board.h
+    Sint64 ( *count_cells )( const cell_word *words, Sint64 word_count );
+    // Whether the CPU the program runs on supports the kernel
+    SDL_bool ( *supported )( void );
+} life_kernel;
+
+
+/**
+* Return the fastest kernel the CPU supports. The CPU is only queried on the first call.
+*/
+const life_kernel* best_life_kernel( void );
+
+/**
+* Return the number of kernels compiled into the program.
+*/
+int life_kernel_count( void );
+
+/**
+* Return the kernel with the given index. The kernels are ordered from slowest to fastest.
+*/
+const life_kernel* life_kernel_at( int index );
+
+/**
+* Compare every supported kernel against the scalar rule ( updated_cell_state ) on
+* board_count random boards with every boundary mode and several rules and print the results. Returns the number of mismatches.
+*/
+int check_life_kernels( int board_count );
+
+#endif
@@ -0,0 +1,125 @@
+#include <ctype.h>
+#include <string.h>
+
+#include "life_rule.h"
+
+typedef struct
+{
+    const char *name;
+    Uint16 birth;
+    Uint16 survival;
+} named_rule;
+
+// Has to list the same rules as DISPATCH_LIFE_RULE
+const named_rule SPECIALIZED_RULES[ ] =
+{
+    { "Conway's Life", CONWAY_BIRTH, CONWAY_SURVIVAL },
+    { "HighLife", HIGHLIFE_BIRTH, HIGHLIFE_SURVIVAL },
+    { "Day & Night", DAY_AND_NIGHT_BIRTH, DAY_AND_NIGHT_SURVIVAL },
+    { "Seeds", SEEDS_BIRTH, SEEDS_SURVIVAL },
+    { "Life without Death", LIFE_WITHOUT_DEATH_BIRTH, LIFE_WITHOUT_DEATH_SURVIVAL },
+};
+
+life_rule conway_rule( void )
+{
+    life_rule rule = { CONWAY_BIRTH, CONWAY_SURVIVAL };
+    return rule;
+}
+
+/* Reads the neighbor counts from text to end into counts, returns SDL_FALSE if one of the characters isn't a count */
+SDL_bool parse_neighbor_counts( const char *text, const char *end, Uint16 *counts )
+{
+    *counts = 0;
+    for ( ; text < end; text++ )
+    {
+        if ( *text < '0' || *text > '8' )
+        {
+            return SDL_FALSE;
+        }
+        *counts |= 1 << ( *text - '0' );
+    }
+    return SDL_TRUE;
+}
+
+SDL_bool parse_life_rule( const char *text, life_rule *rule )
+{
+    const char *end = text;
+    while ( *end && *end != ':' && !isspace( ( unsigned char ) *end ) )
+    {
+        end++;
+    }
+    const char *slash = memchr( text, '/', end - text );
+    if ( !slash )
+    {
+        return SDL_FALSE;
+    }
+
+    // Both halves start with B or S in B/S notation and with a digit ( or nothing ) in S/B notation
+    const char *halves[ 2 ][ 2 ] = { { text, slash }, { slash + 1, end } };
+    SDL_bool has_birth = SDL_FALSE, has_survival = SDL_FALSE;
+    for ( int i = 0; i < 2; i++ )
+    {
+        const char *half = halves[ i ][ 0 ];
+        const char *half_end = halves[ i ][ 1 ];
+        char letter = half < half_end ? ( char ) toupper( ( unsigned char ) *half ) : '\0';
+        SDL_bool birth;
+        if ( letter == 'B' || letter == 'S' )
+        {
+            birth = letter == 'B';
+            half++;
+        }
+        else
+        {
+            // S/B notation lists the survival counts first
+            birth = i == 1;
+        }
+        if ( ( birth && has_birth ) || ( !birth && has_survival ) ||
+             !parse_neighbor_counts( half, half_end, birth ? &rule->birth : &rule->survival ) )
+        {
+            return SDL_FALSE;
+        }
+        has_birth |= birth;
+        has_survival |= !birth;
+    }
+    // B0 would bring the dead cells around every pattern to life
+    return ( rule->birth & 1 ) == 0;
+}
+
+void format_life_rule( const life_rule *rule, char *text )
+{
+    *text++ = 'B';
+    for ( int n = 0; n <= 8; n++ )
+    {
+        if ( rule->birth & ( 1 << n ) )
+        {
+            *text++ = ( char ) ( '0' + n );
+        }
+    }
+    *text++ = '/';
+    *text++ = 'S';
+    for ( int n = 0; n <= 8; n++ )
+    {
+        if ( rule->survival & ( 1 << n ) )
+        {
+            *text++ = ( char ) ( '0' + n );
+        }
+    }
+    *text = '\0';
+}
+
+const char* specialized_rule_name( const life_rule *rule )
+{
+    for ( int i = 0; i < ( int ) ( sizeof( SPECIALIZED_RULES ) / sizeof( SPECIALIZED_RULES[ 0 ] ) ); i++ )
+    {
+        if ( SPECIALIZED_RULES[ i ].birth == rule->birth && SPECIALIZED_RULES[ i ].survival == rule->survival )
+        {
+            return SPECIALIZED_RULES[ i ].name;
+        }
+    }
+    return NULL;
+}
+
+SDL_bool next_cell_state( const life_rule *rule, SDL_bool alive, int living_neighbors )
+{
+    return ( ( ( alive ? rule->survival : rule->birth ) >> living_neighbors ) & 1 ) ? SDL_TRUE : SDL_FALSE;
+}
@@ -0,0 +1,92 @@
+#ifndef LIFE_RULE_H
+#define LIFE_RULE_H
+
+#include "SDL.h"
+
+/*
+ * An outer totalistic ( Life-like ) rule: whether a cell lives in the next generation only depends on
+ * its state and the number of its living neighbors. Rules are written as rulestrings like B36/S23,
+ * a dead cell with 3 or 6 living neighbors is born and a living cell with 2 or 3 living neighbors survives.
+ */
+typedef struct
+{
+    // Bit n is set if a dead cell with n living neighbors is born
+    Uint16 birth;
+    // Bit n is set if a living cell with n living neighbors survives
+    Uint16 survival;
+} life_rule;
+
+// The longest rulestring format_life_rule writes, B012345678/S012345678
+#define LIFE_RULE_STRING_SIZE 24
+
+// The rules with their own compiled kernels
+#define CONWAY_BIRTH 0x008
+#define CONWAY_SURVIVAL 0x00c
+#define HIGHLIFE_BIRTH 0x048
+#define HIGHLIFE_SURVIVAL 0x00c
+#define DAY_AND_NIGHT_BIRTH 0x1c8
+#define DAY_AND_NIGHT_SURVIVAL 0x1d8
+#define SEEDS_BIRTH 0x004
+#define SEEDS_SURVIVAL 0x000
+#define LIFE_WITHOUT_DEATH_BIRTH 0x008
+#define LIFE_WITHOUT_DEATH_SURVIVAL 0x1ff
+
+/*
+ * Expands UPDATE( birth, survival ) once for every specialized rule with the rule's bits as constants
+ * and once with the bits of the given rule for every other rule. UPDATE is an always inlined loop,
+ * so the compiler generates a kernel for each specialized rule in which the rule costs nothing.
+ */
+#define DISPATCH_LIFE_RULE( rule, UPDATE ) \
+    if ( ( rule )->birth == CONWAY_BIRTH && ( rule )->survival == CONWAY_SURVIVAL ) \
+    { UPDATE( CONWAY_BIRTH, CONWAY_SURVIVAL ); } \
+    else if ( ( rule )->birth == HIGHLIFE_BIRTH && ( rule )->survival == HIGHLIFE_SURVIVAL ) \
+    { UPDATE( HIGHLIFE_BIRTH, HIGHLIFE_SURVIVAL ); } \
+    else if ( ( rule )->birth == DAY_AND_NIGHT_BIRTH && ( rule )->survival == DAY_AND_NIGHT_SURVIVAL ) \
+    { UPDATE( DAY_AND_NIGHT_BIRTH, DAY_AND_NIGHT_SURVIVAL ); } \
+    else if ( ( rule )->birth == SEEDS_BIRTH && ( rule )->survival == SEEDS_SURVIVAL ) \
+    { UPDATE( SEEDS_BIRTH, SEEDS_SURVIVAL ); } \
+    else if ( ( rule )->birth == LIFE_WITHOUT_DEATH_BIRTH && ( rule )->survival == LIFE_WITHOUT_DEATH_SURVIVAL ) \
+    { UPDATE( LIFE_WITHOUT_DEATH_BIRTH, LIFE_WITHOUT_DEATH_SURVIVAL ); } \
+    else \
+    { UPDATE( ( rule )->birth, ( rule )->survival ); }
+
+// A word with every bit set if counts ( a rule's birth or survival bits ) has bit n set
+#define RULE_COUNT_MASK( counts, n ) ( ( Uint64 ) 0 - ( ( ( counts ) >> ( n ) ) & 1 ) )
+
+// Functions the rule dispatch instantiates have to be inlined, otherwise the rule's bits aren't constants in them
+#if defined( _MSC_VER )
+#define ALWAYS_INLINE __forceinline
+#else
+#define ALWAYS_INLINE inline __attribute__( ( always_inline ) )
+#endif
+
+
+/**
+* Return B3/S23, the rule of Conway's game of life.
+*/
+life_rule conway_rule( void );
+
+/**
+* Parse a rulestring into rule. Accepts B/S notation ( B36/S23, case insensitive, in either order )
+* and the older S/B notation ( 23/36 ). Anything after a ':' ( e.g. Golly's bounded grid suffix ) is ignored.
+* Returns SDL_FALSE if the rulestring is invalid or the rule has B0: a rule that brings dead cells without
+* living neighbors to life would need the whole infinite background to be updated.
+*/
+SDL_bool parse_life_rule( const char *text, life_rule *rule );
+
+/**
+* Write the rule in B/S notation into text, which has room for LIFE_RULE_STRING_SIZE characters.
+*/
+void format_life_rule( const life_rule *rule, char *text );
+
+/**
+* Return the name of a specialized rule ( e.g. "HighLife" ) or NULL if the rule runs on the generic kernels.
+*/
+const char* specialized_rule_name( const life_rule *rule );
+
+/**
+* Return whether a cell with the given state and number of living neighbors lives in the next generation.
+*/
+SDL_bool next_cell_state( const life_rule *rule, SDL_bool alive, int living_neighbors );
+
+#endif
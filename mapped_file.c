@@ -0,0 +1,139 @@
+#ifndef _WIN32
+// mmap and madvise aren't part of C99
+#define _DEFAULT_SOURCE
+#endif
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool map_file_with_access( const char* path, mapped_file* file, bool copy_on_write )
+{
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+    HANDLE handle = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if ( handle == INVALID_HANDLE_VALUE )
+    {
+        fprintf( stderr, "error opening %s\n", path );
+        return FALSE;
+    }
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( handle, &size ) )
+    {
+        fprintf( stderr, "error reading the size of %s\n", path );
+        CloseHandle( handle );
+        return FALSE;
+    }
+    // Empty files can't be mapped
+    if ( size.QuadPart == 0 )
+    {
+        CloseHandle( handle );
+        file->data = "";
+        return TRUE;
+    }
+    HANDLE mapping = CreateFileMappingA( handle, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL );
+    CloseHandle( handle );
+    const char *data = mapping ? MapViewOfFile( mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0 ) : NULL;
+    if ( !data )
+    {
+        fprintf( stderr, "error mapping %s\n", path );
+        if ( mapping )
+        {
+            CloseHandle( mapping );
+        }
+        return FALSE;
+    }
+    file->data = data;
+    file->size = ( size_t ) size.QuadPart;
+    file->handle = mapping;
+    return TRUE;
+}
+
+void unmap_file( mapped_file* file )
+{
+    if ( file->handle )
+    {
+        UnmapViewOfFile( file->data );
+        CloseHandle( file->handle );
+    }
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+}
+
+#else
+
+bool map_file_with_access( const char* path, mapped_file* file, bool copy_on_write )
+{
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+    int descriptor = open( path, O_RDONLY );
+    if ( descriptor < 0 )
+    {
+        fprintf( stderr, "error opening %s\n", path );
+        return FALSE;
+    }
+    struct stat status;
+    if ( fstat( descriptor, &status ) )
+    {
+        fprintf( stderr, "error reading the size of %s\n", path );
+        close( descriptor );
+        return FALSE;
+    }
+    // Empty files can't be mapped
+    if ( status.st_size == 0 )
+    {
+        close( descriptor );
+        file->data = "";
+        return TRUE;
+    }
+    int protection = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *data = mmap( NULL, status.st_size, protection, MAP_PRIVATE, descriptor, 0 );
+    close( descriptor );
+    if ( data == MAP_FAILED )
+    {
+        fprintf( stderr, "error mapping %s\n", path );
+        return FALSE;
+    }
+    // Read only files are read front to back
+    if ( !copy_on_write )
+    {
+        madvise( data, status.st_size, MADV_SEQUENTIAL );
+    }
+    file->data = data;
+    file->size = status.st_size;
+    return TRUE;
+}
+
+void unmap_file( mapped_file* file )
+{
+    if ( file->size )
+    {
+        munmap( ( void* ) file->data, file->size );
+    }
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+}
+
+#endif
+
+bool map_file( const char* path, mapped_file* file )
+{
+    return map_file_with_access( path, file, FALSE );
+}
+
+bool map_file_private( const char* path, mapped_file* file )
+{
+    return map_file_with_access( path, file, TRUE );
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "board.h"
+
+/*
+ * A read only view of a whole file in memory. The operating system pages the file in
+ * on demand, so big files can be read without copying them into a buffer first.
+ */
+typedef struct mapped_file
+{
+    const char *data;
+    size_t size;
+    // The platform's handle of the mapping ( only used on Windows )
+    void *handle;
+} mapped_file;
+
+
+/**
+* Map the file at path into memory. Prints an error and returns FALSE if that fails.
+* Empty files succeed with a size of 0.
+*/
+bool map_file( const char* path, mapped_file* file );
+
+/**
+* Map the file at path like map_file, but copy on write: the memory may be written to
+* and the changes stay in the process, the file isn't changed.
+*/
+bool map_file_private( const char* path, mapped_file* file );
+
+/**
+* Unmap a file mapped by map_file or map_file_private.
+*/
+void unmap_file( mapped_file* file );
+
+#endif
@@ -0,0 +1,268 @@
+#include "metrics.h"
+
+// Must be a power of two. Big enough for the generations of a few frames at very high speeds.
+#define METRICS_RING_SIZE 65536
+// The number of generations kept for the HUD, must be a power of two
+#define RECENT_GENERATIONS 512
+// Every power of two of the times in microseconds is split into this many histogram buckets
+#define BUCKETS_PER_OCTAVE 8
+// Times up to 2^40 microseconds fit into the histogram
+#define HISTOGRAM_BUCKETS ( 40 * BUCKETS_PER_OCTAVE )
+// The width of the summary's histogram bars
+#define SUMMARY_BAR_WIDTH 50
+
+typedef struct
+{
+    Uint64 counts[ HISTOGRAM_BUCKETS ];
+    Uint64 total;
+    double max;
+} histogram;
+
+struct metrics
+{
+    Uint64 start;
+    double frequency;
+    FILE *stream;
+    bool json;
+
+    // Written by the recording thread only
+    generation_metrics ring[ METRICS_RING_SIZE ];
+    SDL_atomic_t written;
+    histogram steps;
+    // Written by the drawing thread only, the render time is passed to the recording thread in microseconds
+    histogram renders;
+    SDL_atomic_t last_render_us;
+
+    // Used by the flushing thread only
+    Uint32 read;
+    Uint64 dropped;
+    generation_metrics recent[ RECENT_GENERATIONS ];
+    Uint32 recent_count;
+};
+
+/* Logarithmic buckets, the bucket's values are within 1 / ( 2 * BUCKETS_PER_OCTAVE ) of each other */
+int histogram_bucket( double ms )
+{
+    double us = ms * 1000;
+    if ( us < 1 )
+    {
+        return 0;
+    }
+    int exponent;
+    double mantissa = frexp( us, &exponent );
+    int bucket = exponent * BUCKETS_PER_OCTAVE + ( int ) ( ( mantissa - 0.5 ) * 2 * BUCKETS_PER_OCTAVE );
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+/* The middle of the bucket in milliseconds */
+double bucket_value( int bucket )
+{
+    if ( bucket == 0 )
+    {
+        return 0.0005;
+    }
+    int exponent = bucket / BUCKETS_PER_OCTAVE;
+    double mantissa = 0.5 + ( bucket % BUCKETS_PER_OCTAVE + 0.5 ) / ( 2 * BUCKETS_PER_OCTAVE );
+    return ldexp( mantissa, exponent ) / 1000;
+}
+
+void add_to_histogram( histogram *h, double ms )
+{
+    h->counts[ histogram_bucket( ms ) ]++;
+    h->total++;
+    h->max = ms > h->max ? ms : h->max;
+}
+
+/* Returns the value below which the fraction of the samples lies */
+double histogram_percentile( histogram *h, double fraction )
+{
+    Uint64 rank = ( Uint64 ) ( fraction * ( h->total - 1 ) );
+    Uint64 seen = 0;
+    for ( int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++ )
+    {
+        seen += h->counts[ bucket ];
+        if ( seen > rank )
+        {
+            return bucket_value( bucket ) < h->max ? bucket_value( bucket ) : h->max;
+        }
+    }
+    return h->max;
+}
+
+metrics* create_metrics( const char* stream_path )
+{
+    // The ring of samples makes the metrics a few MiB
+    metrics *m = calloc( 1, sizeof( metrics ) );
+    if ( !m )
+    {
+        fprintf( stderr, "error creating the metrics: no memory for %.1f MiB\n", sizeof( metrics ) / ( 1024.0 * 1024 ) );
+        return NULL;
+    }
+    m->start = SDL_GetPerformanceCounter( );
+    m->frequency = ( double ) SDL_GetPerformanceFrequency( );
+    if ( stream_path )
+    {
+        size_t length = strlen( stream_path );
+        m->json = length >= 5 && strcmp( stream_path + length - 5, ".json" ) == 0;
+        m->stream = fopen( stream_path, "w" );
+        if ( !m->stream )
+        {
+            fprintf( stderr, "error creating %s\n", stream_path );
+        }
+        else if ( !m->json )
+        {
+            fprintf( m->stream, "generation,time,step_ms,render_ms,population,births,deaths,active_regions\n" );
+        }
+    }
+    return m;
+}
+
+void destroy_metrics( metrics* m )
+{
+    flush_metrics( m );
+    if ( m->stream )
+    {
+        fclose( m->stream );
+    }
+    free( m );
+}
+
+generation_metrics board_metrics( board* b, double step_ms )
+{
+    generation_metrics sample = { 0 };
+    sample.generation = b->generation;
+    sample.step_ms = step_ms;
+    sample.population = ( Uint64 ) b->living_cells;
+    sample.births = ( Uint64 ) b->births;
+    sample.deaths = ( Uint64 ) b->deaths;
+    sample.active_regions = b->active_tile_count;
+    return sample;
+}
+
+void record_generation( metrics* m, generation_metrics* sample )
+{
+    sample->time = ( SDL_GetPerformanceCounter( ) - m->start ) / m->frequency;
+    sample->render_ms = SDL_AtomicGet( &m->last_render_us ) / 1000.0;
+    add_to_histogram( &m->steps, sample->step_ms );
+
+    Uint32 written = ( Uint32 ) SDL_AtomicGet( &m->written );
+    m->ring[ written & ( METRICS_RING_SIZE - 1 ) ] = *sample;
+    // The sample is written before the counter tells the flushing thread about it
+    SDL_AtomicSet( &m->written, ( int ) ( written + 1 ) );
+}
+
+void record_frame( metrics* m, double render_ms )
+{
+    add_to_histogram( &m->renders, render_ms );
+    SDL_AtomicSet( &m->last_render_us, ( int ) ( render_ms * 1000 ) );
+}
+
+void write_sample( metrics* m, generation_metrics *s )
+{
+    const char *format = m->json
+        ? "{\"generation\": %llu, \"time\": %.6f, \"step_ms\": %.4f, \"render_ms\": %.4f, "
+          "\"population\": %llu, \"births\": %llu, \"deaths\": %llu, \"active_regions\": %d}\n"
+        : "%llu,%.6f,%.4f,%.4f,%llu,%llu,%llu,%d\n";
+    fprintf( m->stream, format, ( unsigned long long ) s->generation, s->time, s->step_ms, s->render_ms,
+             ( unsigned long long ) s->population, ( unsigned long long ) s->births, ( unsigned long long ) s->deaths,
+             s->active_regions );
+}
+
+void flush_metrics( metrics* m )
+{
+    Uint32 written = ( Uint32 ) SDL_AtomicGet( &m->written );
+    // Skip the samples that were overwritten before they could be read
+    if ( written - m->read > METRICS_RING_SIZE )
+    {
+        m->dropped += written - m->read - METRICS_RING_SIZE;
+        m->read = written - METRICS_RING_SIZE;
+    }
+    for ( ; m->read != written; m->read++ )
+    {
+        generation_metrics sample = m->ring[ m->read & ( METRICS_RING_SIZE - 1 ) ];
+        // The recording thread may have started to overwrite the sample while it was copied
+        if ( ( Uint32 ) SDL_AtomicGet( &m->written ) - m->read >= METRICS_RING_SIZE )
+        {
+            m->dropped++;
+            continue;
+        }
+        if ( m->stream )
+        {
+            write_sample( m, &sample );
+        }
+        m->recent[ m->recent_count++ & ( RECENT_GENERATIONS - 1 ) ] = sample;
+    }
+    if ( m->stream )
+    {
+        fflush( m->stream );
+    }
+}
+
+int recent_generations( metrics* m, generation_metrics* out, int max )
+{
+    int count = m->recent_count < RECENT_GENERATIONS ? ( int ) m->recent_count : RECENT_GENERATIONS;
+    count = count < max ? count : max;
+    for ( int i = 0; i < count; i++ )
+    {
+        out[ i ] = m->recent[ ( m->recent_count - count + i ) & ( RECENT_GENERATIONS - 1 ) ];
+    }
+    return count;
+}
+
+void print_histogram_summary( const char* name, histogram *h, FILE* out )
+{
+    if ( !h->total )
+    {
+        return;
+    }
+    fprintf( out, "%s: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", name,
+             histogram_percentile( h, 0.5 ), histogram_percentile( h, 0.99 ), h->max );
+}
+
+void print_metrics_summary( metrics* m, FILE* out )
+{
+    fprintf( out, "generations: %llu", ( unsigned long long ) m->steps.total );
+    if ( m->renders.total )
+    {
+        fprintf( out, ", frames: %llu", ( unsigned long long ) m->renders.total );
+    }
+    if ( m->dropped )
+    {
+        fprintf( out, ", %llu generations weren't written to the stream in time", ( unsigned long long ) m->dropped );
+    }
+    fprintf( out, "\n" );
+    print_histogram_summary( "step time", &m->steps, out );
+    print_histogram_summary( "render time", &m->renders, out );
+    if ( !m->steps.total )
+    {
+        return;
+    }
+
+    // One bar per power of two of the step times
+    Uint64 octaves[ HISTOGRAM_BUCKETS / BUCKETS_PER_OCTAVE ] = { 0 };
+    Uint64 highest = 0;
+    int first = -1, last = 0;
+    for ( int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++ )
+    {
+        int octave = bucket / BUCKETS_PER_OCTAVE;
+        octaves[ octave ] += m->steps.counts[ bucket ];
+        if ( m->steps.counts[ bucket ] )
+        {
+            first = first < 0 ? octave : first;
+            last = octave;
+        }
+        highest = octaves[ octave ] > highest ? octaves[ octave ] : highest;
+    }
+    for ( int octave = first; octave <= last; octave++ )
+    {
+        // Octave n holds the times from 2^( n - 1 ) to 2^n microseconds
+        double from = octave ? ldexp( 1, octave - 1 ) / 1000 : 0;
+        int bar = ( int ) ( ( double ) octaves[ octave ] * SUMMARY_BAR_WIDTH / highest + 0.5 );
+        fprintf( out, "%10.3f - %10.3f ms | ", from, ldexp( 1, octave ) / 1000 );
+        for ( int i = 0; i < bar; i++ )
+        {
+            fputc( '#', out );
+        }
+        fprintf( out, " %llu\n", ( unsigned long long ) octaves[ octave ] );
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "board.h"
+
+/*
+ * Collects per generation metrics. The thread that updates the board records every generation into a lock free
+ * ring buffer, another thread ( or the same one ) drains the ring into a CSV or JSON lines file and keeps the
+ * newest generations for the HUD. Step and render times also go into histograms for the summary printed on exit.
+ */
+typedef struct metrics metrics;
+
+typedef struct
+{
+    Uint64 generation;
+    // Seconds since the metrics were created
+    double time;
+    // How long the update took and how long the last frame before it took to draw
+    double step_ms;
+    double render_ms;
+    Uint64 population;
+    Uint64 births;
+    Uint64 deaths;
+    // The tiles of the board or chunks of the universe that were updated, both are 64 x 64 cells
+    int active_regions;
+} generation_metrics;
+
+
+/**
+* Create the metrics. If stream_path isn't NULL every generation is written to it as CSV,
+* or as JSON lines if the path ends with .json. Prints an error and returns NULL if the metrics can't be allocated.
+*/
+metrics* create_metrics( const char* stream_path );
+
+/**
+* Flush the remaining generations, close the stream and free the metrics.
+*/
+void destroy_metrics( metrics* m );
+
+/**
+* Return the metrics of the board's last update. step_ms is the time update_board took.
+*/
+generation_metrics board_metrics( board* b, double step_ms );
+
+/**
+* Record a generation. Only one thread may record generations, time and render_ms are filled in.
+*/
+void record_generation( metrics* m, generation_metrics* sample );
+
+/**
+* Record how long drawing a frame took. Only one thread may record frames.
+*/
+void record_frame( metrics* m, double render_ms );
+
+/**
+* Write the generations recorded since the last call to the stream and keep the newest ones for recent_generations.
+* Only one thread may flush. Generations are dropped if the ring is overwritten before they are flushed.
+*/
+void flush_metrics( metrics* m );
+
+/**
+* Copy up to max of the newest flushed generations into out, oldest first. Returns the number of copied generations.
+*/
+int recent_generations( metrics* m, generation_metrics* out, int max );
+
+/**
+* Print the number of recorded generations and frames and the p50, p99 and max of the step and render times
+* with a histogram of the step times. Must not be called while generations or frames are recorded.
+*/
+void print_metrics_summary( metrics* m, FILE* out );
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef _WIN32
+// mmap and madvise aren't part of C99
+#define _DEFAULT_SOURCE
+#endif
+#include "page_arena.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Allocations are aligned to cache lines
+#define ARENA_ALIGNMENT 64
+
+struct page_arena
+{
+    char *base;
+    size_t size;
+    size_t used;
+    bool huge_pages;
+};
+
+huge_page_mode arena_huge_pages = HUGE_PAGES_TRANSPARENT;
+
+void set_huge_page_mode( huge_page_mode mode )
+{
+    arena_huge_pages = mode;
+}
+
+bool huge_page_mode_from_name( const char *name, huge_page_mode *mode )
+{
+    const char *names[ ] = { "off", "transparent", "explicit" };
+    for ( int i = 0; i < 3; i++ )
+    {
+        if ( strcmp( name, names[ i ] ) == 0 )
+        {
+            *mode = ( huge_page_mode ) i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+#ifdef _WIN32
+
+/* Maps size bytes, with large pages if huge_pages is set. Returns NULL if that fails. */
+char* map_pages( size_t size, bool huge_pages )
+{
+    // Large pages need the "lock pages in memory" privilege and are committed right away
+    DWORD type = MEM_RESERVE | MEM_COMMIT | ( huge_pages ? MEM_LARGE_PAGES : 0 );
+    return VirtualAlloc( NULL, size, type, PAGE_READWRITE );
+}
+
+void unmap_pages( char* pages, size_t size )
+{
+    VirtualFree( pages, 0, MEM_RELEASE );
+}
+
+void advise_huge_pages( char* pages, size_t size )
+{
+    // Windows has no transparent huge pages
+}
+
+#else
+
+char* map_pages( size_t size, bool huge_pages )
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    flags |= huge_pages ? MAP_HUGETLB : 0;
+#else
+    if ( huge_pages )
+    {
+        return NULL;
+    }
+#endif
+    void *pages = mmap( NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0 );
+    return pages == MAP_FAILED ? NULL : pages;
+}
+
+void unmap_pages( char* pages, size_t size )
+{
+    munmap( pages, size );
+}
+
+void advise_huge_pages( char* pages, size_t size )
+{
+#ifdef MADV_HUGEPAGE
+    madvise( pages, size, MADV_HUGEPAGE );
+#endif
+}
+
+#endif
+
+page_arena* create_page_arena( size_t size )
+{
+    page_arena *a = calloc( 1, sizeof( page_arena ) );
+    if ( !a )
+    {
+        fprintf( stderr, "error allocating an arena\n" );
+        return NULL;
+    }
+    // Small arenas would only waste the rest of their huge page
+    bool big = size >= HUGE_PAGE_SIZE && arena_huge_pages != HUGE_PAGES_OFF;
+    size_t page_size = big ? HUGE_PAGE_SIZE : 4096;
+    if ( size > ( size_t ) -1 - page_size )
+    {
+        fprintf( stderr, "error allocating an arena of %llu bytes: too large\n", ( unsigned long long ) size );
+        free( a );
+        return NULL;
+    }
+    a->size = ( size + page_size - 1 ) / page_size * page_size;
+    if ( big && arena_huge_pages == HUGE_PAGES_EXPLICIT )
+    {
+        a->base = map_pages( a->size, TRUE );
+        a->huge_pages = a->base != NULL;
+    }
+    if ( !a->base )
+    {
+        a->base = map_pages( a->size, FALSE );
+        if ( a->base && big )
+        {
+            advise_huge_pages( a->base, a->size );
+        }
+    }
+    if ( !a->base )
+    {
+        fprintf( stderr, "error allocating an arena of %.1f MiB: out of memory\n", a->size / ( 1024.0 * 1024.0 ) );
+        free( a );
+        return NULL;
+    }
+    return a;
+}
+
+void destroy_page_arena( page_arena* a )
+{
+    if ( a )
+    {
+        unmap_pages( a->base, a->size );
+        free( a );
+    }
+}
+
+void* arena_alloc( page_arena* a, size_t size )
+{
+    size_t start = ( a->used + ARENA_ALIGNMENT - 1 ) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if ( start > a->size || size > a->size - start )
+    {
+        return NULL;
+    }
+    a->used = start + size;
+    return a->base + start;
+}
+
+bool arena_has_huge_pages( page_arena* a )
+{
+    return a->huge_pages;
+}
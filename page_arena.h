@@ -0,0 +1,59 @@
+#ifndef PAGE_ARENA_H
+#define PAGE_ARENA_H
+
+#include "board.h"
+
+/*
+ * A block of zeroed memory mapped straight from the operating system, handed out front to back and freed at once.
+ * Big arenas are backed by huge pages, so sweeping a gigabyte grid needs a few hundred TLB entries instead of
+ * hundreds of thousands. Untouched pages of an arena are never allocated.
+ */
+typedef struct page_arena page_arena;
+
+/* Whether arenas of at least HUGE_PAGE_SIZE bytes use huge pages */
+typedef enum
+{
+    // Normal pages only
+    HUGE_PAGES_OFF,
+    // Ask the kernel to back the arena with transparent huge pages where it can ( madvise MADV_HUGEPAGE )
+    HUGE_PAGES_TRANSPARENT,
+    // Reserve huge pages up front ( MAP_HUGETLB, MEM_LARGE_PAGES on Windows ), falls back to transparent ones
+    // if none are configured
+    HUGE_PAGES_EXPLICIT
+} huge_page_mode;
+
+// The size of the huge pages on x86-64, big arenas are rounded up to a multiple of it
+#define HUGE_PAGE_SIZE ( ( size_t ) 2 << 20 )
+
+
+/**
+* Set the huge page mode of the arenas created from now on. The default is HUGE_PAGES_TRANSPARENT.
+*/
+void set_huge_page_mode( huge_page_mode mode );
+
+/**
+* Parse "off", "transparent" or "explicit" into mode, returns FALSE if the name is none of them.
+*/
+bool huge_page_mode_from_name( const char *name, huge_page_mode *mode );
+
+/**
+* Map an arena of at least size bytes. Prints an error and returns NULL if the memory can't be mapped.
+*/
+page_arena* create_page_arena( size_t size );
+
+/**
+* Unmap the arena and everything allocated from it.
+*/
+void destroy_page_arena( page_arena* a );
+
+/**
+* Return size zeroed bytes from the arena, aligned to 64 bytes, or NULL if they don't fit into what is left of it.
+*/
+void* arena_alloc( page_arena* a, size_t size );
+
+/**
+* Return whether the arena is backed by explicit huge pages.
+*/
+bool arena_has_huge_pages( page_arena* a );
+
+#endif
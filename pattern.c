@@ -0,0 +1,399 @@
+#include "pattern.h"
+#include "random_generator.h"
+#include <limits.h>
+
+// RLE lines shouldn't be longer than 70 characters
+#define RLE_LINE_LENGTH 70
+#define RLE_HEADER_BUFFER_SIZE 256
+// check_patterns writes its boards to this file in the current directory and removes it afterwards
+#define SELF_CHECK_PATTERN_PATH "self_check.rle"
+
+/* Returns the first byte of the line after the one p points into */
+static inline const char* next_line( const char *p, const char *end )
+{
+    while ( p < end && *p != '\n' )
+    {
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+/* Reads "x = m, y = n" and the optional rule of an RLE header line, returns FALSE if the line has no size */
+bool read_rle_header( const char *line, const char *end, pattern *p )
+{
+    char header[ RLE_HEADER_BUFFER_SIZE ];
+    size_t length = 0;
+    while ( line + length < end && line[ length ] != '\n' && length < sizeof( header ) - 1 )
+    {
+        length++;
+    }
+    memcpy( header, line, length );
+    // Drop the \r of Windows line endings
+    while ( length > 0 && isspace( ( unsigned char ) header[ length - 1 ] ) )
+    {
+        length--;
+    }
+    header[ length ] = '\0';
+    if ( sscanf( header, " x = %d , y = %d", &p->width, &p->height ) != 2 || p->width < 0 || p->height < 0 )
+    {
+        return FALSE;
+    }
+
+    // The rule is optional, patterns without one are B3/S23
+    const char *rule = strstr( header, "rule" );
+    if ( rule )
+    {
+        rule += strlen( "rule" );
+        while ( *rule == ' ' || *rule == '=' )
+        {
+            rule++;
+        }
+        p->has_rule = parse_life_rule( rule, &p->rule );
+        if ( !p->has_rule )
+        {
+            fprintf( stderr, "ignoring the unsupported rule %s, the pattern runs with B3/S23\n", rule );
+        }
+        // Golly's bounded grids like B3/S23:T100,80 ( a 100 x 80 torus ) follow the rule, the board's size and --boundary are used instead
+        const char *topology = strchr( rule, ':' );
+        if ( p->has_rule && topology )
+        {
+            fprintf( stderr, "ignoring the bounded grid %s of the rule, the pattern runs on the board's boundary ( --boundary )\n",
+                     topology );
+        }
+    }
+    return TRUE;
+}
+
+/* Measures a plaintext pattern: the number of lines that aren't comments and the longest line */
+void measure_cells_pattern( pattern *p )
+{
+    const char *end = p->file.data + p->file.size;
+    p->width = p->height = 0;
+    for ( const char *line = p->cells; line < end; line = next_line( line, end ) )
+    {
+        if ( *line == '!' )
+        {
+            continue;
+        }
+        int width = 0;
+        for ( const char *c = line; c < end && *c != '\n' && *c != '\r'; c++ )
+        {
+            width++;
+        }
+        p->width = width > p->width ? width : p->width;
+        p->height++;
+    }
+}
+
+pattern* open_pattern( const char* path )
+{
+    pattern *p = calloc( 1, sizeof( pattern ) );
+    if ( !map_file( path, &p->file ) )
+    {
+        free( p );
+        return NULL;
+    }
+    const char *end = p->file.data + p->file.size;
+
+    // Skip the comments, RLE comments start with # and plaintext comments with !
+    const char *line = p->file.data;
+    while ( line < end && ( *line == '#' || *line == '!' ) )
+    {
+        line = next_line( line, end );
+    }
+    p->cells = line;
+
+    // RLE files start with a header like "x = 3, y = 3, rule = B3/S23"
+    const char *first = line;
+    while ( first < end && ( *first == ' ' || *first == '\t' ) )
+    {
+        first++;
+    }
+    p->rle = first < end && *first == 'x';
+    if ( p->rle )
+    {
+        if ( !read_rle_header( line, end, p ) )
+        {
+            fprintf( stderr, "invalid RLE header in %s\n", path );
+            close_pattern( p );
+            return NULL;
+        }
+        p->cells = next_line( line, end );
+    }
+    else
+    {
+        measure_cells_pattern( p );
+    }
+    return p;
+}
+
+void close_pattern( pattern* p )
+{
+    unmap_file( &p->file );
+    free( p );
+}
+
+void place_rle_pattern( pattern* p, board* b, int x, int y )
+{
+    const char *end = p->file.data + p->file.size;
+    // 64 bit, the runs of a file can add up to more than 2^31 cells
+    Sint64 column = 0, row = 0;
+    int count = 0;
+    for ( const char *c = p->cells; c < end; c++ )
+    {
+        if ( *c >= '0' && *c <= '9' )
+        {
+            // Stop growing absurd counts, they only have to cover the board
+            count = count < INT_MAX / 10 - 9 ? count * 10 + ( *c - '0' ) : count;
+            continue;
+        }
+        if ( isspace( ( unsigned char ) *c ) )
+        {
+            continue;
+        }
+        int run = count ? count : 1;
+        count = 0;
+        if ( *c == '!' )
+        {
+            break;
+        }
+        else if ( *c == '#' )
+        {
+            // Comments in the middle of the cells
+            c = next_line( c, end ) - 1;
+        }
+        else if ( *c == '$' )
+        {
+            row += run;
+            column = 0;
+            // The rows below the board's last row can't be placed
+            if ( y + row >= b->rows )
+            {
+                break;
+            }
+        }
+        else if ( *c == 'b' || *c == '.' )
+        {
+            column += run;
+        }
+        else
+        {
+            // o is the living state, multi state files use other letters for their living states.
+            // The run is clipped to the board here, set_cells_alive only takes ints.
+            Sint64 first = x + column > 0 ? x + column : 0;
+            Sint64 last = x + column + run < b->columns ? x + column + run : b->columns;
+            if ( first < last && y + row >= 0 )
+            {
+                set_cells_alive( ( int ) first, ( int ) ( y + row ), ( int ) ( last - first ), b );
+            }
+            column += run;
+        }
+    }
+}
+
+void place_cells_pattern( pattern* p, board* b, int x, int y )
+{
+    const char *end = p->file.data + p->file.size;
+    int row = 0;
+    for ( const char *line = p->cells; line < end; line = next_line( line, end ) )
+    {
+        if ( *line == '!' )
+        {
+            continue;
+        }
+        // Set the runs of living cells in the line
+        int column = 0, run_start = 0;
+        bool in_run = FALSE;
+        for ( const char *c = line; c < end && *c != '\n' && *c != '\r'; c++, column++ )
+        {
+            bool alive = *c != '.' && *c != ' ';
+            if ( alive && !in_run )
+            {
+                run_start = column;
+            }
+            else if ( !alive && in_run )
+            {
+                set_cells_alive( x + run_start, y + row, column - run_start, b );
+            }
+            in_run = alive;
+        }
+        if ( in_run )
+        {
+            set_cells_alive( x + run_start, y + row, column - run_start, b );
+        }
+        row++;
+    }
+}
+
+void place_pattern( pattern* p, board* b, int x, int y )
+{
+    if ( p->rle )
+    {
+        place_rle_pattern( p, b, x, y );
+    }
+    else
+    {
+        place_cells_pattern( p, b, x, y );
+    }
+}
+
+board* load_pattern_board( const char* path, int min_rows, int min_columns )
+{
+    pattern *p = open_pattern( path );
+    if ( !p )
+    {
+        return NULL;
+    }
+    int rows = p->height > min_rows ? p->height : min_rows;
+    int columns = p->width > min_columns ? p->width : min_columns;
+    board *b = init_board( rows, columns, 0 );
+    if ( !b )
+    {
+        close_pattern( p );
+        return NULL;
+    }
+    if ( p->has_rule )
+    {
+        set_board_rule( b, p->rule );
+    }
+    place_pattern( p, b, ( columns - p->width ) / 2, ( rows - p->height ) / 2 );
+    close_pattern( p );
+    return b;
+}
+
+
+typedef struct
+{
+    FILE *file;
+    int line_length;
+} rle_writer;
+
+/* Writes a run like 12o or $, runs of one cell are written without a count */
+void write_rle_run( rle_writer *w, int count, char tag )
+{
+    char run[ 16 ];
+    int length = count > 1 ? sprintf( run, "%d%c", count, tag ) : sprintf( run, "%c", tag );
+    if ( w->line_length + length > RLE_LINE_LENGTH )
+    {
+        fputc( '\n', w->file );
+        w->line_length = 0;
+    }
+    fputs( run, w->file );
+    w->line_length += length;
+}
+
+static inline int trailing_zeros( cell_word word )
+{
+    return popcount64( ( word & -word ) - 1 );
+}
+
+/* Returns the first column from x on in which the cell isn't alive ( or dead ), or columns if there is none */
+int run_end( const cell_word *row, int x, int columns, bool alive )
+{
+    while ( x < columns )
+    {
+        cell_word word = alive ? row[ x / CELLS_PER_WORD ] : ~row[ x / CELLS_PER_WORD ];
+        // The cells of the word from x on that end the run
+        cell_word different = ~word & ( ~( cell_word ) 0 << ( x % CELLS_PER_WORD ) );
+        if ( different )
+        {
+            int end = x - x % CELLS_PER_WORD + trailing_zeros( different );
+            return end < columns ? end : columns;
+        }
+        x += CELLS_PER_WORD - x % CELLS_PER_WORD;
+    }
+    return columns;
+}
+
+bool save_board_rle( const char* path, board* b )
+{
+    FILE *file = fopen( path, "w" );
+    if ( !file )
+    {
+        fprintf( stderr, "error creating %s\n", path );
+        return FALSE;
+    }
+    char rule[ LIFE_RULE_STRING_SIZE ];
+    format_life_rule( &b->rule, rule );
+    fprintf( file, "x = %d, y = %d, rule = %s\n", b->columns, b->rows, rule );
+
+    rle_writer w = { file, 0 };
+    // The row the last $ moved to, empty rows are skipped with a single n$
+    int written_row = 0;
+    for ( int y = 0; y < b->rows; y++ )
+    {
+        const cell_word *row = b->grid + ( Sint64 ) y*b->words_per_row;
+        // Dead cells at the end of a row are left out
+        int x = run_end( row, 0, b->columns, FALSE );
+        if ( x == b->columns )
+        {
+            continue;
+        }
+        if ( y > written_row )
+        {
+            write_rle_run( &w, y - written_row, '$' );
+            written_row = y;
+        }
+        if ( x > 0 )
+        {
+            write_rle_run( &w, x, 'b' );
+        }
+        while ( x < b->columns )
+        {
+            int alive_end = run_end( row, x, b->columns, TRUE );
+            write_rle_run( &w, alive_end - x, 'o' );
+            int dead_end = run_end( row, alive_end, b->columns, FALSE );
+            if ( dead_end < b->columns )
+            {
+                write_rle_run( &w, dead_end - alive_end, 'b' );
+            }
+            x = dead_end;
+        }
+    }
+    write_rle_run( &w, 1, '!' );
+    fputc( '\n', file );
+
+    bool written = !ferror( file );
+    written = !fclose( file ) && written;
+    if ( !written )
+    {
+        fprintf( stderr, "error writing %s\n", path );
+    }
+    return written;
+}
+
+int check_patterns( int board_count )
+{
+    const double densities[ ] = { 0.02, 0.5, 0.98 };
+    int failed_checks = 0;
+    random_generator g;
+    seed_generator( &g, DEFAULT_RANDOM_SEED, 4 );
+    for ( int i = 0; i < board_count; i++ )
+    {
+        int rows = 1 + ( int ) random_below( &g, 300 );
+        int columns = 1 + ( int ) random_below( &g, 300 );
+        board *b = create_board( rows, columns );
+        // Sparse boards have empty rows and long dead runs, dense ones long living runs. B0 isn't supported.
+        fill_board_random( b, densities[ i % 3 ] );
+        life_rule rule = { ( Uint16 ) ( random_below( &g, 1 << 9 ) & ~1 ), ( Uint16 ) random_below( &g, 1 << 9 ) };
+        set_board_rule( b, rule );
+        // The saved pattern is as big as the board, so it's loaded into a board of the same size at 0, 0
+        board *loaded = save_board_rle( SELF_CHECK_PATTERN_PATH, b ) ? load_pattern_board( SELF_CHECK_PATTERN_PATH, 1, 1 ) : NULL;
+        bool same = loaded && loaded->rows == rows && loaded->columns == columns && loaded->living_cells == b->living_cells &&
+                    loaded->rule.birth == rule.birth && loaded->rule.survival == rule.survival &&
+                    memcmp( loaded->grid, b->grid, ( size_t ) rows * b->words_per_row * sizeof( cell_word ) ) == 0;
+        if ( !same )
+        {
+            fprintf( stderr, "a %dx%d board changed when it was saved as RLE and loaded again\n", columns, rows );
+            failed_checks++;
+        }
+        if ( loaded )
+        {
+            free_board( loaded );
+        }
+        free_board( b );
+    }
+    remove( SELF_CHECK_PATTERN_PATH );
+    printf( "%d boards saved and loaded as RLE, %d failed checks\n", board_count, failed_checks );
+    return failed_checks;
+}
@@ -0,0 +1,63 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "board.h"
+#include "mapped_file.h"
+
+/*
+ * Pattern files in the Run Length Encoded ( .rle ) and the plaintext ( .cells ) format.
+ * The files are memory mapped and decoded straight into a board's words, run by run,
+ * so even multi megabyte patterns don't need a copy of the file or a per cell array.
+ */
+typedef struct
+{
+    // The size of the pattern's bounding box in cells
+    int width;
+    int height;
+    bool rle;
+    // The rule of the RLE header, has_rule is FALSE if there is none
+    bool has_rule;
+    life_rule rule;
+    mapped_file file;
+    // The first byte after the comments and the RLE header
+    const char *cells;
+} pattern;
+
+
+/**
+* Map a pattern file and read its size, the format is detected from the content.
+* Prints an error and returns NULL if the file can't be read or has no valid RLE header.
+*/
+pattern* open_pattern( const char* path );
+
+/**
+* Unmap the pattern and free it.
+*/
+void close_pattern( pattern* p );
+
+/**
+* Bring the pattern's living cells to life with the pattern's top left corner at x, y.
+* The board's other cells are left alone and cells that don't fit into the board are dropped.
+*/
+void place_pattern( pattern* p, board* b, int x, int y );
+
+/**
+* Create a board that has at least min_rows x min_columns cells and is big enough for the pattern at path,
+* and place the pattern in its center. The board follows the rule of the pattern's RLE header.
+* Returns NULL if the pattern can't be read.
+*/
+board* load_pattern_board( const char* path, int min_rows, int min_columns );
+
+/**
+* Write the board's cells to path as an RLE pattern with the size and the rule of the board.
+* Prints an error and returns FALSE if the file can't be written.
+*/
+bool save_board_rle( const char* path, board* b );
+
+/**
+* Save board_count random boards with random rules as RLE, load them again and compare them with the saved ones.
+* Prints the results and returns the number of boards that changed.
+*/
+int check_patterns( int board_count );
+
+#endif
@@ -0,0 +1,83 @@
+#include "random_generator.h"
+
+static inline Uint64 rotate_left( Uint64 x, int k )
+{
+    return ( x << k ) | ( x >> ( 64 - k ) );
+}
+
+/* SplitMix64, turns similar seeds into unrelated states */
+static inline Uint64 split_mix( Uint64 *x )
+{
+    Uint64 z = ( *x += 0x9e3779b97f4a7c15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+void seed_generator( random_generator* g, Uint64 seed, Uint64 stream )
+{
+    Uint64 x = seed ^ split_mix( &stream );
+    for ( int i = 0; i < 4; i++ )
+    {
+        g->state[ i ] = split_mix( &x );
+    }
+}
+
+Uint64 next_random( random_generator* g )
+{
+    Uint64 *s = g->state;
+    Uint64 result = rotate_left( s[ 1 ] * 5, 7 ) * 9;
+    Uint64 t = s[ 1 ] << 17;
+    s[ 2 ] ^= s[ 0 ];
+    s[ 3 ] ^= s[ 1 ];
+    s[ 1 ] ^= s[ 2 ];
+    s[ 0 ] ^= s[ 3 ];
+    s[ 2 ] ^= t;
+    s[ 3 ] = rotate_left( s[ 3 ], 45 );
+    return result;
+}
+
+Uint64 random_below( random_generator* g, Uint64 n )
+{
+    // Values at or above limit would make the lower results more likely
+    Uint64 limit = ( Uint64 ) -1 - ( ( Uint64 ) -1 % n );
+    Uint64 value;
+    do
+    {
+        value = next_random( g );
+    }
+    while ( value >= limit );
+    return value % n;
+}
+
+Uint32 density_to_fixed( double density )
+{
+    double fixed = density * ( 1 << DENSITY_BITS ) + 0.5;
+    return fixed <= 0 ? 0 : fixed >= ( 1 << DENSITY_BITS ) ? 1 << DENSITY_BITS : ( Uint32 ) fixed;
+}
+
+Uint64 random_cell_word( random_generator* g, Uint32 density )
+{
+    if ( density >= 1 << DENSITY_BITS )
+    {
+        return ~( Uint64 ) 0;
+    }
+    if ( density == 0 )
+    {
+        return 0;
+    }
+    // Go through the binary digits of the density from the lowest set one to the highest.
+    // ORing with a random word maps a probability p to ( 1 + p ) / 2, ANDing maps it to p / 2,
+    // so after the highest digit every bit is set with the probability of the digits read as a fraction.
+    int bit = 0;
+    while ( !( density >> bit & 1 ) )
+    {
+        bit++;
+    }
+    Uint64 word = next_random( g );
+    for ( bit++; bit < DENSITY_BITS; bit++ )
+    {
+        word = density >> bit & 1 ? word | next_random( g ) : word & next_random( g );
+    }
+    return word;
+}
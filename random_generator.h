@@ -0,0 +1,48 @@
+#ifndef RANDOM_GENERATOR_H
+#define RANDOM_GENERATOR_H
+
+#include "SDL.h"
+
+// Used until a seed is set, so runs without an explicit seed can be reproduced too
+#define DEFAULT_RANDOM_SEED 20240601ULL
+// The density of random_cell_word is rounded to a multiple of 1 / 2^DENSITY_BITS
+#define DENSITY_BITS 16
+
+/*
+ * A xoshiro256** generator. It is much faster than rand( ), has a period of 2^256 - 1 and
+ * produces the same numbers on every platform for the same seed.
+ */
+typedef struct
+{
+    Uint64 state[ 4 ];
+} random_generator;
+
+
+/**
+* Seed the generator. Different streams of the same seed give independent sequences,
+* so work that is split up ( e.g. one stream per row ) stays deterministic no matter how it is scheduled.
+*/
+void seed_generator( random_generator* g, Uint64 seed, Uint64 stream );
+
+/**
+* Return the next 64 random bits.
+*/
+Uint64 next_random( random_generator* g );
+
+/**
+* Return a uniformly distributed value in the range 0 to n-1, n must not be 0.
+*/
+Uint64 random_below( random_generator* g, Uint64 n );
+
+/**
+* Convert a density between 0 and 1 to the fixed point form random_cell_word takes.
+*/
+Uint32 density_to_fixed( double density );
+
+/**
+* Return a word in which every bit is set with the probability density / 2^DENSITY_BITS.
+* It takes at most DENSITY_BITS random numbers, one for a density of 0.5.
+*/
+Uint64 random_cell_word( random_generator* g, Uint32 density );
+
+#endif
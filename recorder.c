@@ -0,0 +1,719 @@
+#include "recorder.h"
+
+// The queued copies of the grid take about this many bytes
+#define RECORDER_QUEUE_BYTES ( 64 << 20 )
+// The number of queued frames is a power of two between these
+#define MIN_QUEUED_FRAMES 2
+#define MAX_QUEUED_FRAMES 16
+// The time between the frames of a GIF in 1/100 seconds
+#define GIF_FRAME_DELAY 5
+#define GIF_MAX_SIZE 65535
+// GIF codes have at most 12 bits
+#define GIF_MAX_CODE_SIZE 12
+#define GIF_MAX_CODES ( 1 << GIF_MAX_CODE_SIZE )
+// The pixels are codes 0 and 1, but GIF codes start with at least 2 bits
+#define GIF_MIN_CODE_SIZE 2
+#define GIF_CLEAR_CODE ( 1 << GIF_MIN_CODE_SIZE )
+#define GIF_END_CODE ( GIF_CLEAR_CODE + 1 )
+// The image data of a GIF is split into sub-blocks of at most this many bytes
+#define GIF_BLOCK_SIZE 255
+// The image data of a PNG is written as stored deflate blocks of at most this many bytes, one per IDAT chunk
+#define PNG_BLOCK_SIZE 65535
+// The zlib header, the deflate block header and the Adler-32 checksum around a block
+#define PNG_BLOCK_OVERHEAD ( 2 + 5 + 4 )
+#define PNG_MAX_SIZE 0x7fffffff
+// _<generation>.png
+#define PNG_SUFFIX_SIZE 32
+
+typedef struct
+{
+    Uint64 generation;
+    cell_word *cells;
+} queued_frame;
+
+/* Packs the codes of a GIF image into bytes, least significant bit first, and the bytes into sub-blocks */
+typedef struct
+{
+    Uint32 bits;
+    int bit_count;
+    Uint8 block[ GIF_BLOCK_SIZE ];
+    int block_size;
+} gif_code_writer;
+
+/* The LZW dictionary of a GIF image. Every code is a run of pixels, and a longer run is a code and one more pixel,
+   so the dictionary is a tree with a child per pixel value. */
+typedef struct
+{
+    Uint16 children[ GIF_MAX_CODES ][ 2 ];
+    int last_code;
+    int code_size;
+    // The code of the pixels that were read since the last code was written, -1 before the first pixel
+    int run;
+    gif_code_writer writer;
+} gif_encoder;
+
+/* The zlib stream of a PNG's image data, split into stored blocks */
+typedef struct
+{
+    // Room for the headers in front of the block and the checksum after it
+    Uint8 chunk[ PNG_BLOCK_OVERHEAD + PNG_BLOCK_SIZE ];
+    int block_size;
+    bool first_block;
+    Uint32 adler_a;
+    Uint32 adler_b;
+} png_encoder;
+
+struct recorder
+{
+    recording_settings settings;
+    recording_format format;
+    // A copy of the path
+    char *path;
+    int rows;
+    int columns;
+    int words_per_row;
+    size_t frame_words;
+    // The size of the frames in pixels
+    int width;
+    int height;
+    // The GIF or raw video, every PNG is a file of its own
+    FILE *file;
+
+    // Single producer, single consumer ring of frames. The counters only grow, the index is the counter modulo the size.
+    queued_frame *queue;
+    int queue_size;
+    SDL_atomic_t written;
+    SDL_atomic_t read;
+    // Posted for every queued frame, and once more when the encoder should quit
+    SDL_sem *frame_queued;
+    // Posted for every encoded frame, the recording thread waits for it when the queue is full
+    SDL_sem *frame_encoded;
+    SDL_Thread *thread;
+
+    // Used by the recording thread only
+    Uint64 last_generation;
+    bool recorded_any;
+    Uint64 dropped;
+
+    // Used by the encoder thread only
+    Uint64 encoded;
+    // Set once a write failed, the remaining frames are skipped
+    bool failed;
+    // A row of pixels, 0 for dead and 1 for living cells
+    Uint8 *pixels;
+    // A row of pixels as they are written to the file
+    Uint8 *row_bytes;
+    // The cells of the previous GIF frame
+    cell_word *previous;
+    bool has_previous;
+    gif_encoder gif;
+    png_encoder png;
+    Uint32 crc_table[ 256 ];
+    char *png_name;
+};
+
+recording_settings default_recording_settings( const char* path )
+{
+    recording_settings settings;
+    settings.path = path;
+    settings.every = 1;
+    settings.scale = 1;
+    settings.policy = RECORDING_WAIT;
+    return settings;
+}
+
+bool recording_policy_from_name( const char* name, recording_policy* policy )
+{
+    const char *names[ ] = { "wait", "drop" };
+    for ( int i = 0; i < 2; i++ )
+    {
+        if ( strcmp( name, names[ i ] ) == 0 )
+        {
+            *policy = ( recording_policy ) i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+bool recording_format_from_path( const char* path, recording_format* format )
+{
+    const char *extensions[ ] = { ".gif", ".png", ".raw" };
+    size_t length = strlen( path );
+    for ( int i = 0; i < 3; i++ )
+    {
+        if ( length > 4 && strcmp( path + length - 4, extensions[ i ] ) == 0 )
+        {
+            *format = ( recording_format ) i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void write_u16_le( FILE *file, int value )
+{
+    fputc( value & 0xff, file );
+    fputc( ( value >> 8 ) & 0xff, file );
+}
+
+void put_u32_be( Uint8 *out, Uint32 value )
+{
+    out[ 0 ] = ( Uint8 ) ( value >> 24 );
+    out[ 1 ] = ( Uint8 ) ( value >> 16 );
+    out[ 2 ] = ( Uint8 ) ( value >> 8 );
+    out[ 3 ] = ( Uint8 ) value;
+}
+
+/* Writes whether the cells under the pixels first_x to first_x + width - 1 of pixel row y are alive, as 0 or 1 */
+void read_pixel_row( recorder *r, const cell_word *cells, int y, int first_x, int width, Uint8 *out )
+{
+    const cell_word *row = cells + ( Sint64 ) ( y / r->settings.scale ) * r->words_per_row;
+    for ( int i = 0; i < width; i++ )
+    {
+        int x = ( first_x + i ) / r->settings.scale;
+        out[ i ] = ( Uint8 ) ( ( row[ x / CELLS_PER_WORD ] >> ( x % CELLS_PER_WORD ) ) & 1 );
+    }
+}
+
+/* GIF */
+
+void write_gif_header( recorder *r )
+{
+    fwrite( "GIF89a", 1, 6, r->file );
+    write_u16_le( r->file, r->width );
+    write_u16_le( r->file, r->height );
+    // A global color table of 2^( 1 + 1 ) colors, only the first two are used
+    fputc( 0x80 | 0x10 | 0x01, r->file );
+    // The background color and the pixel aspect ratio
+    fputc( 0, r->file );
+    fputc( 0, r->file );
+    Uint8 colors[ 4 * 3 ] = { DEAD_CELL_R, DEAD_CELL_G, DEAD_CELL_B, LIVING_CELL_R, LIVING_CELL_G, LIVING_CELL_B };
+    fwrite( colors, 1, sizeof( colors ), r->file );
+    // Loop forever
+    fwrite( "\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, r->file );
+}
+
+void write_gif_code( gif_encoder *e, FILE *file, int code, int size )
+{
+    gif_code_writer *w = &e->writer;
+    w->bits |= ( Uint32 ) code << w->bit_count;
+    w->bit_count += size;
+    while ( w->bit_count >= 8 )
+    {
+        w->block[ w->block_size++ ] = ( Uint8 ) w->bits;
+        w->bits >>= 8;
+        w->bit_count -= 8;
+        if ( w->block_size == GIF_BLOCK_SIZE )
+        {
+            fputc( GIF_BLOCK_SIZE, file );
+            fwrite( w->block, 1, GIF_BLOCK_SIZE, file );
+            w->block_size = 0;
+        }
+    }
+}
+
+void reset_gif_codes( gif_encoder *e )
+{
+    memset( e->children, 0, sizeof( e->children ) );
+    e->last_code = GIF_END_CODE;
+    e->code_size = GIF_MIN_CODE_SIZE + 1;
+}
+
+void add_gif_pixel( gif_encoder *e, FILE *file, int pixel )
+{
+    if ( e->run < 0 )
+    {
+        e->run = pixel;
+        return;
+    }
+    if ( e->children[ e->run ][ pixel ] )
+    {
+        e->run = e->children[ e->run ][ pixel ];
+        return;
+    }
+    write_gif_code( e, file, e->run, e->code_size );
+    e->children[ e->run ][ pixel ] = ( Uint16 ) ++e->last_code;
+    // The decoder adds the same code after reading the next one, and makes its codes longer one code earlier
+    if ( e->last_code >= 1 << e->code_size )
+    {
+        e->code_size++;
+    }
+    if ( e->last_code == GIF_MAX_CODES - 1 )
+    {
+        write_gif_code( e, file, GIF_CLEAR_CODE, e->code_size );
+        reset_gif_codes( e );
+    }
+    e->run = pixel;
+}
+
+void finish_gif_codes( gif_encoder *e, FILE *file )
+{
+    write_gif_code( e, file, e->run, e->code_size );
+    // The decoder adds a code for the last run too, which may make the end code one bit longer
+    bool longer = e->last_code + 1 >= 1 << e->code_size && e->code_size < GIF_MAX_CODE_SIZE;
+    write_gif_code( e, file, GIF_END_CODE, e->code_size + longer );
+    gif_code_writer *w = &e->writer;
+    if ( w->bit_count )
+    {
+        w->block[ w->block_size++ ] = ( Uint8 ) w->bits;
+    }
+    if ( w->block_size )
+    {
+        fputc( w->block_size, file );
+        fwrite( w->block, 1, w->block_size, file );
+    }
+    fputc( 0, file );
+}
+
+/* Finds the rectangle of cells that differ from the previous frame, returns FALSE if none do */
+bool changed_rectangle( recorder *r, const cell_word *cells, int *first_x, int *first_y, int *last_x, int *last_y )
+{
+    *first_x = r->words_per_row * CELLS_PER_WORD;
+    *last_x = -1;
+    *first_y = -1;
+    *last_y = -1;
+    for ( int y = 0; y < r->rows; y++ )
+    {
+        const cell_word *row = cells + ( Sint64 ) y * r->words_per_row;
+        const cell_word *previous_row = r->previous + ( Sint64 ) y * r->words_per_row;
+        for ( int word = 0; word < r->words_per_row; word++ )
+        {
+            cell_word change = row[ word ] ^ previous_row[ word ];
+            if ( !change )
+            {
+                continue;
+            }
+            *first_y = *first_y < 0 ? y : *first_y;
+            *last_y = y;
+            // Only search the word's lowest and highest changed cell if they can widen the rectangle
+            if ( word * CELLS_PER_WORD < *first_x )
+            {
+                int low = 0;
+                while ( !( ( change >> low ) & 1 ) )
+                {
+                    low++;
+                }
+                *first_x = word * CELLS_PER_WORD + low < *first_x ? word * CELLS_PER_WORD + low : *first_x;
+            }
+            if ( word * CELLS_PER_WORD + CELLS_PER_WORD - 1 > *last_x )
+            {
+                int high = CELLS_PER_WORD - 1;
+                while ( !( ( change >> high ) & 1 ) )
+                {
+                    high--;
+                }
+                *last_x = word * CELLS_PER_WORD + high > *last_x ? word * CELLS_PER_WORD + high : *last_x;
+            }
+        }
+    }
+    return *last_y >= 0;
+}
+
+/* Adds a frame that only stores the pixels of the cells that changed since the previous frame */
+void encode_gif_frame( recorder *r, const queued_frame *frame )
+{
+    int first_x = 0;
+    int first_y = 0;
+    int last_x = r->columns - 1;
+    int last_y = r->rows - 1;
+    if ( r->has_previous && !changed_rectangle( r, frame->cells, &first_x, &first_y, &last_x, &last_y ) )
+    {
+        // A frame needs at least one pixel to take its time
+        last_x = first_x = 0;
+        last_y = first_y = 0;
+    }
+    int left = first_x * r->settings.scale;
+    int top = first_y * r->settings.scale;
+    int width = ( last_x - first_x + 1 ) * r->settings.scale;
+    int height = ( last_y - first_y + 1 ) * r->settings.scale;
+
+    // The graphic control extension: the frame is drawn over the previous one and shown for GIF_FRAME_DELAY
+    fwrite( "\x21\xf9\x04\x04", 1, 4, r->file );
+    write_u16_le( r->file, GIF_FRAME_DELAY );
+    fputc( 0, r->file );
+    fputc( 0, r->file );
+    // The image descriptor, the image uses the global color table
+    fputc( 0x2c, r->file );
+    write_u16_le( r->file, left );
+    write_u16_le( r->file, top );
+    write_u16_le( r->file, width );
+    write_u16_le( r->file, height );
+    fputc( 0, r->file );
+
+    gif_encoder *e = &r->gif;
+    memset( &e->writer, 0, sizeof( e->writer ) );
+    reset_gif_codes( e );
+    e->run = -1;
+    fputc( GIF_MIN_CODE_SIZE, r->file );
+    write_gif_code( e, r->file, GIF_CLEAR_CODE, e->code_size );
+    for ( int y = top; y < top + height; y++ )
+    {
+        read_pixel_row( r, frame->cells, y, left, width, r->pixels );
+        for ( int x = 0; x < width; x++ )
+        {
+            add_gif_pixel( e, r->file, r->pixels[ x ] );
+        }
+    }
+    finish_gif_codes( e, r->file );
+
+    memcpy( r->previous, frame->cells, r->frame_words * sizeof( cell_word ) );
+    r->has_previous = TRUE;
+}
+
+/* PNG */
+
+void fill_crc_table( Uint32 *table )
+{
+    for ( Uint32 n = 0; n < 256; n++ )
+    {
+        Uint32 c = n;
+        for ( int bit = 0; bit < 8; bit++ )
+        {
+            c = c & 1 ? 0xedb88320 ^ ( c >> 1 ) : c >> 1;
+        }
+        table[ n ] = c;
+    }
+}
+
+void write_png_chunk( recorder *r, FILE *file, const char *type, const Uint8 *data, Uint32 size )
+{
+    Uint8 field[ 4 ];
+    put_u32_be( field, size );
+    fwrite( field, 1, 4, file );
+    fwrite( type, 1, 4, file );
+    fwrite( data, 1, size, file );
+    Uint32 crc = 0xffffffff;
+    for ( int i = 0; i < 4; i++ )
+    {
+        crc = r->crc_table[ ( crc ^ ( Uint8 ) type[ i ] ) & 0xff ] ^ ( crc >> 8 );
+    }
+    for ( Uint32 i = 0; i < size; i++ )
+    {
+        crc = r->crc_table[ ( crc ^ data[ i ] ) & 0xff ] ^ ( crc >> 8 );
+    }
+    put_u32_be( field, crc ^ 0xffffffff );
+    fwrite( field, 1, 4, file );
+}
+
+/* Writes the pending bytes as a stored deflate block in an IDAT chunk, the zlib header goes in front of the first one */
+void flush_png_block( recorder *r, FILE *file, bool last )
+{
+    png_encoder *p = &r->png;
+    // The block's bytes start after the room for both headers
+    Uint8 *block = p->chunk + 7;
+    int start = p->first_block ? 0 : 2;
+    if ( p->first_block )
+    {
+        // Deflate with a 32K window and no preset dictionary, the check bits make it a multiple of 31
+        p->chunk[ 0 ] = 0x78;
+        p->chunk[ 1 ] = 0x01;
+    }
+    p->chunk[ 2 ] = last;
+    p->chunk[ 3 ] = ( Uint8 ) p->block_size;
+    p->chunk[ 4 ] = ( Uint8 ) ( p->block_size >> 8 );
+    p->chunk[ 5 ] = ( Uint8 ) ~p->block_size;
+    p->chunk[ 6 ] = ( Uint8 ) ( ~p->block_size >> 8 );
+    Uint32 size = 7 - start + p->block_size;
+    if ( last )
+    {
+        put_u32_be( block + p->block_size, ( p->adler_b << 16 ) | p->adler_a );
+        size += 4;
+    }
+    write_png_chunk( r, file, "IDAT", p->chunk + start, size );
+    p->first_block = FALSE;
+    p->block_size = 0;
+}
+
+void add_png_bytes( recorder *r, FILE *file, const Uint8 *bytes, int count )
+{
+    png_encoder *p = &r->png;
+    Uint8 *block = p->chunk + 7;
+    for ( int i = 0; i < count; i++ )
+    {
+        p->adler_a = ( p->adler_a + bytes[ i ] ) % 65521;
+        p->adler_b = ( p->adler_b + p->adler_a ) % 65521;
+        block[ p->block_size++ ] = bytes[ i ];
+        if ( p->block_size == PNG_BLOCK_SIZE )
+        {
+            flush_png_block( r, file, FALSE );
+        }
+    }
+}
+
+/* Writes the frame to path_<generation>.png as an image with a palette of the two colors and one bit per pixel */
+bool encode_png_frame( recorder *r, const queued_frame *frame )
+{
+    size_t length = strlen( r->path );
+    snprintf( r->png_name, length + PNG_SUFFIX_SIZE, "%.*s_%08llu.png", ( int ) ( length - 4 ), r->path,
+              ( unsigned long long ) frame->generation );
+    FILE *file = fopen( r->png_name, "wb" );
+    if ( !file )
+    {
+        fprintf( stderr, "error creating %s\n", r->png_name );
+        return FALSE;
+    }
+    fwrite( "\x89PNG\r\n\x1a\n", 1, 8, file );
+    Uint8 header[ 13 ];
+    put_u32_be( header, ( Uint32 ) r->width );
+    put_u32_be( header + 4, ( Uint32 ) r->height );
+    // 1 bit per pixel, palette colors, deflate, no filters and no interlacing
+    header[ 8 ] = 1;
+    header[ 9 ] = 3;
+    header[ 10 ] = header[ 11 ] = header[ 12 ] = 0;
+    write_png_chunk( r, file, "IHDR", header, sizeof( header ) );
+    Uint8 colors[ 2 * 3 ] = { DEAD_CELL_R, DEAD_CELL_G, DEAD_CELL_B, LIVING_CELL_R, LIVING_CELL_G, LIVING_CELL_B };
+    write_png_chunk( r, file, "PLTE", colors, sizeof( colors ) );
+
+    png_encoder *p = &r->png;
+    p->block_size = 0;
+    p->first_block = TRUE;
+    p->adler_a = 1;
+    p->adler_b = 0;
+    int row_size = ( r->width + 7 ) / 8;
+    for ( int y = 0; y < r->height; y++ )
+    {
+        read_pixel_row( r, frame->cells, y, 0, r->width, r->pixels );
+        // The row starts with its filter type, 0 is none. The leftmost pixel is the highest bit.
+        r->row_bytes[ 0 ] = 0;
+        memset( r->row_bytes + 1, 0, row_size );
+        for ( int x = 0; x < r->width; x++ )
+        {
+            r->row_bytes[ 1 + x / 8 ] |= r->pixels[ x ] << ( 7 - x % 8 );
+        }
+        add_png_bytes( r, file, r->row_bytes, 1 + row_size );
+    }
+    flush_png_block( r, file, TRUE );
+    write_png_chunk( r, file, "IEND", NULL, 0 );
+
+    bool written = !ferror( file );
+    written = !fclose( file ) && written;
+    if ( !written )
+    {
+        fprintf( stderr, "error writing %s\n", r->png_name );
+    }
+    return written;
+}
+
+/* Raw video */
+
+void encode_raw_frame( recorder *r, const queued_frame *frame )
+{
+    for ( int y = 0; y < r->height; y++ )
+    {
+        read_pixel_row( r, frame->cells, y, 0, r->width, r->pixels );
+        for ( int x = 0; x < r->width; x++ )
+        {
+            r->row_bytes[ x ] = r->pixels[ x ] ? LIVING_CELL_R : DEAD_CELL_R;
+        }
+        fwrite( r->row_bytes, 1, r->width, r->file );
+    }
+}
+
+void encode_frame( recorder *r, const queued_frame *frame )
+{
+    if ( r->format == RECORDING_PNG )
+    {
+        r->failed = !encode_png_frame( r, frame );
+    }
+    else
+    {
+        if ( r->format == RECORDING_GIF )
+        {
+            encode_gif_frame( r, frame );
+        }
+        else
+        {
+            encode_raw_frame( r, frame );
+        }
+        if ( ferror( r->file ) )
+        {
+            fprintf( stderr, "error writing %s\n", r->path );
+            r->failed = TRUE;
+        }
+    }
+    r->encoded += !r->failed;
+}
+
+int recorder_encoder_main( void *data )
+{
+    recorder *r = data;
+    for ( ;; )
+    {
+        SDL_SemWait( r->frame_queued );
+        Uint32 read = ( Uint32 ) SDL_AtomicGet( &r->read );
+        // The post that tells the encoder to quit comes after the posts of the frames that were queued before it
+        if ( read == ( Uint32 ) SDL_AtomicGet( &r->written ) )
+        {
+            break;
+        }
+        if ( !r->failed )
+        {
+            encode_frame( r, &r->queue[ read & ( r->queue_size - 1 ) ] );
+        }
+        SDL_AtomicSet( &r->read, ( int ) ( read + 1 ) );
+        SDL_SemPost( r->frame_encoded );
+    }
+    return 0;
+}
+
+recorder* create_recorder( const recording_settings* settings, board* b )
+{
+    recording_format format;
+    if ( !recording_format_from_path( settings->path, &format ) )
+    {
+        fprintf( stderr, "unknown recording format, the file has to end with .gif, .png or .raw: %s\n", settings->path );
+        return NULL;
+    }
+    if ( settings->every <= 0 || settings->scale <= 0 )
+    {
+        fprintf( stderr, "the recorded generations and the pixels per cell must be positive\n" );
+        return NULL;
+    }
+    Sint64 width = ( Sint64 ) b->columns * settings->scale;
+    Sint64 height = ( Sint64 ) b->rows * settings->scale;
+    Sint64 max_size = format == RECORDING_GIF ? GIF_MAX_SIZE : PNG_MAX_SIZE;
+    if ( width > max_size || height > max_size )
+    {
+        fprintf( stderr, "the frames of %lld x %lld pixels are too big, they can't be larger than %lld x %lld\n",
+                 ( long long ) width, ( long long ) height, ( long long ) max_size, ( long long ) max_size );
+        return NULL;
+    }
+
+    recorder *r = calloc( 1, sizeof( recorder ) );
+    r->settings = *settings;
+    r->format = format;
+    r->path = malloc( strlen( settings->path ) + 1 );
+    strcpy( r->path, settings->path );
+    r->settings.path = r->path;
+    r->rows = b->rows;
+    r->columns = b->columns;
+    r->words_per_row = b->words_per_row;
+    r->frame_words = ( size_t ) b->rows * b->words_per_row;
+    r->width = ( int ) width;
+    r->height = ( int ) height;
+    r->pixels = malloc( r->width );
+    // A raw row has a byte per pixel, a PNG row a bit per pixel and the filter type
+    r->row_bytes = malloc( format == RECORDING_RAW ? r->width : r->width / 8 + 2 );
+    if ( format == RECORDING_GIF )
+    {
+        r->previous = malloc( r->frame_words * sizeof( cell_word ) );
+    }
+    if ( format == RECORDING_PNG )
+    {
+        fill_crc_table( r->crc_table );
+        r->png_name = malloc( strlen( r->path ) + PNG_SUFFIX_SIZE );
+    }
+
+    size_t frames = RECORDER_QUEUE_BYTES / ( r->frame_words * sizeof( cell_word ) );
+    r->queue_size = MIN_QUEUED_FRAMES;
+    while ( r->queue_size < MAX_QUEUED_FRAMES && ( size_t ) r->queue_size * 2 <= frames )
+    {
+        r->queue_size *= 2;
+    }
+    r->queue = calloc( r->queue_size, sizeof( queued_frame ) );
+    bool allocated = r->pixels && r->row_bytes && ( format != RECORDING_GIF || r->previous );
+    for ( int i = 0; i < r->queue_size && allocated; i++ )
+    {
+        r->queue[ i ].cells = malloc( r->frame_words * sizeof( cell_word ) );
+        allocated = r->queue[ i ].cells != NULL;
+    }
+    if ( !allocated )
+    {
+        fprintf( stderr, "error allocating the recording queue of a %d x %d board\n", b->rows, b->columns );
+        destroy_recorder( r );
+        return NULL;
+    }
+
+    // A raw video may go to a named pipe, opening it waits until the other end is opened
+    if ( format != RECORDING_PNG )
+    {
+        r->file = fopen( r->path, "wb" );
+        if ( !r->file )
+        {
+            fprintf( stderr, "error creating %s\n", r->path );
+            destroy_recorder( r );
+            return NULL;
+        }
+    }
+    if ( format == RECORDING_GIF )
+    {
+        write_gif_header( r );
+    }
+
+    r->frame_queued = SDL_CreateSemaphore( 0 );
+    r->frame_encoded = SDL_CreateSemaphore( 0 );
+    r->thread = SDL_CreateThread( recorder_encoder_main, "recording encoder", r );
+    if ( !r->thread )
+    {
+        fprintf( stderr, "error creating the recording thread: %s\n", SDL_GetError( ) );
+        destroy_recorder( r );
+        return NULL;
+    }
+    return r;
+}
+
+void record_board( recorder* r, board* b )
+{
+    if ( ( r->recorded_any && b->generation == r->last_generation ) || b->generation % r->settings.every )
+    {
+        return;
+    }
+    r->recorded_any = TRUE;
+    r->last_generation = b->generation;
+
+    Uint32 written = ( Uint32 ) SDL_AtomicGet( &r->written );
+    while ( written - ( Uint32 ) SDL_AtomicGet( &r->read ) == ( Uint32 ) r->queue_size )
+    {
+        if ( r->settings.policy == RECORDING_DROP )
+        {
+            r->dropped++;
+            return;
+        }
+        SDL_SemWait( r->frame_encoded );
+    }
+    queued_frame *frame = &r->queue[ written & ( r->queue_size - 1 ) ];
+    frame->generation = b->generation;
+    memcpy( frame->cells, b->grid, r->frame_words * sizeof( cell_word ) );
+    // The frame is copied before the counter tells the encoder about it
+    SDL_AtomicSet( &r->written, ( int ) ( written + 1 ) );
+    SDL_SemPost( r->frame_queued );
+}
+
+void destroy_recorder( recorder* r )
+{
+    if ( r->thread )
+    {
+        SDL_SemPost( r->frame_queued );
+        SDL_WaitThread( r->thread, NULL );
+        printf( "recording:          %llu frames of %d x %d pixels to %s, %llu dropped\n", ( unsigned long long ) r->encoded,
+                r->width, r->height, r->path, ( unsigned long long ) r->dropped );
+    }
+    if ( r->file )
+    {
+        if ( r->format == RECORDING_GIF )
+        {
+            fputc( 0x3b, r->file );
+        }
+        if ( fclose( r->file ) && !r->failed )
+        {
+            fprintf( stderr, "error writing %s\n", r->path );
+        }
+    }
+    if ( r->frame_queued )
+    {
+        SDL_DestroySemaphore( r->frame_queued );
+        SDL_DestroySemaphore( r->frame_encoded );
+    }
+    for ( int i = 0; r->queue && i < r->queue_size; i++ )
+    {
+        free( r->queue[ i ].cells );
+    }
+    free( r->queue );
+    free( r->pixels );
+    free( r->row_bytes );
+    free( r->previous );
+    free( r->png_name );
+    free( r->path );
+    free( r );
+}
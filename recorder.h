@@ -0,0 +1,79 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "board.h"
+
+/*
+ * Records the generations of a board as an animated GIF, a sequence of PNG images or a raw video stream.
+ * record_board only copies the packed grid into a bounded single producer, single consumer queue, a background thread
+ * turns the copies into pixels and encodes them, so recording works without a window and never stalls update_board.
+ * When the encoder falls behind and the queue is full the recording policy decides whether the caller waits for
+ * the encoder ( every frame is recorded ) or the frame is dropped ( the simulation keeps its speed ).
+ * Every cell is a square of scale x scale pixels in the colors the board is drawn with.
+ */
+typedef struct recorder recorder;
+
+typedef enum
+{
+    // One animated GIF, only the rectangle of the cells that changed since the last frame is stored
+    RECORDING_GIF,
+    // One PNG image per frame, path_<generation>.png
+    RECORDING_PNG,
+    // 8 bit grayscale frames one after the other without a header, e.g. for ffmpeg -f rawvideo -pix_fmt gray
+    RECORDING_RAW
+} recording_format;
+
+typedef enum
+{
+    // The caller waits until the encoder has made room in the queue
+    RECORDING_WAIT,
+    // The frame is dropped
+    RECORDING_DROP
+} recording_policy;
+
+typedef struct
+{
+    // The format follows the extension: .gif, .png or .raw
+    const char *path;
+    // Only generations that are multiples of this are recorded
+    int every;
+    // The pixels per cell
+    int scale;
+    recording_policy policy;
+} recording_settings;
+
+
+/**
+* Return settings that record every generation of the board to path at one pixel per cell, waiting for the encoder.
+*/
+recording_settings default_recording_settings( const char* path );
+
+/**
+* Set policy to the policy named wait or drop. Returns FALSE if there is no policy with that name.
+*/
+bool recording_policy_from_name( const char* name, recording_policy* policy );
+
+/**
+* Set format to the format of path's extension. Returns FALSE if the extension isn't .gif, .png or .raw.
+*/
+bool recording_format_from_path( const char* path, recording_format* format );
+
+/**
+* Start recording boards with the size of b. Prints an error and returns NULL if the settings are invalid,
+* the frames are too big for the format, the file can't be created or the encoder thread can't be started.
+*/
+recorder* create_recorder( const recording_settings* settings, board* b );
+
+/**
+* Call this after every update and edit. If the board's generation is due and wasn't recorded last, its cells are queued.
+* Only one thread may record boards.
+*/
+void record_board( recorder* r, board* b );
+
+/**
+* Wait until the queued frames are encoded, finish the file, print how many frames were recorded and dropped
+* and free the recorder.
+*/
+void destroy_recorder( recorder* r );
+
+#endif
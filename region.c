@@ -0,0 +1,345 @@
+#include "region.h"
+#include "random_generator.h"
+
+static inline cell_word *region_row( const cell_region *r, int y )
+{
+    return r->cells + ( Sint64 ) y * r->words_per_row;
+}
+
+/*
+ * Transposes a block of 64 x 64 cells, bit k of word i becomes bit i of word k. The quadrants above and below the
+ * diagonal are swapped, then the quadrants of the quadrants and so on, every step swaps half of the bits of 32 pairs of words.
+ */
+void transpose_block( cell_word *block )
+{
+    cell_word mask = 0x00000000ffffffffULL;
+    for ( int size = 32; size; size >>= 1, mask ^= mask << size )
+    {
+        for ( int i = 0; i < CELLS_PER_WORD; i = ( ( i | size ) + 1 ) & ~size )
+        {
+            cell_word swapped = ( ( block[ i ] >> size ) ^ block[ i | size ] ) & mask;
+            block[ i ] ^= swapped << size;
+            block[ i | size ] ^= swapped;
+        }
+    }
+}
+
+cell_region* create_region( int width, int height )
+{
+    cell_region *r = malloc( sizeof( cell_region ) );
+    if ( !r )
+    {
+        fprintf( stderr, "error allocating a region of %d x %d cells\n", width, height );
+        return NULL;
+    }
+    r->width = width;
+    r->height = height;
+    r->words_per_row = ( width + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    // The row after the last one is the scratch row of the flips. An empty region still gets a word, calloc( 0 ) may return NULL.
+    size_t words = ( size_t ) r->words_per_row * ( height + 1 );
+    r->cells = calloc( words ? words : 1, sizeof( cell_word ) );
+    if ( !r->cells )
+    {
+        fprintf( stderr, "error allocating a region of %d x %d cells\n", width, height );
+        free( r );
+        return NULL;
+    }
+    return r;
+}
+
+void free_region( cell_region* r )
+{
+    if ( r )
+    {
+        free( r->cells );
+        free( r );
+    }
+}
+
+cell_region* copy_region( board* b, int x, int y, int width, int height )
+{
+    cell_region *r = create_region( width, height );
+    if ( !r )
+    {
+        return NULL;
+    }
+    cell_word mask = last_word_mask( width );
+    for ( int row = 0; row < height && r->words_per_row; row++ )
+    {
+        cell_word *cells = region_row( r, row );
+        read_board_row( b, x, ( Sint64 ) y + row, width, cells );
+        // The board's cells right of the region are cut off
+        cells[ r->words_per_row - 1 ] &= mask;
+    }
+    return r;
+}
+
+void paste_region( board* b, const cell_region* r, int x, int y, paste_mode mode )
+{
+    int first = y > 0 ? 0 : -y;
+    for ( int row = first; row < r->height && y + row < b->rows; row++ )
+    {
+        paste_board_row( b, x, y + row, r->width, region_row( r, row ), mode );
+    }
+}
+
+void clear_region( board* b, int x, int y, int width, int height )
+{
+    int first = y > 0 ? 0 : -y;
+    for ( int row = first; row < height && y + row < b->rows; row++ )
+    {
+        paste_board_row( b, x, y + row, width, NULL, PASTE_REPLACE );
+    }
+}
+
+void flip_region_horizontally( cell_region* r )
+{
+    size_t row_size = r->words_per_row * sizeof( cell_word );
+    cell_word *mirrored = region_row( r, r->height );
+    for ( int y = 0; y < r->height; y++ )
+    {
+        mirror_row( region_row( r, y ), mirrored, r->width );
+        memcpy( region_row( r, y ), mirrored, row_size );
+    }
+}
+
+void flip_region_vertically( cell_region* r )
+{
+    size_t row_size = r->words_per_row * sizeof( cell_word );
+    cell_word *swap = region_row( r, r->height );
+    for ( int y = 0; y < r->height / 2; y++ )
+    {
+        memcpy( swap, region_row( r, y ), row_size );
+        memcpy( region_row( r, y ), region_row( r, r->height - 1 - y ), row_size );
+        memcpy( region_row( r, r->height - 1 - y ), swap, row_size );
+    }
+}
+
+cell_region* rotate_region( const cell_region* r, bool clockwise )
+{
+    // Transposed first, the rows of the region become the columns of the rotated one
+    cell_region *rotated = create_region( r->height, r->width );
+    if ( !rotated )
+    {
+        return NULL;
+    }
+    cell_word block[ CELLS_PER_WORD ];
+    for ( int block_y = 0; block_y < r->height; block_y += CELLS_PER_WORD )
+    {
+        for ( int word = 0; word < r->words_per_row; word++ )
+        {
+            // The rows below the region are dead, they become the unused bits of the rotated rows
+            for ( int i = 0; i < CELLS_PER_WORD; i++ )
+            {
+                block[ i ] = block_y + i < r->height ? region_row( r, block_y + i )[ word ] : 0;
+            }
+            transpose_block( block );
+            int first_column = word * CELLS_PER_WORD;
+            for ( int i = 0; i < CELLS_PER_WORD && first_column + i < r->width; i++ )
+            {
+                region_row( rotated, first_column + i )[ block_y / CELLS_PER_WORD ] = block[ i ];
+            }
+        }
+    }
+    // A transposed region turned clockwise is mirrored left to right, turned counterclockwise it is mirrored top to bottom
+    if ( clockwise )
+    {
+        flip_region_horizontally( rotated );
+    }
+    else
+    {
+        flip_region_vertically( rotated );
+    }
+    return rotated;
+}
+
+static inline bool region_cell( const cell_region *r, int x, int y )
+{
+    return ( region_row( r, y )[ x / CELLS_PER_WORD ] >> ( x % CELLS_PER_WORD ) ) & 1;
+}
+
+/* Whether the unused bits of the region's rows are zero */
+bool region_padding_clear( const cell_region *r )
+{
+    cell_word unused = ~last_word_mask( r->width );
+    for ( int y = 0; y < r->height; y++ )
+    {
+        if ( region_row( r, y )[ r->words_per_row - 1 ] & unused )
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Whether the cell is inside the board and alive, the reference the copies are compared with */
+static inline bool board_cell( board *b, int x, int y )
+{
+    return x >= 0 && y >= 0 && x < b->columns && y < b->rows && cell_state( x, y, b );
+}
+
+/* Returns whether the regions were copied, flipped and rotated the same as cell by cell */
+bool check_region_transforms( board *b, int x, int y, int width, int height )
+{
+    cell_region *r = copy_region( b, x, y, width, height );
+    cell_region *flipped = copy_region( b, x, y, width, height );
+    cell_region *clockwise = r ? rotate_region( r, TRUE ) : NULL;
+    cell_region *counterclockwise = r ? rotate_region( r, FALSE ) : NULL;
+    bool same = r && flipped && clockwise && counterclockwise;
+    for ( int row = 0; same && row < height; row++ )
+    {
+        for ( int column = 0; column < width; column++ )
+        {
+            same &= region_cell( r, column, row ) == board_cell( b, x + column, y + row );
+        }
+    }
+    if ( same )
+    {
+        flip_region_horizontally( flipped );
+        same &= region_padding_clear( r ) && region_padding_clear( flipped );
+        for ( int row = 0; row < height; row++ )
+        {
+            for ( int column = 0; column < width; column++ )
+            {
+                same &= region_cell( flipped, column, row ) == region_cell( r, width - 1 - column, row );
+            }
+        }
+        flip_region_horizontally( flipped );
+        flip_region_vertically( flipped );
+        for ( int row = 0; row < height; row++ )
+        {
+            for ( int column = 0; column < width; column++ )
+            {
+                same &= region_cell( flipped, column, row ) == region_cell( r, column, height - 1 - row );
+            }
+        }
+        same &= clockwise->width == height && clockwise->height == width &&
+                counterclockwise->width == height && counterclockwise->height == width &&
+                region_padding_clear( clockwise ) && region_padding_clear( counterclockwise );
+    }
+    for ( int row = 0; same && row < width; row++ )
+    {
+        for ( int column = 0; column < height; column++ )
+        {
+            same &= region_cell( clockwise, column, row ) == region_cell( r, row, height - 1 - column );
+            same &= region_cell( counterclockwise, column, row ) == region_cell( r, width - 1 - row, column );
+        }
+    }
+    free_region( r );
+    free_region( flipped );
+    free_region( clockwise );
+    free_region( counterclockwise );
+    return same;
+}
+
+/*
+ * Returns whether pasting and clearing a region changed the board the same as toggling the cells one by one.
+ * If settle is TRUE the board's cells are killed before, so only the tiles the paste marks are updated afterwards.
+ */
+bool check_region_paste( board *b, random_generator *g, bool settle )
+{
+    int width = 1 + ( int ) random_below( g, 200 );
+    int height = 1 + ( int ) random_below( g, 200 );
+    cell_region *r = copy_region( b, ( int ) random_below( g, b->columns ), ( int ) random_below( g, b->rows ), width, height );
+    if ( settle )
+    {
+        kill_all_cells( b );
+        update_board( b );
+    }
+    board *expected = create_board( b->rows, b->columns );
+    if ( !r || !expected )
+    {
+        free_region( r );
+        if ( expected )
+        {
+            free_board( expected );
+        }
+        return FALSE;
+    }
+    load_board_grid( expected, b->grid );
+
+    // Pasted and cleared partly beyond the board's edges
+    paste_mode mode = ( paste_mode ) random_below( g, 3 );
+    int x = ( int ) random_below( g, b->columns + 100 ) - 50;
+    int y = ( int ) random_below( g, b->rows + 100 ) - 50;
+    paste_region( b, r, x, y, mode );
+    for ( int row = 0; row < height; row++ )
+    {
+        for ( int column = 0; column < width; column++ )
+        {
+            if ( x + column < 0 || x + column >= b->columns || y + row < 0 || y + row >= b->rows )
+            {
+                continue;
+            }
+            bool old = cell_state( x + column, y + row, expected );
+            bool cell = region_cell( r, column, row );
+            bool next = mode == PASTE_REPLACE ? cell : mode == PASTE_OR ? old | cell : old ^ cell;
+            if ( next != old )
+            {
+                toggle_cell_state( x + column, y + row, expected );
+            }
+        }
+    }
+    x = ( int ) random_below( g, b->columns + 100 ) - 50;
+    y = ( int ) random_below( g, b->rows + 100 ) - 50;
+    width = ( int ) random_below( g, 150 );
+    height = ( int ) random_below( g, 150 );
+    clear_region( b, x, y, width, height );
+    for ( int row = 0; row < height; row++ )
+    {
+        for ( int column = 0; column < width; column++ )
+        {
+            if ( board_cell( expected, x + column, y + row ) )
+            {
+                toggle_cell_state( x + column, y + row, expected );
+            }
+        }
+    }
+
+    size_t grid_size = ( size_t ) b->rows * b->words_per_row * sizeof( cell_word );
+    bool same = memcmp( b->grid, expected->grid, grid_size ) == 0 && b->living_cells == count_living_cells( b ) &&
+                board_hash( b ) == board_hash( expected );
+    // The next generations only match if the pasted tiles are updated
+    for ( int generation = 0; generation < 2; generation++ )
+    {
+        update_board( b );
+        update_board( expected );
+    }
+    same &= memcmp( b->grid, expected->grid, grid_size ) == 0;
+    free_region( r );
+    free_board( expected );
+    return same;
+}
+
+int check_regions( int board_count )
+{
+    int failed_checks = 0;
+    random_generator g;
+    seed_generator( &g, DEFAULT_RANDOM_SEED, 2 );
+    for ( int i = 0; i < board_count; i++ )
+    {
+        int rows = 1 + ( int ) random_below( &g, 300 );
+        int columns = 1 + ( int ) random_below( &g, 300 );
+        board *b = create_board( rows, columns );
+        fill_board_random( b, 0.4 );
+        // The regions reach beyond the board's edges as well
+        int width = 1 + ( int ) random_below( &g, 200 );
+        int height = 1 + ( int ) random_below( &g, 200 );
+        int x = ( int ) random_below( &g, columns + 100 ) - 50;
+        int y = ( int ) random_below( &g, rows + 100 ) - 50;
+        if ( !check_region_transforms( b, x, y, width, height ) )
+        {
+            fprintf( stderr, "a region of %dx%d cells at %d, %d of a %dx%d board was copied, flipped or rotated wrong\n",
+                     width, height, x, y, columns, rows );
+            failed_checks++;
+        }
+        if ( !check_region_paste( b, &g, i % 2 ) )
+        {
+            fprintf( stderr, "pasting or clearing a region changed a %dx%d board wrong\n", columns, rows );
+            failed_checks++;
+        }
+        free_board( b );
+    }
+    printf( "%d boards with regions, %d failed checks\n", board_count, failed_checks );
+    return failed_checks;
+}
@@ -0,0 +1,72 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "board.h"
+
+/*
+ * Rectangles of cells that are copied out of a board, transformed and pasted back into it.
+ * The cells of a region are packed like the rows of a board, so copying and pasting shift whole words into place
+ * and mask the edges instead of going cell by cell. Flips and rotations work on words too: a row is flipped by
+ * reversing the bits of its words and a rotation transposes blocks of 64 x 64 cells.
+ */
+typedef struct
+{
+    int width;
+    int height;
+    // Every row starts at a word boundary. The unused bits of a row's last word are always zero.
+    int words_per_row;
+    // height rows and a scratch row for the flips
+    cell_word *cells;
+} cell_region;
+
+
+/**
+* Allocate a region of width x height dead cells. Prints an error and returns NULL if it doesn't fit into memory.
+*/
+cell_region* create_region( int width, int height );
+
+/**
+* Free a region, NULL is ignored.
+*/
+void free_region( cell_region* r );
+
+/**
+* Return a region with a copy of the board's width x height cells whose top left cell is at x, y.
+* Cells outside of the board are dead. Returns NULL if the region can't be allocated.
+*/
+cell_region* copy_region( board* b, int x, int y, int width, int height );
+
+/**
+* Combine the region's cells with the board's cells below them as mode says, with the region's top left cell at x, y.
+* Cells that don't fit into the board are dropped.
+*/
+void paste_region( board* b, const cell_region* r, int x, int y, paste_mode mode );
+
+/**
+* Kill the board's width x height cells whose top left cell is at x, y.
+*/
+void clear_region( board* b, int x, int y, int width, int height );
+
+/**
+* Mirror the region's cells left to right.
+*/
+void flip_region_horizontally( cell_region* r );
+
+/**
+* Mirror the region's cells top to bottom.
+*/
+void flip_region_vertically( cell_region* r );
+
+/**
+* Return a region with the region's cells turned by a quarter turn, clockwise or counterclockwise.
+* Its width is the region's height and its height the region's width. Returns NULL if it can't be allocated.
+*/
+cell_region* rotate_region( const cell_region* r, bool clockwise );
+
+/**
+* Copy, flip, rotate, paste and clear random regions of board_count random boards, partly beyond their edges, and
+* compare them with the same changes made cell by cell. Prints the results and returns the number of mismatches.
+*/
+int check_regions( int board_count );
+
+#endif
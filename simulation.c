@@ -0,0 +1,447 @@
+#include "simulation.h"
+#include "density_pyramid.h"
+
+// Must be a power of two
+#define EDIT_QUEUE_SIZE 4096
+// The simulation checks for edits and publishes generations at least this often
+#define BATCH_TIME_BUDGET_MS 10
+// How long the thread sleeps at most when it has nothing to do
+#define IDLE_WAIT_MS 100
+// Set in the middle frame's index when it holds a generation the renderer hasn't picked up yet
+#define FRESH_FRAME 4
+
+typedef enum
+{
+    EDIT_TOGGLE_CELL,
+    EDIT_TASK,
+    // Rewinds the board by x generations
+    EDIT_REWIND
+} edit_type;
+
+/* A published generation. Only the grid, the counts and the pyramid are drawn, so unlike the board it has a single grid and no tiles. */
+typedef struct
+{
+    // rows, columns, words_per_row, grid, living_cells, generation and pyramid are set, everything else is zero
+    board cells;
+    // The board's change_stamp when the grid was copied last, a publish only copies the tiles stamped after it
+    Uint64 stamp;
+    bool copied;
+} board_frame;
+
+typedef struct
+{
+    edit_type type;
+    int x;
+    int y;
+    board_task task;
+    void *data;
+} board_edit;
+
+struct simulation
+{
+    board *b;
+    checkpointer *board_checkpointer;
+    metrics *run_metrics;
+    // Lets the simulation skip the generations of a board that has settled into a cycle
+    cycle_detector *detector;
+    // The generations the board can be rewound to, NULL if they aren't remembered
+    board_history *history;
+    // Records the generations into a GIF, PNGs or a raw video, NULL if they aren't recorded
+    recorder *board_recorder;
+    SDL_Thread *thread;
+    // Posted when there are new edits, a new speed or the simulation should quit
+    SDL_sem *wake;
+    SDL_atomic_t quit;
+    SDL_atomic_t paused;
+    // Generations per 1000 seconds, written by the caller and read by the simulation thread
+    SDL_atomic_t speed_per_1000_seconds;
+
+    // Single producer, single consumer ring of edits. The counters only grow, the index is the counter modulo the size.
+    board_edit edits[ EDIT_QUEUE_SIZE ];
+    SDL_atomic_t edits_written;
+    SDL_atomic_t edits_read;
+
+    // The triple buffer: the simulation writes frames[ back_frame ] and the renderer reads frames[ front_frame ],
+    // middle_frame is the index of the third frame ( ORed with FRESH_FRAME if it is newer than the front frame ).
+    board_frame *frames[ 3 ];
+    int back_frame;
+    int front_frame;
+    SDL_atomic_t middle_frame;
+};
+
+/* Returns a frame for the board's cells or NULL if its grid can't be allocated */
+board_frame* create_frame( board *b )
+{
+    board_frame *frame = calloc( 1, sizeof( board_frame ) );
+    if ( !frame )
+    {
+        return NULL;
+    }
+    frame->cells.rows = b->rows;
+    frame->cells.columns = b->columns;
+    frame->cells.words_per_row = b->words_per_row;
+    frame->cells.grid = malloc( ( size_t ) b->rows * b->words_per_row * sizeof( cell_word ) );
+    if ( !frame->cells.grid )
+    {
+        free( frame );
+        return NULL;
+    }
+    return frame;
+}
+
+void free_frame( board_frame *frame )
+{
+    if ( frame )
+    {
+        if ( frame->cells.pyramid )
+        {
+            destroy_density_pyramid( frame->cells.pyramid );
+        }
+        free( frame->cells.grid );
+        free( frame );
+    }
+}
+
+/* Copies the words of the tiles tile_x to end_x - 1 of a row of tiles into the frame */
+void copy_tiles( board *b, board *cells, int tile_y, int tile_x, int end_x )
+{
+    int last_row = ( tile_y + 1 ) * TILE_ROWS < b->rows ? ( tile_y + 1 ) * TILE_ROWS : b->rows;
+    for ( int y = tile_y * TILE_ROWS; y < last_row; y++ )
+    {
+        Sint64 first_word = ( Sint64 ) y * b->words_per_row + tile_x;
+        memcpy( cells->grid + first_word, b->grid + first_word, ( size_t ) ( end_x - tile_x ) * sizeof( cell_word ) );
+    }
+}
+
+/* Copies the board's current generation into a frame, only the tiles that changed since the frame's last copy */
+void copy_to_frame( board *b, board_frame *frame )
+{
+    board *cells = &frame->cells;
+    if ( !frame->copied || b->all_tiles_stamp > frame->stamp )
+    {
+        memcpy( cells->grid, b->grid, ( size_t ) b->rows * b->words_per_row * sizeof( cell_word ) );
+    }
+    else if ( b->change_stamp != frame->stamp )
+    {
+        // Runs of changed tiles are copied a row at a time
+        for ( int tile_y = 0; tile_y < b->tile_rows; tile_y++ )
+        {
+            const Uint64 *stamps = &b->tile_stamps[ ( Sint64 ) tile_y * b->tile_columns ];
+            int tile_x = 0;
+            while ( tile_x < b->tile_columns )
+            {
+                if ( stamps[ tile_x ] <= frame->stamp )
+                {
+                    tile_x++;
+                    continue;
+                }
+                int run_end = tile_x;
+                while ( run_end < b->tile_columns && stamps[ run_end ] > frame->stamp )
+                {
+                    run_end++;
+                }
+                copy_tiles( b, cells, tile_y, tile_x, run_end );
+                tile_x = run_end;
+            }
+        }
+    }
+    frame->stamp = b->change_stamp;
+    frame->copied = TRUE;
+    // The frame's pyramid is counted from the board's tiles with its own stamp, so it catches up with the same tiles.
+    // The frame is drawn without its pyramid if there is no memory for it.
+    if ( b->pyramid && !cells->pyramid )
+    {
+        cells->pyramid = create_density_pyramid( b );
+    }
+    else if ( cells->pyramid )
+    {
+        update_density_pyramid( cells->pyramid, b );
+    }
+    cells->living_cells = b->living_cells;
+    cells->generation = b->generation;
+}
+
+/* Publishes the board, a published frame the renderer hasn't picked up yet is replaced */
+void publish_frame( simulation *s )
+{
+    copy_to_frame( s->b, s->frames[ s->back_frame ] );
+    s->back_frame = SDL_AtomicSet( &s->middle_frame, s->back_frame | FRESH_FRAME ) & ~FRESH_FRAME;
+}
+
+/* Brings the history, the density pyramid and the recording up to date with the board's cells */
+void track_board( simulation *s )
+{
+    if ( s->history )
+    {
+        remember_generation( s->history, s->b );
+    }
+    if ( s->board_recorder )
+    {
+        record_board( s->board_recorder, s->b );
+    }
+    if ( s->b->pyramid )
+    {
+        update_density_pyramid( s->b->pyramid, s->b );
+    }
+}
+
+/* Applies the queued edits, returns whether there were any */
+bool apply_edits( simulation *s )
+{
+    int read = SDL_AtomicGet( &s->edits_read );
+    int written = SDL_AtomicGet( &s->edits_written );
+    for ( int i = read; i != written; i++ )
+    {
+        board_edit *edit = &s->edits[ i & ( EDIT_QUEUE_SIZE - 1 ) ];
+        if ( edit->type == EDIT_TOGGLE_CELL )
+        {
+            toggle_cell_state( edit->x, edit->y, s->b );
+        }
+        else if ( edit->type == EDIT_REWIND )
+        {
+            if ( s->history )
+            {
+                rewind_board( s->history, s->b, ( Uint64 ) edit->x );
+            }
+        }
+        else
+        {
+            edit->task( s->b, edit->data );
+        }
+    }
+    SDL_AtomicSet( &s->edits_read, written );
+    if ( read != written )
+    {
+        track_board( s );
+    }
+    return read != written;
+}
+
+/* Returns the generations per second */
+double simulation_speed( simulation *s )
+{
+    return SDL_AtomicGet( &s->speed_per_1000_seconds ) / 1000.0;
+}
+
+int simulation_main( void *data )
+{
+    simulation *s = data;
+    double frequency = ( double ) SDL_GetPerformanceFrequency( );
+    Uint64 last_time = SDL_GetPerformanceCounter( );
+    // The number of generations that are due
+    double due_generations = 0;
+
+    while ( !SDL_AtomicGet( &s->quit ) )
+    {
+        bool changed = apply_edits( s );
+
+        Uint64 now = SDL_GetPerformanceCounter( );
+        double speed = simulation_speed( s );
+        if ( !SDL_AtomicGet( &s->paused ) )
+        {
+            due_generations += ( now - last_time ) / frequency * speed;
+        }
+        last_time = now;
+
+        // Update until the due generations are done or the time budget is used up
+        Uint64 budget_end = now + ( Uint64 ) ( frequency * BATCH_TIME_BUDGET_MS / 1000 );
+        while ( due_generations >= 1 && SDL_GetPerformanceCounter( ) < budget_end )
+        {
+            // A board in a cycle needs less than a period of updates to catch up, they aren't recorded in the metrics
+            Uint64 skipped = ( Uint64 ) due_generations;
+            if ( fast_forward_board( s->detector, s->b, s->b->generation + skipped ) )
+            {
+                track_board( s );
+                due_generations -= skipped;
+                changed = TRUE;
+                break;
+            }
+            Uint64 step_start = SDL_GetPerformanceCounter( );
+            update_board( s->b );
+            if ( s->run_metrics )
+            {
+                generation_metrics sample = board_metrics( s->b, ( SDL_GetPerformanceCounter( ) - step_start ) * 1000 / frequency );
+                record_generation( s->run_metrics, &sample );
+            }
+            observe_generation( s->detector, s->b );
+            track_board( s );
+            due_generations--;
+            changed = TRUE;
+        }
+        // Don't pile up generations the board can't keep up with
+        if ( due_generations > speed * BATCH_TIME_BUDGET_MS / 1000 + 1 )
+        {
+            due_generations = speed * BATCH_TIME_BUDGET_MS / 1000 + 1;
+        }
+        if ( s->board_checkpointer )
+        {
+            checkpoint_board( s->board_checkpointer, s->b );
+        }
+        if ( changed )
+        {
+            publish_frame( s );
+        }
+
+        // Sleep until the next generation is due or an edit arrives
+        if ( due_generations < 1 )
+        {
+            Uint32 wait = IDLE_WAIT_MS;
+            if ( !SDL_AtomicGet( &s->paused ) && speed > 0 )
+            {
+                double next_generation_ms = ( 1 - due_generations ) / speed * 1000;
+                wait = next_generation_ms < wait ? ( Uint32 ) next_generation_ms : wait;
+            }
+            if ( wait )
+            {
+                SDL_SemWaitTimeout( s->wake, wait );
+            }
+        }
+    }
+    // Edits that were queued before quitting are still applied
+    apply_edits( s );
+    return 0;
+}
+
+/* Frees whatever create_simulation got to, the thread has to be stopped already */
+void free_simulation( simulation* s )
+{
+    for ( int i = 0; i < 3; i++ )
+    {
+        free_frame( s->frames[ i ] );
+    }
+    if ( s->wake )
+    {
+        SDL_DestroySemaphore( s->wake );
+    }
+    destroy_cycle_detector( s->detector );
+    if ( s->history )
+    {
+        destroy_board_history( s->history );
+    }
+    free( s );
+}
+
+simulation* create_simulation( board* b, checkpointer* board_checkpointer, metrics* run_metrics, size_t history_budget,
+                               recorder* board_recorder )
+{
+    simulation *s = calloc( 1, sizeof( simulation ) );
+    if ( !s )
+    {
+        fprintf( stderr, "error creating the simulation of a %d x %d board: no memory\n", b->rows, b->columns );
+        return NULL;
+    }
+    for ( int i = 0; i < 3; i++ )
+    {
+        s->frames[ i ] = create_frame( b );
+        if ( !s->frames[ i ] )
+        {
+            fprintf( stderr, "error creating the simulation of a %d x %d board: no memory for its frames\n", b->rows, b->columns );
+            free_simulation( s );
+            return NULL;
+        }
+        copy_to_frame( b, s->frames[ i ] );
+    }
+    s->b = b;
+    s->board_checkpointer = board_checkpointer;
+    s->run_metrics = run_metrics;
+    s->board_recorder = board_recorder;
+    s->detector = create_cycle_detector( );
+    s->wake = SDL_CreateSemaphore( 0 );
+    if ( !s->detector || !s->wake )
+    {
+        fprintf( stderr, "error creating the simulation of a %d x %d board: %s\n", b->rows, b->columns,
+                 s->wake ? "no memory for the cycle detector" : SDL_GetError( ) );
+        free_simulation( s );
+        return NULL;
+    }
+    // create_board_history reports why it failed, a history that doesn't fit the budget has to be turned off
+    if ( history_budget )
+    {
+        s->history = create_board_history( b, history_budget );
+        if ( !s->history )
+        {
+            fprintf( stderr, "error creating the simulation of a %d x %d board: no history ( --history 0 turns it off )\n",
+                     b->rows, b->columns );
+            free_simulation( s );
+            return NULL;
+        }
+    }
+    // The first generation is remembered and recorded
+    track_board( s );
+    SDL_AtomicSet( &s->paused, TRUE );
+    s->back_frame = 0;
+    SDL_AtomicSet( &s->middle_frame, 1 );
+    s->front_frame = 2;
+    // Without the thread nobody would drain the edit queue
+    s->thread = SDL_CreateThread( simulation_main, "simulation", s );
+    if ( !s->thread )
+    {
+        fprintf( stderr, "error creating the simulation thread: %s\n", SDL_GetError( ) );
+        free_simulation( s );
+        return NULL;
+    }
+    return s;
+}
+
+void destroy_simulation( simulation* s )
+{
+    SDL_AtomicSet( &s->quit, TRUE );
+    SDL_SemPost( s->wake );
+    SDL_WaitThread( s->thread, NULL );
+    free_simulation( s );
+}
+
+void set_simulation_speed( simulation* s, double generations_per_second )
+{
+    double speed = generations_per_second * 1000;
+    SDL_AtomicSet( &s->speed_per_1000_seconds, speed < INT_MAX ? ( int ) speed : INT_MAX );
+    SDL_SemPost( s->wake );
+}
+
+void set_simulation_paused( simulation* s, bool paused )
+{
+    SDL_AtomicSet( &s->paused, paused );
+    SDL_SemPost( s->wake );
+}
+
+void queue_edit( simulation* s, board_edit edit )
+{
+    int written = SDL_AtomicGet( &s->edits_written );
+    // Wait for the simulation to make room, it applies the edits at least every BATCH_TIME_BUDGET_MS
+    while ( written - SDL_AtomicGet( &s->edits_read ) == EDIT_QUEUE_SIZE )
+    {
+        SDL_SemPost( s->wake );
+        SDL_Delay( 1 );
+    }
+    s->edits[ written & ( EDIT_QUEUE_SIZE - 1 ) ] = edit;
+    // The edit is written before the counter tells the simulation about it
+    SDL_AtomicSet( &s->edits_written, written + 1 );
+    SDL_SemPost( s->wake );
+}
+
+void queue_cell_toggle( simulation* s, int x, int y )
+{
+    board_edit edit = { EDIT_TOGGLE_CELL, x, y, NULL, NULL };
+    queue_edit( s, edit );
+}
+
+void queue_board_task( simulation* s, board_task task, void* data )
+{
+    board_edit edit = { EDIT_TASK, 0, 0, task, data };
+    queue_edit( s, edit );
+}
+
+void queue_rewind( simulation* s, int generations )
+{
+    board_edit edit = { EDIT_REWIND, generations, 0, NULL, NULL };
+    queue_edit( s, edit );
+}
+
+board* acquire_frame( simulation* s )
+{
+    if ( SDL_AtomicGet( &s->middle_frame ) & FRESH_FRAME )
+    {
+        s->front_frame = SDL_AtomicSet( &s->middle_frame, s->front_frame ) & ~FRESH_FRAME;
+    }
+    return &s->frames[ s->front_frame ]->cells;
+}
@@ -0,0 +1,74 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "board.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "cycle_detector.h"
+#include "history.h"
+#include "recorder.h"
+
+/*
+ * Runs update_board on its own thread, so the speed of the simulation isn't bound to the refresh rate
+ * and a slow generation doesn't stall the input handling.
+ * Finished generations are published through a lock free triple buffer of frames, copies of the board's cells:
+ * the simulation always has a copy to write, the renderer always has a copy to read and the third one
+ * holds the newest generation that hasn't been picked up yet. A frame that is written again only gets the tiles that
+ * changed since its last copy. Edits are passed to the simulation
+ * through a lock free queue and applied between generations. Once the board has settled into a still life
+ * or an oscillator the generations aren't computed anymore, the board skips ahead to the generation that is due.
+ * The generations can be remembered in a history, so the board can be rewound, and recorded into a GIF, PNGs or a video.
+ */
+typedef struct simulation simulation;
+
+/* Work that has to be done on the board between two generations */
+typedef void ( *board_task )( board* b, void* data );
+
+
+/**
+* Start simulating the board on a new thread. The simulation owns the board until it is destroyed.
+* If board_checkpointer isn't NULL the board is checkpointed after the updates, if run_metrics isn't NULL
+* every generation is recorded in it. The last generations are remembered in up to history_budget bytes,
+* 0 doesn't remember any. If board_recorder isn't NULL the generations are recorded into it. The simulation starts paused.
+* Prints an error and returns NULL if the frames, the cycle detector, the history or the thread can't be created.
+*/
+simulation* create_simulation( board* b, checkpointer* board_checkpointer, metrics* run_metrics, size_t history_budget,
+                               recorder* board_recorder );
+
+/**
+* Stop the simulation thread after the edits in the queue are applied. The board belongs to the caller again.
+*/
+void destroy_simulation( simulation* s );
+
+/**
+* Set the number of generations per second the simulation tries to reach.
+*/
+void set_simulation_speed( simulation* s, double generations_per_second );
+
+/**
+* Pause or resume the simulation. Edits are still applied while it is paused.
+*/
+void set_simulation_paused( simulation* s, bool paused );
+
+/**
+* Queue a toggle_cell_state of the cell at x, y.
+*/
+void queue_cell_toggle( simulation* s, int x, int y );
+
+/**
+* Queue a call of task with the board and data.
+*/
+void queue_board_task( simulation* s, board_task task, void* data );
+
+/**
+* Queue a rewind of the board by the given number of generations, as far as the history reaches back.
+*/
+void queue_rewind( simulation* s, int generations );
+
+/**
+* Return a copy of the newest published generation. The copy may only be read and stays valid until the next call.
+* It only has the board's size, grid, living cells, generation and density pyramid, it can't be updated.
+*/
+board* acquire_frame( simulation* s );
+
+#endif
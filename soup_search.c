@@ -0,0 +1,495 @@
+#include "soup_search.h"
+#include "cycle_detector.h"
+#include "page_arena.h"
+#include "random_generator.h"
+
+#define DEFAULT_SOUP_COUNT 10000
+#define DEFAULT_SOUP_BOARD_SIZE 128
+#define DEFAULT_SOUP_SIZE 16
+#define DEFAULT_SOUP_DENSITY 0.5
+#define DEFAULT_SOUP_GENERATIONS 10000
+
+#define SOUP_FILE_MAGIC "LIFESOUP"
+#define SOUP_FILE_VERSION 1
+
+/*
+ * The result file is this header followed by one soup_result per soup in the order of the seeds,
+ * in the byte order of the machine that wrote it like the checkpoints.
+ */
+typedef struct
+{
+    char magic[ 8 ];
+    Uint32 version;
+    // The offset of the first result in the file
+    Uint32 header_size;
+    Uint32 result_size;
+    Sint32 rows;
+    Sint32 columns;
+    Sint32 soup_size;
+    Sint32 generations;
+    Uint32 boundary;
+    double density;
+    Uint64 first_seed;
+    Uint64 count;
+    char rule[ LIFE_RULE_STRING_SIZE ];
+} soup_file_header;
+
+/* The soups a worker thread runs and the board it runs them on */
+typedef struct
+{
+    // The soups next to end - 1 haven't been started. The owner takes them from the front,
+    // other workers steal them from the back. Guarded by lock.
+    SDL_SpinLock lock;
+    int next;
+    int end;
+    board *b;
+    cycle_detector *detector;
+    // One row of random cells
+    cell_word *soup_row;
+    // Keeps the ranges of neighboring workers out of each other's cache lines
+    char padding[ 64 ];
+} soup_worker;
+
+typedef struct
+{
+    const soup_settings *settings;
+    Uint32 density;
+    Uint64 first_seed;
+    soup_result *results;
+    int worker_count;
+    soup_worker *workers;
+} soup_search;
+
+typedef struct
+{
+    soup_settings settings;
+    Uint64 seed;
+    int count;
+    int threads;
+    // The results are written to this file, NULL if there is none
+    const char *output_path;
+} soup_search_options;
+
+/* Returns the next soup of the worker's own range, -1 if it is empty */
+int take_soup( soup_worker *w )
+{
+    int soup = -1;
+    SDL_AtomicLock( &w->lock );
+    if ( w->next < w->end )
+    {
+        soup = w->next++;
+    }
+    SDL_AtomicUnlock( &w->lock );
+    return soup;
+}
+
+/*
+ * Moves the back half of the fullest range of the other workers into the thief's empty range and returns its
+ * first soup, -1 once every range is empty.
+ */
+int steal_soups( soup_search *s, soup_worker *thief )
+{
+    for ( ;; )
+    {
+        // The sizes are read without the locks, they only pick the range to try
+        soup_worker *victim = NULL;
+        int most_left = 0;
+        for ( int i = 0; i < s->worker_count; i++ )
+        {
+            int left = s->workers[ i ].end - s->workers[ i ].next;
+            if ( left > most_left )
+            {
+                most_left = left;
+                victim = &s->workers[ i ];
+            }
+        }
+        if ( !victim )
+        {
+            return -1;
+        }
+
+        int first = -1;
+        int end = 0;
+        SDL_AtomicLock( &victim->lock );
+        int left = victim->end - victim->next;
+        if ( left > 0 )
+        {
+            end = victim->end;
+            first = end - ( left + 1 ) / 2;
+            victim->end = first;
+        }
+        SDL_AtomicUnlock( &victim->lock );
+        // Another worker got there first, try again
+        if ( first < 0 )
+        {
+            continue;
+        }
+        SDL_AtomicLock( &thief->lock );
+        thief->next = first + 1;
+        thief->end = end;
+        SDL_AtomicUnlock( &thief->lock );
+        return first;
+    }
+}
+
+/* Fills the worker's board with the soup and updates it until it settles or reaches the generation limit */
+void run_soup( soup_search *s, soup_worker *w, int soup )
+{
+    const soup_settings *settings = s->settings;
+    board *b = w->b;
+    kill_all_cells( b );
+    int x = ( settings->columns - settings->soup_size ) / 2;
+    int y = ( settings->rows - settings->soup_size ) / 2;
+    int words = ( settings->soup_size + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    for ( int row = 0; row < settings->soup_size; row++ )
+    {
+        // Every row has its own stream like the rows of fill_board_random
+        random_generator g;
+        seed_generator( &g, s->first_seed + soup, ( Uint64 ) row );
+        for ( int word = 0; word < words; word++ )
+        {
+            w->soup_row[ word ] = random_cell_word( &g, s->density );
+        }
+        w->soup_row[ words - 1 ] &= last_word_mask( settings->soup_size );
+        write_board_row( b, x, y + row, settings->soup_size, w->soup_row );
+    }
+    b->generation = 0;
+
+    // The board was edited, so the detector's history starts over with the soup
+    Uint64 period = observe_generation( w->detector, b );
+    while ( !period && b->generation < ( Uint64 ) settings->generations )
+    {
+        update_board( b );
+        period = observe_generation( w->detector, b );
+    }
+    soup_result *result = &s->results[ soup ];
+    result->population = ( Uint32 ) b->living_cells;
+    result->generation = ( Uint32 ) ( period ? cycle_start( w->detector ) : b->generation );
+    result->period = ( Uint32 ) period;
+}
+
+void search_soups_task( void* data, int worker_index )
+{
+    soup_search *s = data;
+    soup_worker *w = &s->workers[ worker_index ];
+    for ( ;; )
+    {
+        int soup = take_soup( w );
+        if ( soup < 0 )
+        {
+            soup = steal_soups( s, w );
+        }
+        if ( soup < 0 )
+        {
+            break;
+        }
+        run_soup( s, w, soup );
+    }
+}
+
+/* Frees the workers and whatever was allocated for them, their boards' arena is left alone */
+void free_soup_workers( soup_search *s )
+{
+    for ( int i = 0; s->workers && i < s->worker_count; i++ )
+    {
+        if ( s->workers[ i ].b )
+        {
+            free_board( s->workers[ i ].b );
+        }
+        destroy_cycle_detector( s->workers[ i ].detector );
+        free( s->workers[ i ].soup_row );
+    }
+    free( s->workers );
+}
+
+bool search_soups( const soup_settings* settings, Uint64 first_seed, int count, int thread_count, soup_result* results )
+{
+    soup_search s = { settings, density_to_fixed( settings->density ), first_seed, results, 0, NULL };
+    if ( count <= 0 )
+    {
+        return TRUE;
+    }
+    s.worker_count = thread_count < 1 ? 1 : thread_count > count ? count : thread_count;
+
+    // The boards of all workers are placed next to each other in one arena
+    Uint64 board_size = board_arena_size( settings->rows, settings->columns );
+    page_arena *arena = create_page_arena( ( size_t ) ( board_size * s.worker_count ) );
+    if ( !arena )
+    {
+        return FALSE;
+    }
+    s.workers = calloc( s.worker_count, sizeof( soup_worker ) );
+    bool allocated = s.workers != NULL;
+    for ( int i = 0; allocated && i < s.worker_count; i++ )
+    {
+        soup_worker *w = &s.workers[ i ];
+        // The soups are split evenly, stealing evens out the ones that take longer
+        w->next = ( int ) ( ( Sint64 ) count * i / s.worker_count );
+        w->end = ( int ) ( ( Sint64 ) count * ( i + 1 ) / s.worker_count );
+        w->b = place_board( arena, settings->rows, settings->columns );
+        w->detector = create_cycle_detector( );
+        w->soup_row = calloc( ( settings->soup_size + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD, sizeof( cell_word ) );
+        allocated = w->b && w->detector && w->soup_row;
+        if ( w->b )
+        {
+            set_board_rule( w->b, settings->rule );
+            set_board_boundary( w->b, settings->boundary );
+        }
+    }
+    // Every soup needs a worker, the search isn't started with fewer of them
+    if ( !allocated )
+    {
+        fprintf( stderr, "error allocating the %d workers of the soup search\n", s.worker_count );
+        free_soup_workers( &s );
+        destroy_page_arena( arena );
+        return FALSE;
+    }
+
+    thread_pool *pool = s.worker_count > 1 ? create_thread_pool( s.worker_count ) : NULL;
+    if ( pool )
+    {
+        run_tasks( pool, search_soups_task, &s, s.worker_count );
+        destroy_thread_pool( pool );
+    }
+    else
+    {
+        // Without threads the first worker steals every other range
+        search_soups_task( &s, 0 );
+    }
+
+    free_soup_workers( &s );
+    destroy_page_arena( arena );
+    return TRUE;
+}
+
+bool write_soup_file( const char *path, const soup_search_options *options, const soup_result *results )
+{
+    soup_file_header header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, SOUP_FILE_MAGIC, sizeof( header.magic ) );
+    header.version = SOUP_FILE_VERSION;
+    header.header_size = sizeof( soup_file_header );
+    header.result_size = sizeof( soup_result );
+    header.rows = options->settings.rows;
+    header.columns = options->settings.columns;
+    header.soup_size = options->settings.soup_size;
+    header.generations = options->settings.generations;
+    header.boundary = options->settings.boundary;
+    header.density = options->settings.density;
+    header.first_seed = options->seed;
+    header.count = ( Uint64 ) options->count;
+    format_life_rule( &options->settings.rule, header.rule );
+
+    FILE *file = fopen( path, "wb" );
+    if ( !file )
+    {
+        fprintf( stderr, "error creating %s\n", path );
+        return FALSE;
+    }
+    bool written = fwrite( &header, sizeof( header ), 1, file ) == 1 &&
+                   fwrite( results, sizeof( soup_result ), options->count, file ) == ( size_t ) options->count;
+    written = !fclose( file ) && written;
+    if ( !written )
+    {
+        fprintf( stderr, "error writing %s\n", path );
+    }
+    return written;
+}
+
+void print_soup_search_usage( void )
+{
+    fprintf( stderr,
+        "usage: --soups [option value]...\n"
+        "    --count n         Soups to run (default %d)\n"
+        "    --seed n          Seed of the first soup, the others have the following seeds (default %llu)\n"
+        "    --rows n          Rows of the board every soup grows on (default %d)\n"
+        "    --columns n       Columns of the board every soup grows on (default %d)\n"
+        "    --soup-size n     Width and height of the square of random cells in the middle of the board (default %d)\n"
+        "    --density f       Fraction of living cells in the square (default %.2f)\n"
+        "    --generations n   Give up on soups that haven't settled after n generations (default %d)\n"
+        "    --threads n       Threads that run soups (default: the number of CPUs)\n"
+        "    --boundary mode   What the edge cells see beyond the edges: dead, torus or klein (default dead)\n"
+        "    --rule rulestring The Life-like rule in B/S notation (default B3/S23)\n"
+        "    --output file     Write every soup's final population, settling generation and period to the file\n",
+        DEFAULT_SOUP_COUNT, ( unsigned long long ) DEFAULT_RANDOM_SEED, DEFAULT_SOUP_BOARD_SIZE, DEFAULT_SOUP_BOARD_SIZE,
+        DEFAULT_SOUP_SIZE, DEFAULT_SOUP_DENSITY, DEFAULT_SOUP_GENERATIONS );
+}
+
+/* Fills options from the command line, returns FALSE if an option is unknown or has an invalid value */
+bool parse_soup_search_options( int argc, char** argv, soup_search_options *options )
+{
+    options->settings.rows = DEFAULT_SOUP_BOARD_SIZE;
+    options->settings.columns = DEFAULT_SOUP_BOARD_SIZE;
+    options->settings.soup_size = DEFAULT_SOUP_SIZE;
+    options->settings.density = DEFAULT_SOUP_DENSITY;
+    options->settings.generations = DEFAULT_SOUP_GENERATIONS;
+    options->settings.rule = conway_rule( );
+    options->settings.boundary = BOUNDARY_DEAD;
+    options->seed = DEFAULT_RANDOM_SEED;
+    options->count = DEFAULT_SOUP_COUNT;
+    options->threads = SDL_GetCPUCount( );
+    options->output_path = NULL;
+
+    // Every option takes a value
+    if ( argc % 2 )
+    {
+        fprintf( stderr, "missing value for %s\n", argv[ argc - 1 ] );
+        return FALSE;
+    }
+    for ( int i = 0; i < argc; i += 2 )
+    {
+        const char *name = argv[ i ];
+        const char *value = argv[ i + 1 ];
+        if ( strcmp( name, "--count" ) == 0 )
+        {
+            options->count = atoi( value );
+        }
+        else if ( strcmp( name, "--seed" ) == 0 )
+        {
+            options->seed = strtoull( value, NULL, 10 );
+        }
+        else if ( strcmp( name, "--rows" ) == 0 )
+        {
+            options->settings.rows = atoi( value );
+        }
+        else if ( strcmp( name, "--columns" ) == 0 )
+        {
+            options->settings.columns = atoi( value );
+        }
+        else if ( strcmp( name, "--soup-size" ) == 0 )
+        {
+            options->settings.soup_size = atoi( value );
+        }
+        else if ( strcmp( name, "--density" ) == 0 )
+        {
+            options->settings.density = atof( value );
+        }
+        else if ( strcmp( name, "--generations" ) == 0 )
+        {
+            options->settings.generations = atoi( value );
+        }
+        else if ( strcmp( name, "--threads" ) == 0 )
+        {
+            options->threads = atoi( value );
+        }
+        else if ( strcmp( name, "--output" ) == 0 )
+        {
+            options->output_path = value;
+        }
+        else if ( strcmp( name, "--rule" ) == 0 )
+        {
+            if ( !parse_life_rule( value, &options->settings.rule ) )
+            {
+                fprintf( stderr, "invalid or unsupported ( B0 ) rule: %s\n", value );
+                return FALSE;
+            }
+        }
+        else if ( strcmp( name, "--boundary" ) == 0 )
+        {
+            if ( !boundary_mode_from_name( value, &options->settings.boundary ) )
+            {
+                fprintf( stderr, "unknown boundary mode: %s\n", value );
+                return FALSE;
+            }
+        }
+        else
+        {
+            fprintf( stderr, "unknown option: %s\n", name );
+            return FALSE;
+        }
+    }
+
+    const soup_settings *settings = &options->settings;
+    if ( options->count <= 0 || options->threads <= 0 || settings->generations < 0 )
+    {
+        fprintf( stderr, "count and threads must be positive and generations can't be negative\n" );
+        return FALSE;
+    }
+    // The results count the population in 32 bits
+    if ( settings->rows <= 0 || settings->columns <= 0 || ( Sint64 ) settings->rows * settings->columns > 0x7fffffff )
+    {
+        fprintf( stderr, "rows and columns must be positive and the board can't have more than 2^31 cells\n" );
+        return FALSE;
+    }
+    if ( settings->soup_size <= 0 || settings->soup_size > settings->rows || settings->soup_size > settings->columns )
+    {
+        fprintf( stderr, "the soup has to fit into the board\n" );
+        return FALSE;
+    }
+    if ( settings->density < 0 || settings->density > 1 )
+    {
+        fprintf( stderr, "density must be between 0 and 1\n" );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int run_soup_search( int argc, char** argv )
+{
+    soup_search_options options;
+    if ( !parse_soup_search_options( argc, argv, &options ) )
+    {
+        print_soup_search_usage( );
+        return EXIT_FAILURE;
+    }
+
+    soup_result *results = calloc( options.count, sizeof( soup_result ) );
+    if ( !results )
+    {
+        fprintf( stderr, "error allocating the results of %d soups\n", options.count );
+        return EXIT_FAILURE;
+    }
+    Uint64 start = SDL_GetPerformanceCounter( );
+    if ( !search_soups( &options.settings, options.seed, options.count, options.threads, results ) )
+    {
+        free( results );
+        return EXIT_FAILURE;
+    }
+    double seconds = ( double ) ( SDL_GetPerformanceCounter( ) - start ) / SDL_GetPerformanceFrequency( );
+    bool written = !options.output_path || write_soup_file( options.output_path, &options, results );
+
+    int settled = 0;
+    int still_lifes = 0;
+    int period_2 = 0;
+    Uint64 settled_generations = 0;
+    int longest = -1;
+    for ( int i = 0; i < options.count; i++ )
+    {
+        if ( !results[ i ].period )
+        {
+            continue;
+        }
+        settled++;
+        still_lifes += results[ i ].period == 1;
+        period_2 += results[ i ].period == 2;
+        settled_generations += results[ i ].generation;
+        if ( longest < 0 || results[ i ].generation > results[ longest ].generation )
+        {
+            longest = i;
+        }
+    }
+
+    const soup_settings *settings = &options.settings;
+    char rule[ LIFE_RULE_STRING_SIZE ];
+    format_life_rule( &settings->rule, rule );
+    printf( "soups:              %d ( seeds %llu to %llu )\n", options.count, ( unsigned long long ) options.seed,
+            ( unsigned long long ) ( options.seed + options.count - 1 ) );
+    printf( "board:              %d x %d cells, %d x %d soup at density %.2f\n", settings->rows, settings->columns,
+            settings->soup_size, settings->soup_size, settings->density );
+    printf( "rule:               %s\n", rule );
+    printf( "boundary:           %s\n", boundary_mode_name( settings->boundary ) );
+    printf( "threads:            %d\n", options.threads < options.count ? options.threads : options.count );
+    printf( "settled:            %d ( %d still lifes, %d period 2, %d longer periods ), %d not within %d generations\n",
+            settled, still_lifes, period_2, settled - still_lifes - period_2, options.count - settled, settings->generations );
+    if ( settled )
+    {
+        printf( "mean settling gen:  %.1f\n", ( double ) settled_generations / settled );
+        printf( "longest-lived:      seed %llu settled at generation %u with %u cells\n",
+                ( unsigned long long ) ( options.seed + longest ), results[ longest ].generation, results[ longest ].population );
+    }
+    printf( "seconds:            %.3f\n", seconds );
+    printf( "soups/sec:          %.1f\n", seconds > 0 ? options.count / seconds : 0 );
+
+    free( results );
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,51 @@
+#ifndef SOUP_SEARCH_H
+#define SOUP_SEARCH_H
+
+#include "board.h"
+
+/*
+ * Runs many independent random soups and records what each of them settles into. Every soup is a square of random
+ * cells in the middle of an otherwise dead board. It is updated until it has become a still life or an oscillator, or
+ * until the generation limit, and its final population, the generation it settled in and its period are recorded.
+ * Soups take very different numbers of generations, so every worker thread owns a range of soups and a worker that
+ * runs out of soups steals half of the soups left in the fullest range.
+ */
+
+/* What a soup settled into */
+typedef struct
+{
+    Uint32 population;
+    // The first generation of the still life or oscillator, or the generation limit if the soup didn't settle
+    Uint32 generation;
+    // The period of the still life ( 1 ) or oscillator, 0 if the soup didn't settle within the generation limit
+    Uint32 period;
+} soup_result;
+
+typedef struct
+{
+    // The size of the boards the soups grow on, and of the square of random cells in their middle
+    int rows;
+    int columns;
+    int soup_size;
+    double density;
+    // Soups that haven't settled after this many generations are given up
+    int generations;
+    life_rule rule;
+    boundary_mode boundary;
+} soup_settings;
+
+
+/**
+* Run count soups with the seeds first_seed to first_seed + count - 1 on thread_count threads and write their results
+* into results, in the order of the seeds. A soup's cells only depend on its seed and the settings, not on the threads.
+* Prints an error and returns FALSE if the workers or their boards can't be allocated.
+*/
+bool search_soups( const soup_settings* settings, Uint64 first_seed, int count, int thread_count, soup_result* results );
+
+/**
+* Run the options that follow --soups on the command line ( argc and argv don't include the program name and --soups ).
+* Prints the usage and fails on unknown options. Returns the program's exit code.
+*/
+int run_soup_search( int argc, char** argv );
+
+#endif
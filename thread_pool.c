@@ -0,0 +1,144 @@
+#include "thread_pool.h"
+
+struct thread_pool
+{
+    int thread_count;
+    SDL_Thread **threads;
+
+    // Everything below the lock is guarded by it, except next_task
+    SDL_mutex *lock;
+    SDL_cond *work_ready;
+    SDL_cond *work_done;
+    // Incremented for every call to run_tasks so the workers know that there is new work
+    int batch;
+    int busy_workers;
+    int quit;
+    pool_task task;
+    void *data;
+    int task_count;
+
+    SDL_atomic_t next_task;
+};
+
+/* Run tasks until all tasks of the current batch are taken */
+void work_on_tasks( thread_pool *pool )
+{
+    int task_index;
+    while ( ( task_index = SDL_AtomicAdd( &pool->next_task, 1 ) ) < pool->task_count )
+    {
+        pool->task( pool->data, task_index );
+    }
+}
+
+int worker_main( void *data )
+{
+    thread_pool *pool = data;
+    // Start at the batch the pool was created with, run_tasks may already have been called
+    int seen_batch = 0;
+    SDL_LockMutex( pool->lock );
+    for ( ;; )
+    {
+        while ( pool->batch == seen_batch && !pool->quit )
+        {
+            SDL_CondWait( pool->work_ready, pool->lock );
+        }
+        if ( pool->quit )
+        {
+            break;
+        }
+        seen_batch = pool->batch;
+        SDL_UnlockMutex( pool->lock );
+
+        work_on_tasks( pool );
+
+        SDL_LockMutex( pool->lock );
+        if ( --pool->busy_workers == 0 )
+        {
+            SDL_CondSignal( pool->work_done );
+        }
+    }
+    SDL_UnlockMutex( pool->lock );
+    return 0;
+}
+
+thread_pool* create_thread_pool( int thread_count )
+{
+    thread_pool *pool = calloc( 1, sizeof( thread_pool ) );
+    pool->thread_count = thread_count > 1 ? thread_count : 1;
+    pool->threads = calloc( pool->thread_count, sizeof( SDL_Thread* ) );
+    pool->lock = SDL_CreateMutex( );
+    pool->work_ready = SDL_CreateCond( );
+    pool->work_done = SDL_CreateCond( );
+    if ( !pool->threads || !pool->lock || !pool->work_ready || !pool->work_done )
+    {
+        destroy_thread_pool( pool );
+        return NULL;
+    }
+
+    // The first thread is the one calling run_tasks
+    for ( int i = 1; i < pool->thread_count; i++ )
+    {
+        pool->threads[ i ] = SDL_CreateThread( worker_main, "life worker", pool );
+        if ( !pool->threads[ i ] )
+        {
+            fprintf( stderr, "error creating worker thread: %s\n", SDL_GetError( ) );
+            destroy_thread_pool( pool );
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void run_tasks( thread_pool* pool, pool_task task, void* data, int task_count )
+{
+    SDL_LockMutex( pool->lock );
+    pool->task = task;
+    pool->data = data;
+    pool->task_count = task_count;
+    SDL_AtomicSet( &pool->next_task, 0 );
+    pool->busy_workers = pool->thread_count - 1;
+    pool->batch++;
+    SDL_CondBroadcast( pool->work_ready );
+    SDL_UnlockMutex( pool->lock );
+
+    work_on_tasks( pool );
+
+    SDL_LockMutex( pool->lock );
+    while ( pool->busy_workers > 0 )
+    {
+        SDL_CondWait( pool->work_done, pool->lock );
+    }
+    SDL_UnlockMutex( pool->lock );
+}
+
+int pool_thread_count( thread_pool* pool )
+{
+    return pool ? pool->thread_count : 1;
+}
+
+void destroy_thread_pool( thread_pool* pool )
+{
+    if ( !pool )
+    {
+        return;
+    }
+    if ( pool->lock )
+    {
+        SDL_LockMutex( pool->lock );
+        pool->quit = 1;
+        SDL_CondBroadcast( pool->work_ready );
+        SDL_UnlockMutex( pool->lock );
+    }
+    if ( pool->threads )
+    {
+        for ( int i = 1; i < pool->thread_count; i++ )
+        {
+            SDL_WaitThread( pool->threads[ i ], NULL );
+        }
+    }
+    SDL_DestroyCond( pool->work_done );
+    SDL_DestroyCond( pool->work_ready );
+    SDL_DestroyMutex( pool->lock );
+    free( pool->threads );
+    free( pool );
+}
@@ -0,0 +1,35 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "SDL.h"
+
+/* A task gets the data passed to run_tasks and the index of the task ( 0 to task_count-1 ) */
+typedef void ( *pool_task )( void* data, int task_index );
+
+typedef struct thread_pool thread_pool;
+
+
+/**
+* Create a pool of worker threads. The thread calling run_tasks counts as one of
+* the thread_count threads, so thread_count - 1 threads are started.
+* Returns NULL if the threads can't be created.
+*/
+thread_pool* create_thread_pool( int thread_count );
+
+/**
+* Run task_count tasks on the pool and wait until all of them are finished.
+* The tasks are handed out to the threads one at a time, so tasks may take different amounts of time.
+*/
+void run_tasks( thread_pool* pool, pool_task task, void* data, int task_count );
+
+/**
+* Return the number of threads of the pool including the calling thread.
+*/
+int pool_thread_count( thread_pool* pool );
+
+/**
+* Stop all threads of the pool and free it.
+*/
+void destroy_thread_pool( thread_pool* pool );
+
+#endif
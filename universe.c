@@ -0,0 +1,373 @@
+#include "universe.h"
+
+#define INITIAL_BUCKET_COUNT 1024
+
+typedef struct universe_chunk
+{
+    // The chunk's position in chunks, its top left cell is x * CHUNK_SIZE, y * CHUNK_SIZE
+    Sint64 x;
+    Sint64 y;
+    struct universe_chunk *next_in_bucket;
+    // The chunk's position in the universe's list of chunks
+    int index;
+    int population;
+    // One word per row. The universe's current field selects the current generation.
+    cell_word cells[ 2 ][ CHUNK_SIZE ];
+} universe_chunk;
+
+struct universe
+{
+    universe_chunk **buckets;
+    int bucket_count;
+    universe_chunk **chunks;
+    int chunk_count;
+    int chunk_capacity;
+    int current;
+    Uint64 population;
+    // The cells that were born and died in the last update
+    Uint64 births;
+    Uint64 deaths;
+    life_rule rule;
+};
+
+// The cells of chunks that don't exist
+const cell_word EMPTY_CHUNK_ROWS[ CHUNK_SIZE ] = { 0 };
+
+/* Rounds towards negative infinity, unlike the / operator */
+static inline Sint64 chunk_coordinate( Sint64 cell_coordinate )
+{
+    Sint64 chunk = cell_coordinate / CHUNK_SIZE;
+    return cell_coordinate % CHUNK_SIZE < 0 ? chunk - 1 : chunk;
+}
+
+static inline int chunk_bucket( universe *u, Sint64 x, Sint64 y )
+{
+    Uint64 hash = ( Uint64 ) x * 0x9e3779b97f4a7c15ULL ^ ( Uint64 ) y * 0xc2b2ae3d27d4eb4fULL;
+    return ( int ) ( ( hash ^ ( hash >> 32 ) ) & ( Uint64 ) ( u->bucket_count - 1 ) );
+}
+
+universe_chunk* find_chunk( universe *u, Sint64 x, Sint64 y )
+{
+    for ( universe_chunk *c = u->buckets[ chunk_bucket( u, x, y ) ]; c; c = c->next_in_bucket )
+    {
+        if ( c->x == x && c->y == y )
+        {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+/* Doubles the buckets, without memory for them the chains of the old ones just get longer */
+void grow_chunk_table( universe *u )
+{
+    universe_chunk **buckets = calloc( 2 * ( size_t ) u->bucket_count, sizeof( universe_chunk* ) );
+    if ( !buckets )
+    {
+        return;
+    }
+    free( u->buckets );
+    u->bucket_count *= 2;
+    u->buckets = buckets;
+    for ( int i = 0; i < u->chunk_count; i++ )
+    {
+        universe_chunk *c = u->chunks[ i ];
+        int bucket = chunk_bucket( u, c->x, c->y );
+        c->next_in_bucket = u->buckets[ bucket ];
+        u->buckets[ bucket ] = c;
+    }
+}
+
+/* Returns the chunk at x, y and allocates an empty one if there is none. Prints an error and returns NULL without memory for it. */
+universe_chunk* add_chunk( universe *u, Sint64 x, Sint64 y )
+{
+    universe_chunk *c = find_chunk( u, x, y );
+    if ( c )
+    {
+        return c;
+    }
+    if ( u->chunk_count == u->chunk_capacity )
+    {
+        int capacity = u->chunk_capacity ? u->chunk_capacity * 2 : 64;
+        universe_chunk **chunks = realloc( u->chunks, capacity * sizeof( universe_chunk* ) );
+        if ( !chunks )
+        {
+            fprintf( stderr, "error allocating the chunk at %lld, %lld: no memory for %d chunks\n", ( long long ) x, ( long long ) y, capacity );
+            return NULL;
+        }
+        u->chunks = chunks;
+        u->chunk_capacity = capacity;
+    }
+    c = calloc( 1, sizeof( universe_chunk ) );
+    if ( !c )
+    {
+        fprintf( stderr, "error allocating the chunk at %lld, %lld\n", ( long long ) x, ( long long ) y );
+        return NULL;
+    }
+    c->x = x;
+    c->y = y;
+    c->index = u->chunk_count;
+    u->chunks[ u->chunk_count++ ] = c;
+    int bucket = chunk_bucket( u, x, y );
+    c->next_in_bucket = u->buckets[ bucket ];
+    u->buckets[ bucket ] = c;
+    if ( u->chunk_count > u->bucket_count )
+    {
+        grow_chunk_table( u );
+    }
+    return c;
+}
+
+void remove_chunk( universe *u, universe_chunk *c )
+{
+    universe_chunk **link = &u->buckets[ chunk_bucket( u, c->x, c->y ) ];
+    while ( *link != c )
+    {
+        link = &( *link )->next_in_bucket;
+    }
+    *link = c->next_in_bucket;
+
+    // Move the last chunk into the gap
+    universe_chunk *last = u->chunks[ --u->chunk_count ];
+    u->chunks[ c->index ] = last;
+    last->index = c->index;
+    free( c );
+}
+
+universe* create_universe( void )
+{
+    universe *u = calloc( 1, sizeof( universe ) );
+    if ( u )
+    {
+        u->bucket_count = INITIAL_BUCKET_COUNT;
+        u->buckets = calloc( u->bucket_count, sizeof( universe_chunk* ) );
+    }
+    if ( !u || !u->buckets )
+    {
+        fprintf( stderr, "error creating the universe\n" );
+        free( u );
+        return NULL;
+    }
+    u->rule = conway_rule( );
+    return u;
+}
+
+void set_universe_rule( universe* u, life_rule rule )
+{
+    u->rule = rule;
+}
+
+void universe_kill_all_cells( universe* u )
+{
+    while ( u->chunk_count )
+    {
+        remove_chunk( u, u->chunks[ u->chunk_count - 1 ] );
+    }
+    u->population = 0;
+}
+
+void destroy_universe( universe* u )
+{
+    universe_kill_all_cells( u );
+    free( u->chunks );
+    free( u->buckets );
+    free( u );
+}
+
+/* Returns the current rows of a chunk or empty rows if the chunk doesn't exist */
+static inline const cell_word* chunk_rows( universe *u, universe_chunk *c )
+{
+    return c ? c->cells[ u->current ] : EMPTY_CHUNK_ROWS;
+}
+
+/* Allocates the neighbors of the chunk that living cells at its edges can give birth to cells in, returns FALSE if one can't be */
+bool add_neighbor_chunks( universe *u, universe_chunk *c )
+{
+    const cell_word *rows = c->cells[ u->current ];
+    cell_word top = rows[ 0 ];
+    cell_word bottom = rows[ CHUNK_SIZE - 1 ];
+    cell_word all_rows = 0;
+    for ( int y = 0; y < CHUNK_SIZE; y++ )
+    {
+        all_rows |= rows[ y ];
+    }
+    const cell_word west_edge = 1;
+    const cell_word east_edge = ( cell_word ) 1 << ( CELLS_PER_WORD - 1 );
+    Sint64 x = c->x;
+    Sint64 y = c->y;
+
+    bool added = TRUE;
+    if ( top )                   { added &= add_chunk( u, x, y - 1 ) != NULL; }
+    if ( bottom )                { added &= add_chunk( u, x, y + 1 ) != NULL; }
+    if ( all_rows & west_edge )  { added &= add_chunk( u, x - 1, y ) != NULL; }
+    if ( all_rows & east_edge )  { added &= add_chunk( u, x + 1, y ) != NULL; }
+    if ( top & west_edge )       { added &= add_chunk( u, x - 1, y - 1 ) != NULL; }
+    if ( top & east_edge )       { added &= add_chunk( u, x + 1, y - 1 ) != NULL; }
+    if ( bottom & west_edge )    { added &= add_chunk( u, x - 1, y + 1 ) != NULL; }
+    if ( bottom & east_edge )    { added &= add_chunk( u, x + 1, y + 1 ) != NULL; }
+    return added;
+}
+
+/* Writes the next state of the chunk into its other generation, returns the number of born cells */
+int update_chunk( universe *u, universe_chunk *c )
+{
+    const cell_word *center = c->cells[ u->current ];
+    const cell_word *n  = chunk_rows( u, find_chunk( u, c->x, c->y - 1 ) );
+    const cell_word *s  = chunk_rows( u, find_chunk( u, c->x, c->y + 1 ) );
+    const cell_word *w  = chunk_rows( u, find_chunk( u, c->x - 1, c->y ) );
+    const cell_word *e  = chunk_rows( u, find_chunk( u, c->x + 1, c->y ) );
+    const cell_word *nw = chunk_rows( u, find_chunk( u, c->x - 1, c->y - 1 ) );
+    const cell_word *ne = chunk_rows( u, find_chunk( u, c->x + 1, c->y - 1 ) );
+    const cell_word *sw = chunk_rows( u, find_chunk( u, c->x - 1, c->y + 1 ) );
+    const cell_word *se = chunk_rows( u, find_chunk( u, c->x + 1, c->y + 1 ) );
+    cell_word *next = c->cells[ !u->current ];
+
+    c->population = 0;
+    int births = 0;
+    for ( int y = 0; y < CHUNK_SIZE; y++ )
+    {
+        // The rows above and below the chunk's first and last row come from the chunks to the north and south
+        bool first = y == 0;
+        bool last = y == CHUNK_SIZE - 1;
+        cell_word above_w = first ? nw[ CHUNK_SIZE - 1 ] : w[ y - 1 ];
+        cell_word above   = first ? n[ CHUNK_SIZE - 1 ]  : center[ y - 1 ];
+        cell_word above_e = first ? ne[ CHUNK_SIZE - 1 ] : e[ y - 1 ];
+        cell_word below_w = last ? sw[ 0 ] : w[ y + 1 ];
+        cell_word below   = last ? s[ 0 ]  : center[ y + 1 ];
+        cell_word below_e = last ? se[ 0 ] : e[ y + 1 ];
+
+        next[ y ] = next_rule_word( above_w, above, above_e,
+                                    w[ y ], center[ y ], e[ y ],
+                                    below_w, below, below_e, u->rule.birth, u->rule.survival );
+        c->population += popcount64( next[ y ] );
+        births += popcount64( next[ y ] & ~center[ y ] );
+    }
+    return births;
+}
+
+bool update_universe( universe* u )
+{
+    // Cells born into a missing chunk would be lost, so the step isn't taken at all. The empty chunks that were added are
+    // updated and freed by the next step.
+    int chunk_count = u->chunk_count;
+    for ( int i = 0; i < chunk_count; i++ )
+    {
+        if ( !add_neighbor_chunks( u, u->chunks[ i ] ) )
+        {
+            fprintf( stderr, "error updating the universe: no memory for the chunks its cells grow into\n" );
+            return FALSE;
+        }
+    }
+
+    Uint64 population = u->population;
+    u->population = 0;
+    u->births = 0;
+    for ( int i = 0; i < u->chunk_count; i++ )
+    {
+        u->births += update_chunk( u, u->chunks[ i ] );
+        u->population += u->chunks[ i ]->population;
+    }
+    u->deaths = u->births + population - u->population;
+    u->current = !u->current;
+
+    // Free the chunks that died out, they are allocated again if cells get close to them
+    for ( int i = u->chunk_count - 1; i >= 0; i-- )
+    {
+        if ( u->chunks[ i ]->population == 0 )
+        {
+            remove_chunk( u, u->chunks[ i ] );
+        }
+    }
+    return TRUE;
+}
+
+bool universe_cell_state( Sint64 x, Sint64 y, universe* u )
+{
+    Sint64 chunk_x = chunk_coordinate( x );
+    Sint64 chunk_y = chunk_coordinate( y );
+    const cell_word *rows = chunk_rows( u, find_chunk( u, chunk_x, chunk_y ) );
+    return ( rows[ y - chunk_y * CHUNK_SIZE ] >> ( x - chunk_x * CHUNK_SIZE ) ) & 1;
+}
+
+bool universe_toggle_cell_state( Sint64 x, Sint64 y, universe* u )
+{
+    Sint64 chunk_x = chunk_coordinate( x );
+    Sint64 chunk_y = chunk_coordinate( y );
+    universe_chunk *c = add_chunk( u, chunk_x, chunk_y );
+    if ( !c )
+    {
+        return FALSE;
+    }
+    cell_word *row = &c->cells[ u->current ][ y - chunk_y * CHUNK_SIZE ];
+    cell_word bitmask = ( cell_word ) 1 << ( x - chunk_x * CHUNK_SIZE );
+    *row ^= bitmask;
+    int change = ( *row & bitmask ) ? 1 : -1;
+    c->population += change;
+    u->population += change;
+    return TRUE;
+}
+
+bool universe_load_board( universe* u, board* b, Sint64 x, Sint64 y )
+{
+    for ( int row = 0; row < b->rows; row++ )
+    {
+        for ( int word = 0; word < b->words_per_row; word++ )
+        {
+            cell_word cells = b->grid[ ( Sint64 ) row*b->words_per_row + word ];
+            while ( cells )
+            {
+                int bit = popcount64( ( cells & -cells ) - 1 );
+                cells &= cells - 1;
+                Sint64 cell_x = x + word*CELLS_PER_WORD + bit;
+                if ( !universe_cell_state( cell_x, y + row, u ) && !universe_toggle_cell_state( cell_x, y + row, u ) )
+                {
+                    return FALSE;
+                }
+            }
+        }
+    }
+    return TRUE;
+}
+
+Uint64 universe_population( universe* u )
+{
+    return u->population;
+}
+
+int universe_chunk_count( universe* u )
+{
+    return u->chunk_count;
+}
+
+Uint64 universe_births( universe* u )
+{
+    return u->births;
+}
+
+Uint64 universe_deaths( universe* u )
+{
+    return u->deaths;
+}
+
+void read_universe_row( void* source, Sint64 x, Sint64 y, int width, cell_word* out )
+{
+    universe *u = source;
+    Sint64 chunk_y = chunk_coordinate( y );
+    int row = ( int ) ( y - chunk_y * CHUNK_SIZE );
+    Sint64 chunk_x = chunk_coordinate( x );
+    int shift = ( int ) ( x - chunk_x * CHUNK_SIZE );
+    // Every word of out is made of two neighboring chunks, the right one is the left one of the next word
+    cell_word left = chunk_rows( u, find_chunk( u, chunk_x, chunk_y ) )[ row ];
+    int words = ( width + CELLS_PER_WORD - 1 ) / CELLS_PER_WORD;
+    for ( int i = 0; i < words; i++ )
+    {
+        cell_word right = chunk_rows( u, find_chunk( u, chunk_x + i + 1, chunk_y ) )[ row ];
+        out[ i ] = shift ? ( left >> shift ) | ( right << ( CHUNK_SIZE - shift ) ) : left;
+        left = right;
+    }
+}
+
+void draw_universe( universe* u, view* player_view, cell_renderer* renderer )
+{
+    render_cells( renderer, player_view, read_universe_row, u );
+}
@@ -0,0 +1,91 @@
+#ifndef UNIVERSE_H
+#define UNIVERSE_H
+
+#include "board.h"
+#include "cell_renderer.h"
+
+/*
+ * An unbounded plane of cells. The living cells are kept in chunks of CHUNK_SIZE x CHUNK_SIZE cells
+ * that are stored in a hash map. Chunks are allocated when living cells get close to them and
+ * freed when they are empty, so the memory scales with the population instead of the area.
+ */
+#define CHUNK_SIZE CELLS_PER_WORD
+
+typedef struct universe universe;
+
+
+/**
+* Create an empty universe. Prints an error and returns NULL if it can't be allocated.
+*/
+universe* create_universe( void );
+
+/**
+* Free the universe and all of its chunks.
+*/
+void destroy_universe( universe* u );
+
+/**
+* Update the universe's state. Prints an error and returns FALSE if the chunks the living cells grow into can't be allocated,
+* the universe then stays at its generation.
+*/
+bool update_universe( universe* u );
+
+/**
+* Return the state of the cell at location x, y.
+*/
+bool universe_cell_state( Sint64 x, Sint64 y, universe* u );
+
+/**
+* Invert the state of the given cell ( alive -> dead and dead -> alive ).
+* Prints an error and returns FALSE if the cell's chunk can't be allocated.
+*/
+bool universe_toggle_cell_state( Sint64 x, Sint64 y, universe* u );
+
+/**
+* Set the rule the universe is updated with, a new universe follows B3/S23.
+*/
+void set_universe_rule( universe* u, life_rule rule );
+
+/**
+* Kill all cells and free all chunks.
+*/
+void universe_kill_all_cells( universe* u );
+
+/**
+* Copy the living cells of the board into the universe. The board's cell (0, 0) becomes the cell x, y.
+* Prints an error and returns FALSE with only some of the cells copied if a chunk can't be allocated.
+*/
+bool universe_load_board( universe* u, board* b, Sint64 x, Sint64 y );
+
+/**
+* Return the number of living cells.
+*/
+Uint64 universe_population( universe* u );
+
+/**
+* Return the number of allocated chunks.
+*/
+int universe_chunk_count( universe* u );
+
+/**
+* Return the number of cells that were born in the last update.
+*/
+Uint64 universe_births( universe* u );
+
+/**
+* Return the number of cells that died in the last update.
+*/
+Uint64 universe_deaths( universe* u );
+
+/**
+* Draw the part of the universe the view looks at to the window.
+* The view's camera isn't restricted, use NULL as board for move_camera_by and resize_board_view.
+*/
+void draw_universe( universe* u, view* player_view, cell_renderer* renderer );
+
+/**
+* The universe's cell_row_reader for render_cells, source is the universe.
+*/
+void read_universe_row( void* source, Sint64 x, Sint64 y, int width, cell_word* out );
+
+#endif